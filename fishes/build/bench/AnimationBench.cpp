@@ -0,0 +1,253 @@
+#include <vector>
+#include <cstdio>
+#include <cstddef>
+#include <thread>
+
+#include <SFML/System/Clock.hpp>
+#include <ui/AnimatedSprite.h>
+#include <ui/AnimationSystem.h>
+#include <ui/AnimationClock.h>
+#include <jobs/JobSystem.h>
+
+
+// Compare the per-object AnimatedSprite::update() against the batched
+// AnimationSystem::update() (with each kernel available in the cpu) for
+// different number of sprites, and the scaling of the parallel update from 1
+// to N threads (N = number of cores). It also prints the memory used by the
+// sprites, and the cost of the lazy playback mode (only the visible sprites
+// are evaluated) as the fraction of visible sprites drops.
+//
+// Usage: anim_bench [texture]
+
+namespace {
+
+const std::size_t NUM_FRAMES = 300;
+const float TIME_FRAME = 1.f / 60.f;
+
+// configure the same animations than the testSfml
+void
+configureAnims(ui::AnimatedSprite &sprite)
+{
+    ui::AnimatedSprite::AnimIndices anim;
+    std::vector<ui::AnimatedSprite::AnimIndices> animVec;
+    anim.begin = 0;
+    anim.end = 5;
+    anim.animTime = 4;
+    animVec.push_back(anim);
+    anim.begin = 6;
+    anim.end = 11;
+    anim.animTime = 0.5f;
+    animVec.push_back(anim);
+    anim.begin = 12;
+    anim.end = 13;
+    anim.animTime = 1.f;
+    animVec.push_back(anim);
+    sprite.createAnimTable(animVec);
+}
+
+// create count sprites with different animations and phases
+void
+createSprites(const ui::AnimatedSprite &proto,
+              std::size_t count,
+              std::vector<ui::AnimatedSprite> &sprites)
+{
+    sprites.clear();
+    sprites.resize(count, proto);
+    for (std::size_t i = 0; i < count; ++i) {
+        sprites[i].setAnim(i % 3);
+        sprites[i].setLoop(true);
+        // desync them
+        sprites[i].update(TIME_FRAME * (i % 61));
+    }
+}
+
+// print the size of the sprites (the AnimationSet is shared by all of them)
+void
+printMemory(const ui::AnimatedSprite &proto)
+{
+    const std::size_t COUNT = 10000;
+    const ui::AnimationSet &set = *proto.animationSet();
+    const std::size_t spriteSize = sizeof(ui::AnimatedSprite);
+    const std::size_t ownSize = spriteSize - sizeof(sf::Sprite);
+    const std::size_t setSize = sizeof(ui::AnimationSet) +
+        set.numAnims() * sizeof(ui::AnimationSet::Anim);
+
+    std::printf("sizeof(AnimatedSprite): %zu (%zu without sf::Sprite)\n",
+                spriteSize, ownSize);
+    std::printf("shared AnimationSet: %zu bytes\n", setSize);
+    std::printf("%zu sprites: %zu bytes (%zu without sf::Sprite)\n\n",
+                COUNT, COUNT * spriteSize + setSize, COUNT * ownSize + setSize);
+}
+
+// returns the nanoseconds per sprite per frame
+double
+toNsPerSprite(const sf::Time &time, std::size_t count)
+{
+    return (time.asMicroseconds() * 1000.0) /
+        static_cast<double>(count * NUM_FRAMES);
+}
+
+// time the parallel AnimationSystem::update() with 1..N threads
+void
+benchThreads(const ui::AnimatedSprite &proto,
+             const std::size_t *counts,
+             std::size_t numCounts)
+{
+    std::size_t maxThreads = std::thread::hardware_concurrency();
+    if (maxThreads == 0) {
+        maxThreads = 1;
+    }
+
+    std::vector<ui::AnimatedSprite> sprites;
+    sf::Clock clock;
+    std::printf("\n%10s %10s %16s %10s\n",
+                "sprites", "threads", "ns/sprite", "speedup");
+    for (std::size_t c = 0; c < numCounts; ++c) {
+        const std::size_t count = counts[c];
+        double oneThreadNs = 0.;
+        for (std::size_t t = 1; t <= maxThreads; ++t) {
+            jobs::JobSystem jobSystem(t);
+            createSprites(proto, count, sprites);
+            ui::AnimationSystem system;
+            system.reserve(count);
+            for (std::size_t i = 0; i < count; ++i) {
+                system.add(sprites[i]);
+            }
+            clock.restart();
+            for (std::size_t f = 0; f < NUM_FRAMES; ++f) {
+                system.update(TIME_FRAME, &jobSystem);
+                jobSystem.sync();
+            }
+            const double ns = toNsPerSprite(clock.getElapsedTime(), count);
+            system.clear();
+            if (t == 1) {
+                oneThreadNs = ns;
+            }
+            std::printf("%10zu %10zu %16.2f %9.2fx\n",
+                        count, t, ns, oneThreadNs / ns);
+        }
+    }
+}
+
+// time the lazy sprites (the clock advanced each frame and only the visible
+// ones evaluated) against the per object update of all of them
+void
+benchLazy(const ui::AnimatedSprite &proto,
+          const std::size_t *counts,
+          std::size_t numCounts)
+{
+    // the visible sprites in percent
+    static const std::size_t VISIBLE[] = {100, 50, 25, 10, 1, 0};
+    const std::size_t numVisible = sizeof(VISIBLE) / sizeof(VISIBLE[0]);
+
+    ui::AnimationClock *animClock = ui::AnimationClock::getInstance();
+    std::vector<ui::AnimatedSprite> sprites;
+    sf::Clock clock;
+    std::printf("\n%10s %10s %16s %10s\n",
+                "sprites", "visible", "ns/sprite", "speedup");
+    for (std::size_t c = 0; c < numCounts; ++c) {
+        const std::size_t count = counts[c];
+
+        // all the sprites are updated even if nobody looks at them
+        createSprites(proto, count, sprites);
+        clock.restart();
+        for (std::size_t f = 0; f < NUM_FRAMES; ++f) {
+            for (std::size_t i = 0; i < count; ++i) {
+                sprites[i].update(TIME_FRAME);
+            }
+        }
+        const double eagerNs = toNsPerSprite(clock.getElapsedTime(), count);
+        std::printf("%10zu %10s %16.2f %9.2fx\n", count, "eager", eagerNs, 1.);
+
+        for (std::size_t v = 0; v < numVisible; ++v) {
+            createSprites(proto, count, sprites);
+            for (std::size_t i = 0; i < count; ++i) {
+                sprites[i].setLazy(true);
+            }
+            // evaluate the first VISIBLE% of the sprites (as a culling pass
+            // would give them)
+            const std::size_t visible = count * VISIBLE[v] / 100;
+            clock.restart();
+            for (std::size_t f = 0; f < NUM_FRAMES; ++f) {
+                animClock->advance(TIME_FRAME);
+                for (std::size_t i = 0; i < visible; ++i) {
+                    sprites[i].evaluate();
+                }
+            }
+            const double lazyNs = toNsPerSprite(clock.getElapsedTime(), count);
+            char label[16];
+            std::snprintf(label, sizeof(label), "lazy %zu%%", VISIBLE[v]);
+            std::printf("%10zu %10s %16.2f %9.2fx\n",
+                        count, label, lazyNs,
+                        lazyNs > 0. ? eagerNs / lazyNs : 0.);
+        }
+    }
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    const char *textFName = (argc > 1) ? argv[1] : "./mediaTest/6x3.png";
+
+    ui::AnimatedSprite proto;
+    if (!proto.build(textFName, 6, 3)) {
+        std::printf("Error building the sprite from %s\n", textFName);
+        return -1;
+    }
+    configureAnims(proto);
+    printMemory(proto);
+
+    static const std::size_t COUNTS[] = {1000, 10000, 100000};
+    std::vector<ui::AnimatedSprite> sprites;
+    sf::Clock clock;
+
+    std::printf("%10s %10s %16s %10s\n",
+                "sprites", "mode", "ns/sprite", "speedup");
+    for (std::size_t c = 0; c < sizeof(COUNTS) / sizeof(COUNTS[0]); ++c) {
+        const std::size_t count = COUNTS[c];
+
+        // per object update
+        createSprites(proto, count, sprites);
+        clock.restart();
+        for (std::size_t f = 0; f < NUM_FRAMES; ++f) {
+            for (std::size_t i = 0; i < count; ++i) {
+                sprites[i].update(TIME_FRAME);
+            }
+        }
+        const double objectNs = toNsPerSprite(clock.getElapsedTime(), count);
+        std::printf("%10zu %10s %16.2f %9.2fx\n", count, "object", objectNs, 1.);
+
+        // batched update with each kernel, same initial state
+        for (int k = 0; k < ui::AnimationKernel::NUM_TYPES; ++k) {
+            const ui::AnimationKernel::Type type =
+                static_cast<ui::AnimationKernel::Type>(k);
+            if (!ui::AnimationKernel::isAvailable(type)) {
+                continue;
+            }
+            createSprites(proto, count, sprites);
+            ui::AnimationSystem system;
+            system.setKernel(type);
+            system.reserve(count);
+            for (std::size_t i = 0; i < count; ++i) {
+                system.add(sprites[i]);
+            }
+            clock.restart();
+            for (std::size_t f = 0; f < NUM_FRAMES; ++f) {
+                system.update(TIME_FRAME);
+            }
+            const double batchedNs =
+                toNsPerSprite(clock.getElapsedTime(), count);
+            system.clear();
+
+            std::printf("%10zu %10s %16.2f %9.2fx\n",
+                        count, ui::AnimationKernel::name(type), batchedNs,
+                        objectNs / batchedNs);
+        }
+    }
+
+    benchThreads(proto, COUNTS, sizeof(COUNTS) / sizeof(COUNTS[0]));
+    benchLazy(proto, COUNTS, sizeof(COUNTS) / sizeof(COUNTS[0]));
+
+    return 0;
+}
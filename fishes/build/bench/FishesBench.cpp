@@ -0,0 +1,795 @@
+#include <cmath>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <boost/function.hpp>
+
+#include <SFML/Graphics/Image.hpp>
+#include <SFML/Graphics/View.hpp>
+#include <ui/AnimatedSprite.h>
+#include <ui/AnimationSet.h>
+#include <ui/AnimationSystem.h>
+#include <ui/SpriteBatch.h>
+#include <ui/SpatialGrid.h>
+#include <ui/TextureCache.h>
+#include <FileManager.h>
+
+
+// Headless benchmark suite (no window is opened) to track the performance
+// across commits:
+//  - micro benchmarks: the cost of one operation (sprite update, rect
+//    configuration, anim table creation, build, file reads).
+//  - macro scenarios: N fishes using M sheets swimming for T seconds of
+//    simulated frames (move, cull, animate and batch them).
+// The results are printed and optionally written as JSON.
+// Uploading textures needs an OpenGL context (that sfml creates on demand
+// and can't without a display). Without it (or with --headless) the sprites
+// use stand-in textures that are never uploaded (with empty frames), the
+// cases that upload textures are skipped and the JSON says so.
+//
+// Usage: fishes_bench [--texture file] [--json file] [--tag name]
+//                     [--filter substring] [--repeats K] [--headless 1]
+//                     [--scenario N,M,T]...
+
+namespace {
+
+typedef std::chrono::steady_clock SteadyClock;
+
+const float TIME_FRAME = 1.f / 60.f;
+const char *TMP_FILE = "./fishes_bench_file.tmp";
+
+struct Options {
+    std::string texture;
+    std::string jsonFile;
+    std::string tag;
+    std::string filter;
+    std::size_t repeats;
+    // no OpenGL context, don't upload textures
+    bool headless;
+    // N fishes, M sheets, T seconds
+    struct Scenario {
+        std::size_t fishes;
+        std::size_t sheets;
+        float seconds;
+    };
+    std::vector<Scenario> scenarios;
+};
+
+struct MicroResult {
+    std::string name;
+    std::size_t opsPerRun;
+    std::size_t runs;
+    double nsPerOp;         // median of the runs
+    double minNsPerOp;
+    std::size_t bytesPerOp; // 0 if it doesn't apply
+};
+
+struct MacroResult {
+    std::string name;
+    std::size_t fishes;
+    std::size_t sheets;
+    float seconds;
+    std::size_t frames;
+    double meanMs;
+    double p50Ms;
+    double p95Ms;
+    double maxMs;
+    double visible;         // average sprites drawn per frame
+};
+
+// returns the elapsed nanoseconds since begin
+inline double
+elapsedNs(const SteadyClock::time_point &begin)
+{
+    return std::chrono::duration<double, std::nano>(
+        SteadyClock::now() - begin).count();
+}
+
+// returns the value at the percentile p ([0, 1]) of sorted values
+double
+percentile(const std::vector<double> &sorted, double p)
+{
+    if (sorted.empty()) {
+        return 0.;
+    }
+    const std::size_t i = static_cast<std::size_t>(p * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(i, sorted.size() - 1)];
+}
+
+// configure the same animations than the testSfml
+std::vector<ui::AnimatedSprite::AnimIndices>
+fishAnims(void)
+{
+    std::vector<ui::AnimatedSprite::AnimIndices> anims(3);
+    anims[0].begin = 0;
+    anims[0].end = 5;
+    anims[0].animTime = 4;
+    anims[1].begin = 6;
+    anims[1].end = 11;
+    anims[1].animTime = 0.5f;
+    anims[2].begin = 12;
+    anims[2].end = 13;
+    anims[2].animTime = 1.f;
+    return anims;
+}
+
+// returns true if sfml can create its OpenGL context (it aborts if there is
+// no display to create it)
+bool
+hasGlContext(void)
+{
+#if defined(__linux__) || defined(__FreeBSD__)
+    const char *display = std::getenv("DISPLAY");
+    return display != 0 && display[0] != '\0';
+#else
+    return true;
+#endif
+}
+
+// returns the texture of a sheet: loaded from the image or a stand-in that
+// is never uploaded (headless)
+ui::TextureHandle
+sheetTexture(const Options &options,
+             const std::string &name,
+             const sf::Image &image)
+{
+    if (options.headless) {
+        return ui::TextureHandle(new sf::Texture);
+    }
+    return ui::TextureCache::getInstance()->add(name, image);
+}
+
+// small deterministic generator, the same fishes in every run
+struct Random {
+    unsigned int state;
+    Random() : state(12345u) {}
+    float next(float max)
+    {
+        state = state * 1103515245u + 12345u;
+        return max * ((state >> 8) & 0xFFFF) / 65535.f;
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Micro benchmarks
+//
+
+class MicroSuite
+{
+public:
+    MicroSuite(const Options &options) : mOptions(options) {}
+
+    // @brief Run a benchmark: run() is called mOptions.repeats times (after
+    // one warm up call), each call does opsPerRun operations
+    void run(const std::string &name,
+             std::size_t opsPerRun,
+             const boost::function<void (void)> &run,
+             std::size_t bytesPerOp = 0)
+    {
+        if (!mOptions.filter.empty() &&
+            name.find(mOptions.filter) == std::string::npos) {
+            return;
+        }
+
+        run();
+        std::vector<double> nsPerOp;
+        for (std::size_t r = 0; r < mOptions.repeats; ++r) {
+            const SteadyClock::time_point begin = SteadyClock::now();
+            run();
+            nsPerOp.push_back(elapsedNs(begin) / opsPerRun);
+        }
+        std::sort(nsPerOp.begin(), nsPerOp.end());
+
+        MicroResult result;
+        result.name = name;
+        result.opsPerRun = opsPerRun;
+        result.runs = nsPerOp.size();
+        result.nsPerOp = percentile(nsPerOp, 0.5);
+        result.minNsPerOp = nsPerOp.front();
+        result.bytesPerOp = bytesPerOp;
+        mResults.push_back(result);
+
+        std::printf("%-28s %14.2f %14.2f", name.c_str(),
+                    result.nsPerOp, result.minNsPerOp);
+        if (bytesPerOp > 0) {
+            std::printf(" %10.1f MB/s", bytesPerOp / result.nsPerOp * 1e3);
+        }
+        std::printf("\n");
+    }
+
+    // @brief Record a benchmark that can't run (i.e. headless)
+    void skip(const std::string &name)
+    {
+        if (!mOptions.filter.empty() &&
+            name.find(mOptions.filter) == std::string::npos) {
+            return;
+        }
+        std::printf("%-28s %14s\n", name.c_str(), "skipped");
+        mSkipped.push_back(name);
+    }
+
+    inline const std::vector<MicroResult> &results(void) const
+    {
+        return mResults;
+    }
+    inline const std::vector<std::string> &skipped(void) const
+    {
+        return mSkipped;
+    }
+
+private:
+    const Options &mOptions;
+    std::vector<MicroResult> mResults;
+    std::vector<std::string> mSkipped;
+};
+
+void
+updateSprites(std::vector<ui::AnimatedSprite> &sprites, std::size_t frames)
+{
+    for (std::size_t f = 0; f < frames; ++f) {
+        for (std::size_t i = 0; i < sprites.size(); ++i) {
+            sprites[i].update(TIME_FRAME);
+        }
+    }
+}
+
+void
+updateSystem(ui::AnimationSystem &system, std::size_t frames)
+{
+    for (std::size_t f = 0; f < frames; ++f) {
+        system.update(TIME_FRAME);
+    }
+}
+
+void
+configureRects(ui::AnimatedSprite &sprite, std::size_t count)
+{
+    // the same than AnimatedSprite::configureRect()
+    const ui::AnimationSet &set = *sprite.animationSet();
+    const std::size_t numFrames = set.numFrames();
+    for (std::size_t i = 0; i < count; ++i) {
+        sprite.setTextureRect(set.frame(i % numFrames));
+    }
+}
+
+void
+createAnimTables(ui::AnimatedSprite &sprite,
+                 const std::vector<ui::AnimatedSprite::AnimIndices> &anims,
+                 std::size_t count)
+{
+    for (std::size_t i = 0; i < count; ++i) {
+        sprite.createAnimTable(anims);
+    }
+}
+
+void
+buildFromSet(ui::AnimatedSprite &sprite,
+             const ui::AnimationSet::Ptr &set,
+             std::size_t count)
+{
+    for (std::size_t i = 0; i < count; ++i) {
+        sprite.build(set);
+    }
+}
+
+void
+buildFromTexture(ui::AnimatedSprite &sprite,
+                 const ui::TextureHandle &texture,
+                 std::size_t count)
+{
+    for (std::size_t i = 0; i < count; ++i) {
+        sprite.build(texture, 6, 3);
+    }
+}
+
+void
+buildFromFile(ui::AnimatedSprite &sprite,
+              const std::string &fName,
+              std::size_t count)
+{
+    for (std::size_t i = 0; i < count; ++i) {
+        sprite.build(fName, 6, 3);
+    }
+}
+
+// touch a byte of each page (the mapped pages are read when touched), the
+// same work for all the ways of reading
+std::size_t
+checksum(const char *data, std::size_t size)
+{
+    std::size_t sum = 0;
+    for (std::size_t i = 0; i < size; i += 4096) {
+        sum += static_cast<unsigned char>(data[i]);
+    }
+    return sum;
+}
+
+// the old FileManager::readFileContent: read into a buffer and copy it into
+// the string (stops at the first NUL)
+bool
+readFileLegacy(const std::string &fName, std::string &contents)
+{
+    std::ifstream is(fName.c_str(), std::ios::binary);
+    if (!is.good()) {
+        return false;
+    }
+    is.seekg(0, std::ios::end);
+    const int fLength = is.tellg();
+    is.seekg(0, std::ios::beg);
+    char *buffer = new char[fLength + 1];
+    buffer[fLength] = '\0';
+    is.read(buffer, fLength);
+    const bool ok = !is.fail();
+    if (ok) {
+        contents = buffer;
+    }
+    delete[] buffer;
+    return ok;
+}
+
+enum ReadMode {
+    READ_LEGACY,
+    READ_CONTENT,
+    READ_VIEW
+};
+
+std::size_t sChecksum = 0;
+
+void
+readFile(const std::string &fName, std::size_t count, ReadMode mode)
+{
+    std::string contents;
+    FileView view;
+    for (std::size_t i = 0; i < count; ++i) {
+        bool ok;
+        if (mode == READ_LEGACY) {
+            ok = readFileLegacy(fName, contents);
+            sChecksum += checksum(contents.data(), contents.size());
+        } else if (mode == READ_CONTENT) {
+            ok = FileManager::getInstance()->readFileContent(fName, contents);
+            sChecksum += checksum(contents.data(), contents.size());
+        } else {
+            ok = FileManager::getInstance()->readFileView(fName, view);
+            sChecksum += checksum(view.data(), view.size());
+        }
+        if (!ok) {
+            std::printf("Error reading %s\n", fName.c_str());
+            return;
+        }
+    }
+}
+
+bool
+runMicro(const Options &options,
+         const ui::AnimatedSprite &proto,
+         MicroSuite &suite)
+{
+    const std::vector<ui::AnimatedSprite::AnimIndices> anims = fishAnims();
+    const std::size_t COUNT = 10000;
+    const std::size_t FRAMES = 100;
+
+    std::printf("%-28s %14s %14s\n", "micro", "ns/op", "min ns/op");
+
+    // per sprite update, object and batched
+    std::vector<ui::AnimatedSprite> sprites(COUNT, proto);
+    for (std::size_t i = 0; i < COUNT; ++i) {
+        sprites[i].setAnim(i % anims.size());
+        sprites[i].setLoop(true);
+    }
+    suite.run("sprite_update", COUNT * FRAMES,
+              [&sprites, FRAMES]() { updateSprites(sprites, FRAMES); });
+    {
+        ui::AnimationSystem system;
+        system.reserve(COUNT);
+        for (std::size_t i = 0; i < COUNT; ++i) {
+            system.add(sprites[i]);
+        }
+        suite.run("sprite_update_system", COUNT * FRAMES,
+                  [&system, FRAMES]() { updateSystem(system, FRAMES); });
+    }
+
+    // rect configuration / anim table / build
+    ui::AnimatedSprite sprite(proto);
+    suite.run("configure_rect", COUNT * FRAMES,
+              [&sprite, COUNT, FRAMES]() {
+                  configureRects(sprite, COUNT * FRAMES);
+              });
+    suite.run("create_anim_table", COUNT,
+              [&sprite, &anims, COUNT]() {
+                  createAnimTables(sprite, anims, COUNT);
+              });
+    const ui::AnimationSet::Ptr set = proto.animationSet();
+    suite.run("build_set", COUNT,
+              [&sprite, &set, COUNT]() { buildFromSet(sprite, set, COUNT); });
+    const ui::TextureHandle texture = set->texture();
+    suite.run("build_texture_grid", COUNT,
+              [&sprite, &texture, COUNT]() {
+                  buildFromTexture(sprite, texture, COUNT);
+              });
+    // loading the file uploads the texture
+    const std::string textFName = options.texture;
+    if (options.headless) {
+        suite.skip("build_file_cached");
+    } else {
+        suite.run("build_file_cached", COUNT,
+                  [&sprite, &textFName, COUNT]() {
+                      buildFromFile(sprite, textFName, COUNT);
+                  });
+    }
+
+    // file reads (hot in the page cache): the old readFileContent, the
+    // current one and the FileView
+    static const std::size_t SIZES[] = {1 << 10, 64 << 10, 256 << 10, 1 << 20,
+                                        16 << 20, 100 << 20};
+    static const char *SIZE_NAMES[] = {"1k", "64k", "256k", "1m", "16m",
+                                       "100m"};
+    static const char *MODE_NAMES[] = {"file_read_legacy_", "file_read_",
+                                       "file_view_"};
+    for (std::size_t s = 0; s < sizeof(SIZES) / sizeof(SIZES[0]); ++s) {
+        const std::string data(SIZES[s], 'f');
+        if (!FileManager::getInstance()->writeFile(TMP_FILE, data)) {
+            return false;
+        }
+        const std::size_t count = std::max<std::size_t>((256 << 20) / SIZES[s],
+                                                        4);
+        const std::string fName = TMP_FILE;
+        for (int m = READ_LEGACY; m <= READ_VIEW; ++m) {
+            const ReadMode mode = static_cast<ReadMode>(m);
+            suite.run(std::string(MODE_NAMES[m]) + SIZE_NAMES[s], count,
+                      [&fName, count, mode]() { readFile(fName, count, mode); },
+                      SIZES[s]);
+        }
+    }
+    std::remove(TMP_FILE);
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Macro scenarios
+//
+
+// returns the name of a scenario
+std::string
+scenarioName(const Options::Scenario &scenario)
+{
+    char name[64];
+    std::snprintf(name, sizeof(name), "fishes_%zu_sheets_%zu_%gs",
+                  scenario.fishes, scenario.sheets, scenario.seconds);
+    return name;
+}
+
+// a fish swimming around the tank
+struct Fish {
+    float vx;
+    float vy;
+};
+
+bool
+runScenario(const Options &options,
+            const Options::Scenario &scenario,
+            const sf::Image &image,
+            MacroResult &result)
+{
+    const std::vector<ui::AnimatedSprite::AnimIndices> anims = fishAnims();
+
+    // one texture per sheet (different textures, so a batch per sheet)
+    std::vector<ui::AnimationSet::Ptr> sets;
+    for (std::size_t s = 0; s < scenario.sheets; ++s) {
+        char name[64];
+        std::snprintf(name, sizeof(name), "fishes_bench_sheet_%zu", s);
+        ui::TextureHandle texture = sheetTexture(options, name, image);
+        ui::AnimationSet::Ptr set = ui::AnimationSet::grid(texture, 6, 3);
+        if (set.get() == 0) {
+            return false;
+        }
+        sets.push_back(set->withAnims(anims));
+    }
+
+    // the same density of fishes in all the scenarios: the tank grows with
+    // the number of fishes
+    const float viewWidth = 800.f;
+    const float viewHeight = 600.f;
+    const float scale = std::sqrt(std::max(1.f, scenario.fishes / 500.f));
+    const float tankWidth = viewWidth * scale;
+    const float tankHeight = viewHeight * scale;
+
+    Random random;
+    std::vector<ui::AnimatedSprite> sprites(scenario.fishes);
+    std::vector<Fish> fishes(scenario.fishes);
+    ui::AnimationSystem system;
+    system.reserve(scenario.fishes);
+    ui::SpatialGrid grid;
+    for (std::size_t i = 0; i < scenario.fishes; ++i) {
+        sprites[i].build(sets[i % sets.size()]);
+        sprites[i].setPosition(random.next(tankWidth), random.next(tankHeight));
+        fishes[i].vx = random.next(200.f) - 100.f;
+        fishes[i].vy = random.next(40.f) - 20.f;
+        system.add(sprites[i]);
+        sprites[i].setAnim(i % anims.size());
+        sprites[i].setLoop(true);
+        grid.add(sprites[i]);
+    }
+    std::vector<ui::SpriteBatch> batches(sets.size());
+    std::vector<sf::Sprite *> visible;
+    sf::View view(sf::FloatRect(0.f, 0.f, viewWidth, viewHeight));
+
+    const std::size_t numFrames =
+        static_cast<std::size_t>(scenario.seconds / TIME_FRAME);
+    std::vector<double> frameMs;
+    frameMs.reserve(numFrames);
+    std::size_t drawn = 0;
+    for (std::size_t f = 0; f < numFrames; ++f) {
+        const SteadyClock::time_point begin = SteadyClock::now();
+
+        // swim, bouncing in the walls
+        for (std::size_t i = 0; i < scenario.fishes; ++i) {
+            Fish &fish = fishes[i];
+            sf::Vector2f pos = sprites[i].getPosition();
+            pos.x += fish.vx * TIME_FRAME;
+            pos.y += fish.vy * TIME_FRAME;
+            if (pos.x < 0.f || pos.x > tankWidth) {
+                fish.vx = -fish.vx;
+            }
+            if (pos.y < 0.f || pos.y > tankHeight) {
+                fish.vy = -fish.vy;
+            }
+            sprites[i].setPosition(pos);
+        }
+        grid.updateAll();
+        system.update(TIME_FRAME);
+
+        // the camera goes around the tank
+        const float t = f * TIME_FRAME;
+        view.setCenter(
+            viewWidth * 0.5f + (tankWidth - viewWidth) * 0.5f *
+                (1.f + std::sin(t * 0.5f)),
+            viewHeight * 0.5f + (tankHeight - viewHeight) * 0.5f *
+                (1.f + std::cos(t * 0.3f)));
+        grid.query(ui::SpatialGrid::viewRect(view), visible);
+        for (std::size_t b = 0; b < batches.size(); ++b) {
+            batches[b].clear();
+        }
+        for (std::size_t i = 0; i < visible.size(); ++i) {
+            const ui::AnimatedSprite *sprite =
+                static_cast<const ui::AnimatedSprite *>(visible[i]);
+            for (std::size_t b = 0; b < sets.size(); ++b) {
+                if (sprite->animationSet()->texture() == sets[b]->texture()) {
+                    batches[b].add(*sprite);
+                    break;
+                }
+            }
+        }
+        for (std::size_t b = 0; b < batches.size(); ++b) {
+            batches[b].updateVertices();
+        }
+        drawn += visible.size();
+
+        frameMs.push_back(elapsedNs(begin) * 1e-6);
+    }
+
+    result.name = scenarioName(scenario);
+    result.fishes = scenario.fishes;
+    result.sheets = scenario.sheets;
+    result.seconds = scenario.seconds;
+    result.frames = numFrames;
+    result.meanMs = 0.;
+    for (std::size_t f = 0; f < frameMs.size(); ++f) {
+        result.meanMs += frameMs[f];
+    }
+    result.meanMs /= std::max<std::size_t>(1, frameMs.size());
+    std::sort(frameMs.begin(), frameMs.end());
+    result.p50Ms = percentile(frameMs, 0.5);
+    result.p95Ms = percentile(frameMs, 0.95);
+    result.maxMs = frameMs.empty() ? 0. : frameMs.back();
+    result.visible = double(drawn) / std::max<std::size_t>(1, numFrames);
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// JSON output
+//
+
+std::string
+jsonString(const std::string &str)
+{
+    std::string result = "\"";
+    for (std::size_t i = 0; i < str.size(); ++i) {
+        const char c = str[i];
+        if (c == '"' || c == '\\') {
+            result += '\\';
+            result += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            result += escaped;
+        } else {
+            result += c;
+        }
+    }
+    return result + "\"";
+}
+
+bool
+writeJson(const Options &options,
+          const MicroSuite &suite,
+          const std::vector<MacroResult> &macro)
+{
+    FILE *file = std::fopen(options.jsonFile.c_str(), "w");
+    if (file == 0) {
+        std::printf("Error opening %s\n", options.jsonFile.c_str());
+        return false;
+    }
+
+    std::fprintf(file, "{\n  \"version\": 1,\n");
+    std::fprintf(file, "  \"tag\": %s,\n", jsonString(options.tag).c_str());
+    std::fprintf(file, "  \"timestamp\": %lld,\n",
+                 static_cast<long long>(std::chrono::duration_cast<
+                     std::chrono::seconds>(std::chrono::system_clock::now().
+                         time_since_epoch()).count()));
+    std::fprintf(file, "  \"compiler\": %s,\n", jsonString(__VERSION__).c_str());
+    std::fprintf(file, "  \"repeats\": %zu,\n", options.repeats);
+    std::fprintf(file, "  \"gl_context\": %s,\n",
+                 options.headless ? "false" : "true");
+    if (options.headless) {
+        std::fprintf(file, "  \"note\": %s,\n", jsonString(
+            "no OpenGL context: stand-in textures (never uploaded, empty "
+            "frames), the texture upload cases were skipped").c_str());
+    }
+    std::fprintf(file, "  \"skipped\": [");
+    for (std::size_t i = 0; i < suite.skipped().size(); ++i) {
+        std::fprintf(file, "%s%s", (i > 0) ? ", " : "",
+                     jsonString(suite.skipped()[i]).c_str());
+    }
+    std::fprintf(file, "],\n");
+
+    const std::vector<MicroResult> &micro = suite.results();
+
+    std::fprintf(file, "  \"micro\": [");
+    for (std::size_t i = 0; i < micro.size(); ++i) {
+        const MicroResult &r = micro[i];
+        std::fprintf(file, "%s\n    {\"name\": %s, \"ops_per_run\": %zu, "
+                     "\"runs\": %zu, \"ns_per_op\": %.3f, "
+                     "\"min_ns_per_op\": %.3f, \"bytes_per_op\": %zu}",
+                     (i > 0) ? "," : "", jsonString(r.name).c_str(),
+                     r.opsPerRun, r.runs, r.nsPerOp, r.minNsPerOp,
+                     r.bytesPerOp);
+    }
+    std::fprintf(file, "\n  ],\n");
+
+    std::fprintf(file, "  \"macro\": [");
+    for (std::size_t i = 0; i < macro.size(); ++i) {
+        const MacroResult &r = macro[i];
+        std::fprintf(file, "%s\n    {\"name\": %s, \"fishes\": %zu, "
+                     "\"sheets\": %zu, \"seconds\": %g, \"frames\": %zu, "
+                     "\"ms_per_frame_mean\": %.4f, \"ms_per_frame_p50\": %.4f, "
+                     "\"ms_per_frame_p95\": %.4f, \"ms_per_frame_max\": %.4f, "
+                     "\"visible_per_frame\": %.1f}",
+                     (i > 0) ? "," : "", jsonString(r.name).c_str(),
+                     r.fishes, r.sheets, r.seconds, r.frames, r.meanMs,
+                     r.p50Ms, r.p95Ms, r.maxMs, r.visible);
+    }
+    std::fprintf(file, "\n  ]\n}\n");
+
+    const bool ok = !std::ferror(file);
+    std::fclose(file);
+    return ok;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Command line
+//
+
+bool
+parseArgs(int argc, char **argv, Options &options)
+{
+    options.texture = "./mediaTest/6x3.png";
+    options.repeats = 5;
+    options.headless = !hasGlContext();
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::printf("Missing the value of %s\n", arg.c_str());
+            return false;
+        }
+        const char *value = argv[++i];
+        if (arg == "--texture") {
+            options.texture = value;
+        } else if (arg == "--json") {
+            options.jsonFile = value;
+        } else if (arg == "--tag") {
+            options.tag = value;
+        } else if (arg == "--filter") {
+            options.filter = value;
+        } else if (arg == "--repeats") {
+            options.repeats = std::max(1, std::atoi(value));
+        } else if (arg == "--headless") {
+            options.headless = options.headless || std::atoi(value) != 0;
+        } else if (arg == "--scenario") {
+            Options::Scenario scenario;
+            if (std::sscanf(value, "%zu,%zu,%f", &scenario.fishes,
+                            &scenario.sheets, &scenario.seconds) != 3 ||
+                scenario.fishes == 0 || scenario.sheets == 0 ||
+                scenario.seconds <= 0.f) {
+                std::printf("Invalid scenario %s (expected N,M,T)\n", value);
+                return false;
+            }
+            options.scenarios.push_back(scenario);
+        } else {
+            std::printf("Unknown option %s\n", arg.c_str());
+            return false;
+        }
+    }
+
+    if (options.scenarios.empty()) {
+        static const Options::Scenario DEFAULTS[] = {
+            {1000, 1, 10.f}, {10000, 4, 10.f}, {50000, 8, 5.f}
+        };
+        options.scenarios.assign(DEFAULTS,
+                                 DEFAULTS + sizeof(DEFAULTS) / sizeof(DEFAULTS[0]));
+    }
+    return true;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!parseArgs(argc, argv, options)) {
+        return -1;
+    }
+
+    if (options.headless) {
+        std::printf("No OpenGL context, the textures are not uploaded\n\n");
+    }
+
+    // decoding the image doesn't need the context
+    ui::AnimatedSprite proto;
+    sf::Image image;
+    const bool built = options.headless ?
+        proto.build(ui::TextureHandle(new sf::Texture), 6, 3) :
+        proto.build(options.texture, 6, 3);
+    if (!built || !image.loadFromFile(options.texture)) {
+        std::printf("Error building the sprite from %s\n",
+                    options.texture.c_str());
+        return -1;
+    }
+    proto.createAnimTable(fishAnims());
+
+    MicroSuite suite(options);
+    if (!runMicro(options, proto, suite)) {
+        return -1;
+    }
+
+    std::vector<MacroResult> macro;
+    std::printf("\n%-28s %10s %10s %10s %10s %10s\n", "macro",
+                "mean ms", "p50 ms", "p95 ms", "max ms", "visible");
+    for (std::size_t s = 0; s < options.scenarios.size(); ++s) {
+        if (!options.filter.empty() &&
+            scenarioName(options.scenarios[s]).find(options.filter) ==
+                std::string::npos) {
+            continue;
+        }
+        MacroResult result;
+        if (!runScenario(options, options.scenarios[s], image, result)) {
+            std::printf("Error running the scenario %zu\n", s);
+            return -1;
+        }
+        std::printf("%-28s %10.3f %10.3f %10.3f %10.3f %10.1f\n",
+                    result.name.c_str(), result.meanMs, result.p50Ms,
+                    result.p95Ms, result.maxMs, result.visible);
+        macro.push_back(result);
+    }
+
+    if (!options.jsonFile.empty() &&
+        !writeJson(options, suite, macro)) {
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,153 @@
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cstddef>
+
+#include <SFML/System/Clock.hpp>
+#include <debug/DebugUtil.h>
+#include <debug/AsyncLog.h>
+
+
+// Compare the cost of the debug* macros writing synchronously (fprintf from
+// the calling thread) against the AsyncLog, on the calling thread and end to
+// end (until everything is written). The messages go to stderr, redirect it:
+//
+// Usage: log_bench [threads] 2>/dev/null    (or 2>file to include the disk)
+
+namespace {
+
+// the synchronous DEBUG_PRINT of DebugUtil.h
+#define SYNC_LOG(format, ...) \
+    {fprintf(stderr, "\33[0mDEBUG[%s, %s, %d]: ", \
+     __FILENAME__, __FUNCTION__, __LINE__); \
+     fprintf(stderr, format "\33[0m", ## __VA_ARGS__);}
+
+#define ASYNC_LOG(format, ...) \
+    DEBUG_ASYNC_LOG(stderr, "\33[0mDEBUG", 1, format, ## __VA_ARGS__)
+
+// messages per frame (a burst, i.e. loading a level, not a steady rate)
+const std::size_t BURST = 250;
+const std::size_t NUM_FRAMES = 400;
+const std::chrono::milliseconds FRAME_GAP(1);
+
+struct Result {
+    double nsPerCall;       // in the calling thread, logging in bursts
+    double msgPerSecond;    // written, logging as fast as possible
+    std::size_t burstDropped;
+    std::size_t dropped;
+};
+
+template<bool ASYNC>
+void
+logBurst(std::size_t thread, std::size_t frame)
+{
+    const std::string name = "fish_" + std::to_string(frame);
+    for (std::size_t i = 0; i < BURST; ++i) {
+        if (ASYNC) {
+            ASYNC_LOG("thread %zu sprite %zu (%s) at %.2f, %.2f anim %d\n",
+                      thread, i, name.c_str(), i * 0.5f, i * 0.25f, int(i % 7));
+        } else {
+            SYNC_LOG("thread %zu sprite %zu (%s) at %.2f, %.2f anim %d\n",
+                     thread, i, name.c_str(), i * 0.5f, i * 0.25f, int(i % 7));
+        }
+    }
+}
+
+// Wait until everything was written
+template<bool ASYNC>
+void
+flushAll(void)
+{
+    if (ASYNC) {
+        debug::AsyncLog::getInstance()->flush();
+    }
+    std::fflush(stderr);
+}
+
+template<bool ASYNC>
+std::size_t
+numDropped(void)
+{
+    return ASYNC ? debug::AsyncLog::getInstance()->stats().dropped : 0;
+}
+
+// Run numThreads threads logging NUM_FRAMES bursts each, with gap between
+// them. Returns the microseconds spent in the logging calls.
+template<bool ASYNC>
+double
+run(std::size_t numThreads, std::chrono::milliseconds gap)
+{
+    std::vector<double> callTimes(numThreads, 0.);
+    std::vector<std::thread> threads;
+    for (std::size_t t = 0; t < numThreads; ++t) {
+        threads.push_back(std::thread([t, gap, &callTimes]() {
+            for (std::size_t f = 0; f < NUM_FRAMES; ++f) {
+                sf::Clock clock;
+                logBurst<ASYNC>(t, f);
+                callTimes[t] += clock.getElapsedTime().asMicroseconds();
+                if (gap.count() > 0) {
+                    std::this_thread::sleep_for(gap);
+                }
+            }
+        }));
+    }
+    double callUs = 0.;
+    for (std::size_t t = 0; t < numThreads; ++t) {
+        threads[t].join();
+        callUs += callTimes[t];
+    }
+    return callUs;
+}
+
+template<bool ASYNC>
+Result
+bench(std::size_t numThreads)
+{
+    const double messages = double(NUM_FRAMES * BURST * numThreads);
+    Result result;
+
+    // warm up (creates the rings / background thread)
+    logBurst<ASYNC>(0, 0);
+    flushAll<ASYNC>();
+
+    // the cost for the game loop
+    std::size_t dropped = numDropped<ASYNC>();
+    result.nsPerCall = run<ASYNC>(numThreads, FRAME_GAP) * 1000. / messages;
+    flushAll<ASYNC>();
+    result.burstDropped = numDropped<ASYNC>() - dropped;
+    dropped = numDropped<ASYNC>();
+
+    // the max throughput, until everything is written (the async backend
+    // drops what does not fit in the rings)
+    sf::Clock clock;
+    run<ASYNC>(numThreads, std::chrono::milliseconds(0));
+    flushAll<ASYNC>();
+    const double seconds = clock.getElapsedTime().asSeconds();
+    result.dropped = numDropped<ASYNC>() - dropped;
+    result.msgPerSecond = (messages - result.dropped) / seconds;
+    return result;
+}
+
+}
+
+int
+main(int argc, char *argv[])
+{
+    const std::size_t numThreads = (argc > 1) ? std::atoi(argv[1]) : 1;
+
+    const Result sync = bench<false>(numThreads);
+    const Result async = bench<true>(numThreads);
+
+    std::printf("%zu threads, %zu frames of %zu messages each\n", numThreads,
+                NUM_FRAMES, BURST);
+    std::printf("%-8s %10s %10s %16s %10s\n", "backend", "ns/call",
+                "dropped", "written msg/s", "dropped");
+    std::printf("%-8s %10.1f %10zu %16.0f %10zu\n", "sync", sync.nsPerCall,
+                sync.burstDropped, sync.msgPerSecond, sync.dropped);
+    std::printf("%-8s %10.1f %10zu %16.0f %10zu\n", "async", async.nsPerCall,
+                async.burstDropped, async.msgPerSecond, async.dropped);
+    return 0;
+}
@@ -0,0 +1,237 @@
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <FileManager.h>
+#include <BatchReader.h>
+
+
+// Level load: read all the assets of a folder (by default a generated one
+// with 600 files between 4 KB and 512 KB, 75 MB) with the serial
+// FileManager::readFileContent() and with the BatchReader (threads and
+// io_uring) and from a pack archive of the same files, with a cold page cache
+// (the pages of the files are dropped with posix_fadvise before each run) and
+// a warm one.
+//
+// Usage: read_bench [folder]
+
+namespace {
+
+const char *TREE = "./read_bench_tree";
+const char *PACK = "./read_bench.pack";
+const std::size_t NUM_FILES = 600;
+const std::size_t NUM_RUNS = 5;
+
+typedef std::chrono::steady_clock SteadyClock;
+
+struct Asset {
+    std::string path;
+    std::size_t size;
+};
+
+// create NUM_FILES files of 4 KB .. 512 KB
+bool
+createTree(const std::string &root, std::vector<Asset> &assets)
+{
+    ::mkdir(root.c_str(), 0755);
+    std::vector<char> data(512 << 10);
+    for (std::size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<char>(i * 131);
+    }
+    std::srand(7);
+    char path[512];
+    for (std::size_t i = 0; i < NUM_FILES; ++i) {
+        std::snprintf(path, sizeof(path), "%s/asset%zu.png", root.c_str(), i);
+        Asset asset;
+        asset.path = path;
+        asset.size = (4 << 10) << (std::rand() % 8);
+        assets.push_back(asset);
+
+        struct stat info;
+        if (::stat(path, &info) == 0 &&
+            static_cast<std::size_t>(info.st_size) == asset.size) {
+            continue;
+        }
+        const int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0 || ::write(fd, &data[0], asset.size) !=
+                          static_cast<ssize_t>(asset.size)) {
+            std::printf("Error creating %s\n", path);
+            return false;
+        }
+        // written back to the disk, so the pages can be dropped
+        ::fdatasync(fd);
+        ::close(fd);
+    }
+    return true;
+}
+
+// all the files of a folder tree
+bool
+listTree(const std::string &root, std::vector<Asset> &assets)
+{
+    DirScanner::Result result;
+    if (!FileManager::getInstance()->scanFolder(root, result)) {
+        return false;
+    }
+    for (std::size_t i = 0; i < result.files.size(); ++i) {
+        Asset asset;
+        asset.path = result.path(result.files[i]);
+        struct stat info;
+        if (::stat(asset.path.c_str(), &info) == 0 && S_ISREG(info.st_mode)) {
+            asset.size = info.st_size;
+            assets.push_back(asset);
+        }
+    }
+    return !assets.empty();
+}
+
+// drop the pages of the files from the page cache
+void
+dropCache(const std::vector<Asset> &assets)
+{
+    for (std::size_t i = 0; i < assets.size(); ++i) {
+        const int fd = ::open(assets[i].path.c_str(), O_RDONLY);
+        if (fd >= 0) {
+            ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+            ::close(fd);
+        }
+    }
+}
+
+// the best time of NUM_RUNS (ms)
+template<typename Fn>
+double
+measure(const std::vector<Asset> &assets, bool cold, Fn fn)
+{
+    double best = 1e30;
+    for (std::size_t r = 0; r <= NUM_RUNS; ++r) {
+        if (cold) {
+            dropCache(assets);
+        }
+        const SteadyClock::time_point begin = SteadyClock::now();
+        if (!fn()) {
+            std::printf("read failed\n");
+            std::exit(1);
+        }
+        const double ms = std::chrono::duration<double, std::milli>(
+            SteadyClock::now() - begin).count();
+        // the first warm run only fills the cache
+        if (cold || r > 0) {
+            best = std::min(best, ms);
+        }
+    }
+    return best;
+}
+
+}
+
+int
+main(int argc, char *argv[])
+{
+    std::vector<Asset> assets;
+    const std::string root = argc > 1 ? argv[1] : TREE;
+    if (argc > 1 ? !listTree(root, assets) : !createTree(root, assets)) {
+        return 1;
+    }
+
+    // the same files in an archive (named pack://<path in the folder>)
+    std::vector<PackArchive::Input> inputs;
+    std::vector<std::string> packNames;
+    for (std::size_t i = 0; i < assets.size(); ++i) {
+        PackArchive::Input input;
+        input.path = assets[i].path;
+        input.name = input.path.substr(input.path.find('/', root.size()) + 1);
+        inputs.push_back(input);
+        packNames.push_back(FileManager::PACK_PREFIX + input.name);
+    }
+    if (!PackArchive::build(PACK, inputs, false)) {
+        return 1;
+    }
+    std::vector<Asset> packFile(1);
+    packFile[0].path = PACK;
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < assets.size(); ++i) {
+        total += assets[i].size;
+    }
+    std::printf("%zu files, %.1f MB\n", assets.size(), total / 1048576.0);
+
+    // the buffers of the batch reads (one per file, as a level load would)
+    std::vector<std::vector<char> > buffers(assets.size());
+    std::vector<BatchReader::Request> requests;
+    for (std::size_t i = 0; i < assets.size(); ++i) {
+        buffers[i].resize(std::max<std::size_t>(assets[i].size, 1));
+        requests.push_back(BatchReader::Request(assets[i].path, &buffers[i][0],
+                                                assets[i].size));
+    }
+
+    BatchReader threads(BatchReader::BACKEND_THREADS, 64, 8);
+    BatchReader uring(BatchReader::BACKEND_URING, 64);
+    const bool hasUring = uring.backend() == BatchReader::BACKEND_URING;
+    if (!hasUring) {
+        std::printf("io_uring not available, skipped\n");
+    }
+
+    std::printf("%-26s %12s %12s\n", "", "cold (ms)", "warm (ms)");
+    for (int mode = 0; mode < 4; ++mode) {
+        if (mode == 2 && !hasUring) {
+            continue;
+        }
+        double ms[2];
+        for (int warm = 0; warm < 2; ++warm) {
+            if (mode == 3) {
+                // mounted in each run (the pages of a mapped file can't be
+                // dropped)
+                ms[warm] = measure(packFile, !warm, [&packNames]() {
+                    FileManager *fm = FileManager::getInstance();
+                    if (!fm->mountArchive(PACK)) {
+                        return false;
+                    }
+                    std::string content;
+                    for (std::size_t i = 0; i < packNames.size(); ++i) {
+                        if (!fm->readFileContent(packNames[i], content)) {
+                            return false;
+                        }
+                    }
+                    fm->unmountArchives();
+                    return true;
+                });
+            } else if (mode == 0) {
+                ms[warm] = measure(assets, !warm, [&assets]() {
+                    FileManager *fm = FileManager::getInstance();
+                    std::string content;
+                    for (std::size_t i = 0; i < assets.size(); ++i) {
+                        if (!fm->readFileContent(assets[i].path, content)) {
+                            return false;
+                        }
+                    }
+                    return true;
+                });
+            } else {
+                BatchReader &reader = (mode == 1) ? threads : uring;
+                ms[warm] = measure(assets, !warm, [&reader, &requests]() {
+                    return reader.read(requests);
+                });
+            }
+        }
+        static const char *NAMES[] = {"serial readFileContent",
+                                      "batch, 8 threads",
+                                      "batch, io_uring (depth 64)",
+                                      "serial, pack archive"};
+        std::printf("%-26s %12.2f %12.2f\n", NAMES[mode], ms[0], ms[1]);
+    }
+
+    for (std::size_t i = 0; i < requests.size(); ++i) {
+        if (requests[i].bytes != assets[i].size) {
+            std::printf("%s: read %zu of %zu bytes\n", assets[i].path.c_str(),
+                        requests[i].bytes, assets[i].size);
+            return 1;
+        }
+    }
+    return 0;
+}
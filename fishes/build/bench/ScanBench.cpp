@@ -0,0 +1,147 @@
+#include <set>
+#include <list>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <sys/stat.h>
+
+#include <FileManager.h>
+#include <DirScanner.h>
+
+
+// Compare listing all the .png files of an asset tree with the FileManager
+// (getAllFolders + getAllFiles of each folder, as autogenCmake does) against
+// the DirScanner with 1 and N threads. The page cache is hot (the first
+// run is not measured).
+//
+// Usage: scan_bench [folder]   (by default a tree of 40k files is created in
+//                               ./scan_bench_tree)
+
+namespace {
+
+const char *TREE = "./scan_bench_tree";
+const std::size_t NUM_TOP = 40;
+const std::size_t NUM_SUB = 10;
+const std::size_t NUM_FILES = 100;
+const std::size_t NUM_RUNS = 5;
+
+typedef std::chrono::steady_clock SteadyClock;
+
+// create NUM_TOP * NUM_SUB folders with NUM_FILES files (half of them .png)
+bool
+createTree(const std::string &root)
+{
+    struct stat info;
+    if (::stat(root.c_str(), &info) == 0) {
+        return true;
+    }
+    std::printf("creating %s...\n", root.c_str());
+    ::mkdir(root.c_str(), 0755);
+    char path[512];
+    for (std::size_t t = 0; t < NUM_TOP; ++t) {
+        std::snprintf(path, sizeof(path), "%s/top%zu", root.c_str(), t);
+        ::mkdir(path, 0755);
+        for (std::size_t s = 0; s < NUM_SUB; ++s) {
+            std::snprintf(path, sizeof(path), "%s/top%zu/sub%zu",
+                          root.c_str(), t, s);
+            ::mkdir(path, 0755);
+            for (std::size_t f = 0; f < NUM_FILES; ++f) {
+                std::snprintf(path, sizeof(path), "%s/top%zu/sub%zu/file%zu.%s",
+                              root.c_str(), t, s, f, (f & 1) ? "png" : "txt");
+                FILE *file = std::fopen(path, "w");
+                if (file == 0) {
+                    std::printf("Error creating %s\n", path);
+                    return false;
+                }
+                std::fclose(file);
+            }
+        }
+    }
+    return true;
+}
+
+std::size_t
+scanFileManager(const std::string &root, std::vector<std::string> &out)
+{
+    FileManager *fm = FileManager::getInstance();
+    std::list<std::string> folders, files, extensions;
+    extensions.push_back(".png");
+    fm->getAllFolders(root, folders);
+    for (std::list<std::string>::iterator it = folders.begin();
+         it != folders.end(); ++it) {
+        fm->getAllFiles(*it, files, extensions);
+        out.insert(out.end(), files.begin(), files.end());
+    }
+    return out.size();
+}
+
+std::size_t
+scanDir(const std::string &root, std::size_t numThreads,
+        std::vector<std::string> &out)
+{
+    DirScanner::Result result;
+    std::vector<std::string> extensions(1, ".png");
+    FileManager::getInstance()->scanFolder(root, result, extensions,
+                                           numThreads);
+    for (std::size_t i = 0; i < result.files.size(); ++i) {
+        out.push_back(result.path(result.files[i]));
+    }
+    return result.files.size();
+}
+
+// the best time of NUM_RUNS (ms), the files of the last one in out
+template<typename Fn>
+double
+measure(Fn fn, std::vector<std::string> &out)
+{
+    double best = 1e30;
+    for (std::size_t r = 0; r <= NUM_RUNS; ++r) {
+        out.clear();
+        const SteadyClock::time_point begin = SteadyClock::now();
+        fn(out);
+        const double ms = std::chrono::duration<double, std::milli>(
+            SteadyClock::now() - begin).count();
+        if (r > 0) {
+            best = std::min(best, ms);
+        }
+    }
+    std::sort(out.begin(), out.end());
+    return best;
+}
+
+}
+
+int
+main(int argc, char *argv[])
+{
+    const std::string root = (argc > 1) ? argv[1] : TREE;
+    if (argc == 1 && !createTree(root)) {
+        return 1;
+    }
+    const std::size_t numThreads =
+        std::max<unsigned int>(std::thread::hardware_concurrency(), 2);
+
+    std::vector<std::string> reference, files;
+    const double fmMs = measure([&root](std::vector<std::string> &out) {
+        scanFileManager(root, out);
+    }, reference);
+    std::printf("%-24s %10.2f ms %8zu files\n", "FileManager", fmMs,
+                reference.size());
+
+    for (std::size_t threads = 1; threads <= numThreads; threads *= 2) {
+        const double ms = measure([&root, threads](std::vector<std::string> &out) {
+            scanDir(root, threads, out);
+        }, files);
+        char name[64];
+        std::snprintf(name, sizeof(name), "DirScanner %zu thread%s", threads,
+                      threads > 1 ? "s" : "");
+        std::printf("%-24s %10.2f ms %8zu files (x%.1f)%s\n", name, ms,
+                    files.size(), fmMs / ms,
+                    files == reference ? "" : " DIFFERENT RESULT");
+    }
+    return 0;
+}
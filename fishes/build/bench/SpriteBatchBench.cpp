@@ -0,0 +1,114 @@
+#include <vector>
+#include <cstdio>
+#include <cstddef>
+#include <cmath>
+
+#include <SFML/System/Clock.hpp>
+#include <SFML/Graphics/Sprite.hpp>
+#include <SFML/Graphics/Texture.hpp>
+#include <ui/SpriteBatch.h>
+
+
+// Measure the vertex generation of the SpriteBatch (no window is needed) for
+// different number of sprites and fraction of sprites changing each frame,
+// and check that the generated quads match the sprites.
+//
+// Usage: batch_bench
+
+namespace {
+
+const std::size_t NUM_FRAMES = 100;
+const int CELL_SIZE = 64;
+
+// check that the quad of each sprite covers its global bounds and use its
+// texture rectangle
+bool
+checkVertices(const std::vector<sf::Sprite> &sprites,
+              const ui::SpriteBatch &batch)
+{
+    const sf::VertexArray &vertices = batch.vertices();
+    if (vertices.getVertexCount() != sprites.size() * 4) {
+        return false;
+    }
+    for (std::size_t i = 0; i < sprites.size(); ++i) {
+        const sf::FloatRect bounds = sprites[i].getGlobalBounds();
+        const sf::IntRect &rect = sprites[i].getTextureRect();
+        const sf::Vertex &first = vertices[i * 4];
+        const sf::Vertex &third = vertices[i * 4 + 2];
+        if (std::fabs(first.position.x - bounds.left) > 1e-3f ||
+            std::fabs(first.position.y - bounds.top) > 1e-3f ||
+            std::fabs(third.position.x - (bounds.left + bounds.width)) > 1e-3f ||
+            std::fabs(third.position.y - (bounds.top + bounds.height)) > 1e-3f ||
+            first.texCoords.x != rect.left ||
+            first.texCoords.y != rect.top ||
+            third.texCoords.x != rect.left + rect.width ||
+            third.texCoords.y != rect.top + rect.height) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+int main(void)
+{
+    // the texture is never uploaded, we only need its address
+    sf::Texture texture;
+
+    static const std::size_t COUNTS[] = {1000, 10000, 100000};
+    static const std::size_t CHANGE_EVERY[] = {100, 10, 1};
+    sf::Clock clock;
+    bool allOk = true;
+
+    std::printf("%10s %10s %14s %14s %14s %6s\n",
+                "sprites", "changed", "us/frame", "written/frame",
+                "reused/frame", "check");
+    for (std::size_t c = 0; c < sizeof(COUNTS) / sizeof(COUNTS[0]); ++c) {
+        const std::size_t count = COUNTS[c];
+        std::vector<sf::Sprite> sprites(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            sprites[i].setTexture(texture);
+            sprites[i].setTextureRect(
+                sf::IntRect((i % 6) * CELL_SIZE, 0, CELL_SIZE, CELL_SIZE));
+            sprites[i].setPosition(i % 800, (i / 800) % 600);
+        }
+
+        for (std::size_t e = 0; e < sizeof(CHANGE_EVERY) / sizeof(CHANGE_EVERY[0]); ++e) {
+            const std::size_t every = CHANGE_EVERY[e];
+            ui::SpriteBatch batch;
+            for (std::size_t i = 0; i < count; ++i) {
+                batch.add(sprites[i]);
+            }
+            batch.resetStats();
+
+            clock.restart();
+            for (std::size_t f = 0; f < NUM_FRAMES; ++f) {
+                // move some of them and change the frame of others
+                for (std::size_t i = f % every; i < count; i += every) {
+                    if (i & 1) {
+                        sprites[i].move(1.f, 0.f);
+                    } else {
+                        sf::IntRect rect = sprites[i].getTextureRect();
+                        rect.left = ((rect.left / CELL_SIZE + 1) % 6) * CELL_SIZE;
+                        sprites[i].setTextureRect(rect);
+                    }
+                }
+                batch.updateVertices();
+            }
+            const sf::Int64 us = clock.getElapsedTime().asMicroseconds();
+            const bool ok = checkVertices(sprites, batch);
+            allOk = allOk && ok;
+
+            const ui::SpriteBatch::Stats &stats = batch.stats();
+            std::printf("%10zu %9.0f%% %14.2f %14zu %14zu %6s\n",
+                        count, 100.0 / every,
+                        static_cast<double>(us) / NUM_FRAMES,
+                        stats.verticesWritten / NUM_FRAMES,
+                        stats.verticesReused / NUM_FRAMES,
+                        ok ? "ok" : "FAIL");
+        }
+    }
+
+    return allOk ? 0 : -1;
+}
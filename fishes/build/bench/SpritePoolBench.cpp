@@ -0,0 +1,237 @@
+#include <new>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstddef>
+
+#include <SFML/System/Clock.hpp>
+#include <memory/MemoryTracker.h>
+#include <ui/AnimatedSprite.h>
+#include <ui/AnimationSystem.h>
+#include <ui/SpritePool.h>
+
+
+// Simulate schools of fishes entering and leaving the tank: every frame some
+// sprites are destroyed and the same number created (and added to the
+// AnimationSystem). Compare allocating each sprite with new against the
+// SpritePool, counting the heap allocations done in the steady state.
+//
+// Usage: pool_bench [texture]
+
+namespace {
+
+#ifdef FISHES_MEMORY_TRACKING
+// the MemoryTracker already replaces operator new and counts everything
+inline std::size_t
+allocationCount(void)
+{
+    return memory::MemoryTracker::total().allocations;
+}
+#else
+// count all the allocations of the process (see operator new below)
+std::size_t sAllocations = 0;
+
+inline std::size_t
+allocationCount(void)
+{
+    return sAllocations;
+}
+#endif
+
+const std::size_t NUM_FRAMES = 300;
+const float TIME_FRAME = 1.f / 60.f;
+
+// small deterministic generator, the same sequence for both versions
+struct Random {
+    unsigned int state;
+    Random() : state(12345u) {}
+    std::size_t next(std::size_t max)
+    {
+        state = state * 1103515245u + 12345u;
+        return (state >> 8) % max;
+    }
+};
+
+void
+configureSprite(ui::AnimatedSprite &sprite, std::size_t i)
+{
+    sprite.setAnim(i % sprite.animationSet()->numAnims());
+    sprite.setLoop(true);
+}
+
+struct Result {
+    double usPerFrame;
+    double allocsPerFrame;
+};
+
+// new / delete each sprite
+Result
+benchHeap(const ui::AnimationSet::Ptr &set, std::size_t count, std::size_t churn)
+{
+    std::vector<ui::AnimatedSprite *> sprites;
+    ui::AnimationSystem system;
+    system.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        ui::AnimatedSprite *sprite = new ui::AnimatedSprite;
+        sprite->build(set);
+        system.add(*sprite);
+        configureSprite(*sprite, i);
+        sprites.push_back(sprite);
+    }
+
+    Random random;
+    sf::Clock clock;
+    const std::size_t allocations = allocationCount();
+    for (std::size_t f = 0; f < NUM_FRAMES; ++f) {
+        for (std::size_t c = 0; c < churn; ++c) {
+            const std::size_t i = random.next(sprites.size());
+            delete sprites[i];
+            sprites[i] = new ui::AnimatedSprite;
+            sprites[i]->build(set);
+            system.add(*sprites[i]);
+            configureSprite(*sprites[i], c);
+        }
+        system.update(TIME_FRAME);
+    }
+    Result result;
+    result.usPerFrame = clock.getElapsedTime().asMicroseconds() /
+        double(NUM_FRAMES);
+    result.allocsPerFrame = (allocationCount() - allocations) /
+        double(NUM_FRAMES);
+
+    for (std::size_t i = 0; i < sprites.size(); ++i) {
+        delete sprites[i];
+    }
+    return result;
+}
+
+// SpritePool
+Result
+benchPool(const ui::AnimationSet::Ptr &set, std::size_t count, std::size_t churn)
+{
+    ui::SpritePool pool(count);
+    std::vector<ui::SpritePool::Handle> handles;
+    handles.reserve(count);
+    ui::AnimationSystem system;
+    system.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        const ui::SpritePool::Handle handle = pool.spawn(set);
+        system.add(*pool.get(handle));
+        configureSprite(*pool.get(handle), i);
+        handles.push_back(handle);
+    }
+
+    Random random;
+    sf::Clock clock;
+    const std::size_t allocations = allocationCount();
+    for (std::size_t f = 0; f < NUM_FRAMES; ++f) {
+        for (std::size_t c = 0; c < churn; ++c) {
+            const std::size_t i = random.next(handles.size());
+            pool.despawn(handles[i]);
+            handles[i] = pool.spawn(set);
+            system.add(*pool.get(handles[i]));
+            configureSprite(*pool.get(handles[i]), c);
+        }
+        system.update(TIME_FRAME);
+    }
+    Result result;
+    result.usPerFrame = clock.getElapsedTime().asMicroseconds() /
+        double(NUM_FRAMES);
+    result.allocsPerFrame = (allocationCount() - allocations) /
+        double(NUM_FRAMES);
+    return result;
+}
+
+}
+
+#ifndef FISHES_MEMORY_TRACKING
+// count the allocations
+void *
+operator new(std::size_t size)
+{
+    ++sAllocations;
+    void *ptr = std::malloc(size ? size : 1);
+    if (ptr == 0) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+void
+operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+#endif
+
+namespace {
+
+// check that the handles not spawned or already despawned are rejected
+bool
+checkHandles(const ui::AnimationSet::Ptr &set)
+{
+    ui::SpritePool pool(4);
+    const ui::SpritePool::Handle none = {0, 0};
+    if (pool.isValid(none) || pool.get(none) != 0 || pool.despawn(none) ||
+        pool.size() != 0) {
+        std::printf("The pool accepted a handle never spawned\n");
+        return false;
+    }
+    const ui::SpritePool::Handle handle = pool.spawn(set);
+    if (!pool.isValid(handle) || !pool.despawn(handle) ||
+        pool.isValid(handle) || pool.get(handle) != 0 ||
+        pool.despawn(handle) || pool.size() != 0) {
+        std::printf("The pool accepted a despawned handle\n");
+        return false;
+    }
+    // the slot is reused with a new generation
+    const ui::SpritePool::Handle reused = pool.spawn(set);
+    if (reused.index != handle.index || pool.isValid(handle) ||
+        !pool.isValid(reused)) {
+        std::printf("The pool accepted a stale handle\n");
+        return false;
+    }
+    return true;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    const char *textFName = (argc > 1) ? argv[1] : "./mediaTest/6x3.png";
+
+    ui::AnimatedSprite proto;
+    if (!proto.build(textFName, 6, 3)) {
+        std::printf("Error building the sprite from %s\n", textFName);
+        return -1;
+    }
+    std::vector<ui::AnimatedSprite::AnimIndices> anims(3);
+    for (std::size_t i = 0; i < anims.size(); ++i) {
+        anims[i].begin = i * 6;
+        anims[i].end = i * 6 + 5;
+        anims[i].animTime = 0.5f + i;
+    }
+    proto.createAnimTable(anims);
+    const ui::AnimationSet::Ptr set = proto.animationSet();
+    if (!checkHandles(set)) {
+        return -1;
+    }
+
+    static const std::size_t COUNTS[] = {1000, 10000, 100000};
+    std::printf("%10s %10s %10s %14s %14s\n",
+                "sprites", "churn", "mode", "us/frame", "allocs/frame");
+    for (std::size_t c = 0; c < sizeof(COUNTS) / sizeof(COUNTS[0]); ++c) {
+        const std::size_t count = COUNTS[c];
+        const std::size_t churn = count / 100;
+        const Result heap = benchHeap(set, count, churn);
+        const Result pool = benchPool(set, count, churn);
+        std::printf("%10zu %10zu %10s %14.2f %14.2f\n",
+                    count, churn, "new", heap.usPerFrame, heap.allocsPerFrame);
+        std::printf("%10zu %10zu %10s %14.2f %14.2f\n",
+                    count, churn, "pool", pool.usPerFrame, pool.allocsPerFrame);
+        if (pool.allocsPerFrame != 0.) {
+            std::printf("The pool allocated memory in the steady state\n");
+            return -1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <utime.h>
+#include <sys/stat.h>
+
+#include <SFML/System/Clock.hpp>
+#include <SFML/Graphics/Image.hpp>
+#include <ui/TextureCache.h>
+#include <ui/TextureDiskCache.h>
+
+
+// Startup time of loading the textures: decoding the png every time (no disk
+// cache), the first launch with the disk cache (cold: decode + store) and the
+// next ones (warm: the pixels are mapped from the cache). Then one source is
+// touched to check that its stale entry is decoded again.
+//
+// Usage: texcache_bench [png ...]   (by default 32 generated 1024x1024 png
+//                                    in ./texcache_bench_media)
+
+namespace {
+
+const char *MEDIA = "./texcache_bench_media";
+const char *CACHE = "./texcache_bench_cache";
+const std::size_t NUM_TEXTURES = 32;
+const unsigned int SIZE = 1024;
+
+// generate some sprite sheets (noise + gradients, so they don't compress
+// to nothing)
+bool
+createMedia(std::vector<std::string> &files)
+{
+    ::mkdir(MEDIA, 0755);
+    std::srand(3);
+    for (std::size_t i = 0; i < NUM_TEXTURES; ++i) {
+        char path[256];
+        std::snprintf(path, sizeof(path), "%s/sheet%zu.png", MEDIA, i);
+        files.push_back(path);
+        struct stat info;
+        if (::stat(path, &info) == 0) {
+            continue;
+        }
+        sf::Image image;
+        image.create(SIZE, SIZE);
+        for (unsigned int y = 0; y < SIZE; ++y) {
+            for (unsigned int x = 0; x < SIZE; ++x) {
+                const sf::Uint8 noise = std::rand() & 0x1F;
+                image.setPixel(x, y, sf::Color(x + noise, y + i, x ^ y,
+                                               (x / 64 + y / 64) & 1 ? 255 : 0));
+            }
+        }
+        if (!image.saveToFile(path)) {
+            std::printf("Error creating %s\n", path);
+            return false;
+        }
+    }
+    return true;
+}
+
+// load all the textures (as a launch), returns the ms
+double
+loadAll(const std::vector<std::string> &files)
+{
+    std::vector<ui::TextureHandle> handles;
+    sf::Clock clock;
+    for (std::size_t i = 0; i < files.size(); ++i) {
+        handles.push_back(ui::TextureCache::getInstance()->get(files[i]));
+        if (handles.back().get() == 0) {
+            std::printf("Error loading %s\n", files[i].c_str());
+            std::exit(1);
+        }
+    }
+    return clock.getElapsedTime().asMicroseconds() / 1000.0;
+    // the handles are released here, so the next launch loads them again
+}
+
+void
+report(const char *name, double ms)
+{
+    ui::TextureDiskCache *cache = ui::TextureDiskCache::getInstance();
+    const ui::TextureDiskCache::Stats stats = cache->stats();
+    std::printf("%-26s %10.2f ms   %3zu hits %3zu misses %3zu stale %3zu stored\n",
+                name, ms, stats.hits, stats.misses, stats.stale, stats.stores);
+    cache->resetStats();
+}
+
+}
+
+int
+main(int argc, char *argv[])
+{
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i) {
+        files.push_back(argv[i]);
+    }
+    if (files.empty() && !createMedia(files)) {
+        return 1;
+    }
+
+    ui::TextureDiskCache *cache = ui::TextureDiskCache::getInstance();
+    report("decode (no disk cache)", loadAll(files));
+
+    // start with an empty cache
+    cache->setFolder(CACHE);
+    for (std::size_t i = 0; i < files.size(); ++i) {
+        std::remove(cache->entryPath(
+            ui::TextureCache::normalizePath(files[i])).c_str());
+    }
+    report("cold (decode + store)", loadAll(files));
+    for (int run = 0; run < 3; ++run) {
+        report("warm (mapped)", loadAll(files));
+    }
+
+    // an artist saves one of the sheets
+    if (::utime(files[0].c_str(), 0) != 0) {
+        std::printf("Error touching %s\n", files[0].c_str());
+        return 1;
+    }
+    report("one source touched", loadAll(files));
+    report("warm again", loadAll(files));
+    return 0;
+}
@@ -1,23 +1,83 @@
 #include <vector>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
 
 #include <SFML/Window.hpp>
 #include <SFML/Graphics.hpp>
 #include <ui/AnimatedSprite.h>
-
+#include <ui/SpriteBatch.h>
+#include <ui/SpatialGrid.h>
+#include <ui/AnimationClock.h>
+#include <ui/TextureDiskCache.h>
+#include <ui/HotReloader.h>
+#include <debug/Profiler.h>
+#include <debug/FlightRecorder.h>
+#include <memory/MemoryTracker.h>
+#include <FileManager.h>
+
+// the tank is much bigger than the window, only the visible fishes are
+// animated and drawn
+static const float TANK_WIDTH = 4000.f;
+static const float TANK_HEIGHT = 3000.f;
+static const std::size_t NUM_FISHES = 2000;
+static const float SCROLL_SPEED = 600.f;
+// where the profiler trace is written (key T)
+static const char *TRACE_FILE = "fishes_trace.json";
+// the last frames / loads / errors, decoded with extras/FlightDecoder
+static const char *FLIGHT_FILE = "fishes_flight.bin";
+// the shipping builds read the media from the archive (extras/PackTool:
+// "packTool -o mediaTest.pack mediaTest"), the loose files are used if there
+// is no archive
+static const char *PACK_FILE = "mediaTest.pack";
+// the decoded textures of the loose files (ui::TextureDiskCache)
+static const char *TEXTURE_CACHE_FOLDER = "fishes_texcache";
+
+// set the animation of all the fishes
+static void
+setAnim(std::vector<ui::AnimatedSprite> &fishes, std::size_t anim, bool loop)
+{
+    for (std::size_t i = 0; i < fishes.size(); ++i) {
+        fishes[i].setAnim(anim);
+        fishes[i].setLoop(loop);
+    }
+}
 
 
 int main()
 {
+    PROFILE_THREAD("main");
+    debug::FlightRecorder::getInstance()->open(FLIGHT_FILE);
     sf::RenderWindow window(sf::VideoMode(800, 600), "SFML works!");
     sf::Clock clock;
 
+    std::string mediaPath = "./mediaTest/";
+    if (std::ifstream(PACK_FILE).good() &&
+        FileManager::getInstance()->mountArchive(PACK_FILE)) {
+        mediaPath = FileManager::PACK_PREFIX;
+    }
+
+    ui::TextureDiskCache::getInstance()->setFolder(TEXTURE_CACHE_FOLDER);
+
+    // the media edited while running is reloaded (only the loose files)
+    ui::HotReloader reloader;
+    if (!FileManager::isPackPath(mediaPath)) {
+        reloader.watch(mediaPath);
+    }
+
     ui::AnimatedSprite sprite;
 
-    if (!sprite.build("./mediaTest/6x3.png", 6, 3)){
+    sf::Clock loadClock;
+    if (!sprite.build(mediaPath + "6x3.png", 6, 3)){
         std::cout << "Error building the sprite" << std::endl;
         return -1;
     }
+    const ui::TextureDiskCache::Stats diskStats =
+        ui::TextureDiskCache::getInstance()->stats();
+    std::cout << "Textures loaded in "
+        << loadClock.getElapsedTime().asSeconds() * 1000.f << " ms (cache: "
+        << diskStats.hits << " hits, " << diskStats.misses << " misses, "
+        << diskStats.stale << " stale)" << std::endl;
 
     // configure the animations
     ui::AnimatedSprite::AnimIndices anim;
@@ -35,39 +95,79 @@ int main()
     anim.animTime = 1.f;
     animVec.push_back(anim);
     sprite.createAnimTable(animVec);
-    sprite.setAnim(0);
-    sprite.setLoop(true);
-    sprite.setPosition(0,0);
+
+    // the fishes share the animation set, they are lazy: its frame is only
+    // computed when they are visible
+    MEMORY_TAG_SCOPE(UI);
+    std::vector<ui::AnimatedSprite> fishes(NUM_FISHES);
+    ui::SpatialGrid grid;
+    for (std::size_t i = 0; i < NUM_FISHES; ++i) {
+        fishes[i].build(sprite.animationSet());
+        fishes[i].setLazy(true);
+        fishes[i].setPosition(TANK_WIDTH * (std::rand() / float(RAND_MAX)),
+                              TANK_HEIGHT * (std::rand() / float(RAND_MAX)));
+        grid.add(fishes[i]);
+    }
+    setAnim(fishes, 0, true);
+
+    // all the visible sprites (sharing the texture) are drawn at once
+    ui::SpriteBatch batch;
+    std::vector<sf::Sprite *> visible;
+    sf::View view = window.getDefaultView();
+    ui::AnimationClock *animClock = ui::AnimationClock::getInstance();
 
     float lastTime = 0.f;
     // run the program as long as the window is open
     while (window.isOpen())
     {
+        // the events of the last frame go to the trace
+        debug::Profiler::getInstance()->flush();
+        PROFILE_SCOPE("frame");
+
+        // swap the edited assets between frames
+        reloader.update();
+
         // check all the window's events that were triggered since the last iteration of the loop
         sf::Event event;
-        while (window.pollEvent(event))
         {
-            // "close requested" event: we close the window
-            if (event.type == sf::Event::Closed)
-                window.close();
-
-            // check for input
-            if (event.type == sf::Event::KeyPressed){
-                switch(event.key.code){
-                case sf::Keyboard::Num1:
-                    sprite.setAnim(0);
-                    sprite.setLoop(true);
-                    break;
-                case sf::Keyboard::Num2:
-                    sprite.setAnim(1);
-                    sprite.setLoop(true);
-                    break;
-                case sf::Keyboard::Num3:
-                    sprite.setAnim(2);
-                    sprite.setLoop(false);
-                    break;
-                default:
-                    break;
+            PROFILE_SCOPE("events");
+            while (window.pollEvent(event))
+            {
+                // "close requested" event: we close the window
+                if (event.type == sf::Event::Closed)
+                    window.close();
+
+                // check for input
+                if (event.type == sf::Event::KeyPressed){
+                    switch(event.key.code){
+                    case sf::Keyboard::Num1:
+                        setAnim(fishes, 0, true);
+                        break;
+                    case sf::Keyboard::Num2:
+                        setAnim(fishes, 1, true);
+                        break;
+                    case sf::Keyboard::Num3:
+                        setAnim(fishes, 2, false);
+                        break;
+                    case sf::Keyboard::S:
+                        std::cout << "tested: " << grid.stats().tested
+                            << " culled: " << grid.stats().culled
+                            << " drawn: " << grid.stats().drawn << std::endl;
+                        grid.resetStats();
+                        break;
+                    case sf::Keyboard::M:
+                        memory::MemoryTracker::report(stdout);
+                        break;
+                    case sf::Keyboard::T:
+                        if (debug::Profiler::getInstance()->exportChromeTrace(
+                                TRACE_FILE)) {
+                            std::cout << "trace written to " << TRACE_FILE
+                                << std::endl;
+                        }
+                        break;
+                    default:
+                        break;
+                    }
                 }
             }
         }
@@ -78,15 +178,51 @@ int main()
         const float nowTime = clock.getElapsedTime().asSeconds();
         const float timeFrame = nowTime - lastTime;
         lastTime = nowTime;
+        FLIGHT_RECORD_FRAME(timeFrame);
 
+        // move around the tank with the arrows
+        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Left)) {
+            view.move(-SCROLL_SPEED * timeFrame, 0.f);
+        }
+        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Right)) {
+            view.move(SCROLL_SPEED * timeFrame, 0.f);
+        }
+        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Up)) {
+            view.move(0.f, -SCROLL_SPEED * timeFrame);
+        }
+        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Down)) {
+            view.move(0.f, SCROLL_SPEED * timeFrame);
+        }
+        window.setView(view);
 
-        sprite.update(timeFrame);
-        window.draw(sprite);
+        // only the fishes in the view are animated and drawn
+        animClock->advance(timeFrame);
+        {
+            PROFILE_SCOPE("cull");
+            grid.query(ui::SpatialGrid::viewRect(view), visible);
+        }
+        {
+            PROFILE_SCOPE("animate");
+            batch.clear();
+            for (std::size_t i = 0; i < visible.size(); ++i) {
+                // all the sprites of the grid are fishes
+                static_cast<ui::AnimatedSprite *>(visible[i])->evaluate();
+                batch.add(*visible[i]);
+            }
+        }
+        {
+            PROFILE_SCOPE("draw");
+            window.draw(batch);
+        }
 
         // window display all
-        window.display();
+        {
+            PROFILE_SCOPE("display");
+            window.display();
+        }
 
     }
 
+    debug::FlightRecorder::getInstance()->close();
     return 0;
 }
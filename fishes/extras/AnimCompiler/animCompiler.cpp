@@ -0,0 +1,119 @@
+/* Tool to compile the text description of the animated sheets into the
+ * binary animation library loaded by ui::AnimationLibrary (and used by
+ * AnimatedSprite::build(library, sheetName)). All the checks are done here so
+ * the game only maps the file.
+ *
+ * Usage:
+ *  animCompiler input.txt output.anim
+ *
+ * Input format (one command per line, '#' starts a comment):
+ *  sheet <name> <texture> <columns> <rows>
+ *  anim <name> <beginFrame> <endFrame> <seconds>
+ * The animations belong to the last sheet declared. The texture is relative
+ * to the output file folder.
+ *
+ * animCompiler.cpp
+ *
+ *  Created on: Mar 29, 2013
+ *      Author: agustin
+ */
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+#include <ui/AnimationLibrary.h>
+
+
+typedef ui::AnimationLibrary::SheetDef SheetDef;
+typedef ui::AnimationLibrary::AnimDef AnimDef;
+
+
+// Parse the input file
+static bool parse(const std::string &fName, std::vector<SheetDef> &sheets)
+{
+    std::ifstream is(fName.c_str());
+    if (!is.good()) {
+        std::cout << "Error opening " << fName << "\n";
+        return false;
+    }
+
+    bool ok = true;
+    std::string line;
+    for (unsigned int lineNum = 1; std::getline(is, line); ++lineNum) {
+        const std::size_t comment = line.find('#');
+        if (comment != std::string::npos) {
+            line.erase(comment);
+        }
+        std::istringstream ss(line);
+        std::string cmd;
+        if (!(ss >> cmd)) {
+            continue;
+        }
+
+        std::string extra;
+        if (cmd == "sheet") {
+            SheetDef sheet;
+            if (!(ss >> sheet.name >> sheet.texture >> sheet.numColumns >>
+                  sheet.numRows) || (ss >> extra)) {
+                std::cout << fName << ":" << lineNum << ": expected sheet "
+                        "<name> <texture> <columns> <rows>\n";
+                ok = false;
+                continue;
+            }
+            sheets.push_back(sheet);
+        } else if (cmd == "anim") {
+            AnimDef anim;
+            if (!(ss >> anim.name >> anim.begin >> anim.end >>
+                  anim.animTime) || (ss >> extra)) {
+                std::cout << fName << ":" << lineNum << ": expected anim "
+                        "<name> <beginFrame> <endFrame> <seconds>\n";
+                ok = false;
+                continue;
+            }
+            if (sheets.empty()) {
+                std::cout << fName << ":" << lineNum << ": anim without "
+                        "sheet\n";
+                ok = false;
+                continue;
+            }
+            sheets.back().anims.push_back(anim);
+        } else {
+            std::cout << fName << ":" << lineNum << ": unknown command " <<
+                    cmd << "\n";
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+int main(int argc, char **args)
+{
+    if (argc != 3) {
+        std::cout << "Usage: animCompiler input.txt output.anim\n";
+        return 1;
+    }
+
+    std::vector<SheetDef> sheets;
+    if (!parse(args[1], sheets)) {
+        return 1;
+    }
+    if (!ui::AnimationLibrary::validate(sheets)) {
+        std::cout << "Invalid animation definitions in " << args[1] << "\n";
+        return 1;
+    }
+    if (!ui::AnimationLibrary::save(args[2], sheets)) {
+        std::cout << "Error writing " << args[2] << "\n";
+        return 1;
+    }
+
+    std::size_t numAnims = 0;
+    for (std::size_t i = 0; i < sheets.size(); ++i) {
+        numAnims += sheets[i].anims.size();
+    }
+    std::cout << args[2] << ": " << sheets.size() << " sheets, " << numAnims <<
+            " animations\n";
+    return 0;
+}
@@ -0,0 +1,125 @@
+/*
+ * SkylinePacker.cpp
+ *
+ *  Created on: Mar 16, 2013
+ *      Author: agustin
+ */
+
+#include <cstddef>
+#include <cassert>
+
+#include "SkylinePacker.h"
+
+
+/******************************************************************************/
+SkylinePacker::SkylinePacker(int width, int height) :
+    mWidth(width)
+,   mHeight(height)
+,   mUsedArea(0)
+{
+    Node node = {0, 0, width};
+    mSkyline.push_back(node);
+}
+
+/******************************************************************************/
+SkylinePacker::~SkylinePacker()
+{
+
+}
+
+/******************************************************************************/
+int
+SkylinePacker::fitAt(std::size_t index, int width, int height) const
+{
+    const int x = mSkyline[index].x;
+    if (x + width > mWidth) {
+        return -1;
+    }
+
+    // the rectangle lays over all the nodes it covers
+    int y = 0;
+    int remaining = width;
+    for (std::size_t i = index; remaining > 0; ++i) {
+        assert(i < mSkyline.size());
+        if (mSkyline[i].y > y) {
+            y = mSkyline[i].y;
+        }
+        if (y + height > mHeight) {
+            return -1;
+        }
+        remaining -= mSkyline[i].width;
+    }
+    return y;
+}
+
+/******************************************************************************/
+bool
+SkylinePacker::insert(int width, int height, int &x, int &y)
+{
+    // find the lowest position (and the narrowest node in case of tie)
+    int bestY = -1;
+    int bestWidth = 0;
+    std::size_t bestIndex = 0;
+    for (std::size_t i = 0; i < mSkyline.size(); ++i) {
+        const int fitY = fitAt(i, width, height);
+        if (fitY < 0) {
+            continue;
+        }
+        if (bestY < 0 || fitY < bestY ||
+            (fitY == bestY && mSkyline[i].width < bestWidth)) {
+            bestY = fitY;
+            bestWidth = mSkyline[i].width;
+            bestIndex = i;
+        }
+    }
+    if (bestY < 0) {
+        return false;
+    }
+
+    x = mSkyline[bestIndex].x;
+    y = bestY;
+
+    // add the new node and cut the ones below it
+    Node node = {x, y + height, width};
+    mSkyline.insert(mSkyline.begin() + bestIndex, node);
+    for (std::size_t i = bestIndex + 1; i < mSkyline.size();) {
+        const Node &prev = mSkyline[i - 1];
+        Node &current = mSkyline[i];
+        if (current.x >= prev.x + prev.width) {
+            break;
+        }
+        const int shrink = prev.x + prev.width - current.x;
+        current.x += shrink;
+        current.width -= shrink;
+        if (current.width > 0) {
+            break;
+        }
+        mSkyline.erase(mSkyline.begin() + i);
+    }
+
+    // merge the nodes at the same height
+    for (std::size_t i = 0; i + 1 < mSkyline.size();) {
+        if (mSkyline[i].y == mSkyline[i + 1].y) {
+            mSkyline[i].width += mSkyline[i + 1].width;
+            mSkyline.erase(mSkyline.begin() + i + 1);
+        } else {
+            ++i;
+        }
+    }
+
+    mUsedArea += static_cast<long>(width) * height;
+    return true;
+}
+
+/******************************************************************************/
+int
+SkylinePacker::usedHeight(void) const
+{
+    int height = 0;
+    for (std::size_t i = 0; i < mSkyline.size(); ++i) {
+        if (mSkyline[i].y > height) {
+            height = mSkyline[i].y;
+        }
+    }
+    return height;
+}
@@ -0,0 +1,61 @@
+/*
+ * SkylinePacker.h
+ *
+ *  Created on: Mar 16, 2013
+ *      Author: agustin
+ */
+
+#ifndef SKYLINEPACKER_H_
+#define SKYLINEPACKER_H_
+
+#include <vector>
+#include <cstddef>
+
+
+// @brief Rectangle packer using the skyline bottom-left heuristic: the
+// rectangles are placed as low as possible over the "skyline" formed by the
+// top edges of the rectangles already placed.
+//
+class SkylinePacker
+{
+public:
+    SkylinePacker(int width, int height);
+    ~SkylinePacker();
+
+    // @brief Try to place a rectangle of size (width, height)
+    // @param   width, height   The size of the rectangle
+    // @param   x, y            The position where it was placed (output)
+    // @returns true if there was space, false otherwise
+    bool insert(int width, int height, int &x, int &y);
+
+    // @brief Returns the height used (the highest point of the skyline)
+    int usedHeight(void) const;
+
+    // @brief Returns the area of all the rectangles placed
+    inline long usedArea(void) const;
+
+private:
+    struct Node {
+        int x;
+        int y;
+        int width;
+    };
+
+    // @brief Returns the y where a rectangle of width can be placed starting
+    // at the node index, or -1 if it doesn't fit
+    int fitAt(std::size_t index, int width, int height) const;
+
+private:
+    int mWidth;
+    int mHeight;
+    long mUsedArea;
+    std::vector<Node> mSkyline;
+};
+
+inline long
+SkylinePacker::usedArea(void) const
+{
+    return mUsedArea;
+}
+
+#endif /* SKYLINEPACKER_H_ */
@@ -0,0 +1,255 @@
+/* Tool to pack a lot of sprite sheets (with the regular grid layout used by
+ * AnimatedSprite::build(textFName, numColumns, numRows)) into one or more
+ * atlas pages, generating also the binary index (ui::AtlasIndex) that maps
+ * (sheet, frame) to the sub-rectangle of the page.
+ *
+ * Usage:
+ *  atlasPacker [-s pageSize] [-p padding] -o outName sheet:cols:rows ...
+ *
+ * Generates outName_0.png, outName_1.png, ... and outName.atlas. The name
+ * of each sheet in the index is the file name of the sheet without the
+ * folder (i.e. "media/fish.png:6:3" -> "fish.png").
+ * All the frames of a sheet are put in the same page (a sprite use only one
+ * texture).
+ *
+ * atlasPacker.cpp
+ *
+ *  Created on: Mar 16, 2013
+ *      Author: agustin
+ */
+
+#include <list>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <cstdio>
+#include <iostream>
+#include <algorithm>
+
+#include <SFML/Graphics/Image.hpp>
+#include <ui/AtlasIndex.h>
+
+#include "SkylinePacker.h"
+
+
+struct SheetInfo {
+    std::string fName;
+    std::string name;
+    unsigned int numColumns;
+    unsigned int numRows;
+    int cellWidth;
+    int cellHeight;
+    sf::Image image;
+
+    // the result of the packing
+    std::size_t page;
+    std::vector<sf::IntRect> frames;
+};
+
+struct PageInfo {
+    SkylinePacker packer;
+    std::vector<std::size_t> sheets;
+
+    PageInfo(int size) : packer(size, size) {}
+};
+
+static int pageSize = 2048;
+static int padding = 1;
+
+
+// Parse "file:cols:rows"
+static bool parseSheet(const std::string &arg, SheetInfo &sheet)
+{
+    const std::size_t rowsPos = arg.find_last_of(':');
+    if (rowsPos == std::string::npos || rowsPos == 0) {
+        return false;
+    }
+    const std::size_t colsPos = arg.find_last_of(':', rowsPos - 1);
+    if (colsPos == std::string::npos) {
+        return false;
+    }
+    sheet.fName = arg.substr(0, colsPos);
+    sheet.numColumns = std::atoi(arg.substr(colsPos + 1, rowsPos - colsPos - 1).c_str());
+    sheet.numRows = std::atoi(arg.substr(rowsPos + 1).c_str());
+    const std::size_t slash = sheet.fName.find_last_of("/\\");
+    sheet.name = (slash == std::string::npos) ? sheet.fName :
+                                                sheet.fName.substr(slash + 1);
+    return sheet.numColumns > 0 && sheet.numRows > 0 && !sheet.fName.empty();
+}
+
+// Try to put all the frames of the sheet in the page, if not all of them fit
+// the page is not modified.
+static bool packSheet(SheetInfo &sheet, PageInfo &page)
+{
+    SkylinePacker backup = page.packer;
+    const std::size_t numFrames = sheet.numColumns * sheet.numRows;
+    sheet.frames.clear();
+    for (std::size_t i = 0; i < numFrames; ++i) {
+        int x, y;
+        if (!page.packer.insert(sheet.cellWidth + padding,
+                                sheet.cellHeight + padding, x, y)) {
+            page.packer = backup;
+            sheet.frames.clear();
+            return false;
+        }
+        sheet.frames.push_back(sf::IntRect(x, y, sheet.cellWidth,
+                                           sheet.cellHeight));
+    }
+    return true;
+}
+
+// Sort the sheets by height (tallest first) to improve the packing
+struct TallerFirst {
+    const std::vector<SheetInfo> *sheets;
+    bool operator()(std::size_t a, std::size_t b) const
+    {
+        return (*sheets)[a].cellHeight > (*sheets)[b].cellHeight;
+    }
+};
+
+int main(int argc, char **args)
+{
+    std::string outName;
+    std::vector<SheetInfo> sheets;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = args[i];
+        if (arg == "-s" && i + 1 < argc) {
+            pageSize = std::atoi(args[++i]);
+        } else if (arg == "-p" && i + 1 < argc) {
+            padding = std::atoi(args[++i]);
+        } else if (arg == "-o" && i + 1 < argc) {
+            outName = args[++i];
+        } else {
+            SheetInfo sheet;
+            if (!parseSheet(arg, sheet)) {
+                std::cout << "Invalid sheet " << arg << ", expected "
+                        "file:columns:rows\n";
+                return 1;
+            }
+            sheets.push_back(sheet);
+        }
+    }
+    if (outName.empty() || sheets.empty() || pageSize <= 0 || padding < 0) {
+        std::cout << "Usage: atlasPacker [-s pageSize] [-p padding] -o outName "
+                "sheet:cols:rows ...\n";
+        return 1;
+    }
+    // the index stores the sizes, names and layouts in 16 bits
+    if (static_cast<unsigned int>(pageSize) > ui::AtlasIndex::MAX_U16) {
+        std::cout << "The page size can't be bigger than "
+                << ui::AtlasIndex::MAX_U16 << "\n";
+        return 1;
+    }
+    for (std::size_t i = 0; i < sheets.size(); ++i) {
+        if (sheets[i].name.size() > ui::AtlasIndex::MAX_U16 ||
+            sheets[i].numColumns > ui::AtlasIndex::MAX_U16 ||
+            sheets[i].numRows > ui::AtlasIndex::MAX_U16) {
+            std::cout << "The name or the layout of " << sheets[i].fName
+                    << " is too big for the index\n";
+            return 1;
+        }
+    }
+
+    // load all the sheets
+    std::vector<std::size_t> order;
+    for (std::size_t i = 0; i < sheets.size(); ++i) {
+        SheetInfo &sheet = sheets[i];
+        if (!sheet.image.loadFromFile(sheet.fName)) {
+            std::cout << "Error loading " << sheet.fName << "\n";
+            return 1;
+        }
+        sheet.cellWidth = sheet.image.getSize().x / sheet.numColumns;
+        sheet.cellHeight = sheet.image.getSize().y / sheet.numRows;
+        if (sheet.cellWidth + padding > pageSize ||
+            sheet.cellHeight + padding > pageSize) {
+            std::cout << "The frames of " << sheet.fName << " are bigger than "
+                    "the page size\n";
+            return 1;
+        }
+        order.push_back(i);
+    }
+    TallerFirst tallerFirst;
+    tallerFirst.sheets = &sheets;
+    std::stable_sort(order.begin(), order.end(), tallerFirst);
+
+    // pack them, opening new pages when needed
+    std::list<PageInfo> pages;
+    for (std::size_t o = 0; o < order.size(); ++o) {
+        SheetInfo &sheet = sheets[order[o]];
+        std::size_t pageIndex = 0;
+        bool packed = false;
+        for (std::list<PageInfo>::iterator it = pages.begin();
+                it != pages.end() && !packed; ++it, ++pageIndex) {
+            if (packSheet(sheet, *it)) {
+                it->sheets.push_back(order[o]);
+                sheet.page = pageIndex;
+                packed = true;
+            }
+        }
+        if (!packed) {
+            pages.push_back(PageInfo(pageSize));
+            if (!packSheet(sheet, pages.back())) {
+                std::cout << "The sheet " << sheet.fName << " doesn't fit in "
+                        "one page, use a bigger page size\n";
+                return 1;
+            }
+            pages.back().sheets.push_back(order[o]);
+            sheet.page = pageIndex;
+        }
+    }
+
+    // write the pages (cropping the unused height) and the index
+    ui::AtlasIndex index;
+    std::size_t pageIndex = 0;
+    long usedArea = 0, totalArea = 0;
+    for (std::list<PageInfo>::iterator it = pages.begin(); it != pages.end();
+            ++it, ++pageIndex) {
+        const int height = std::max(1, it->packer.usedHeight());
+        sf::Image image;
+        image.create(pageSize, height, sf::Color(0, 0, 0, 0));
+        for (std::size_t s = 0; s < it->sheets.size(); ++s) {
+            const SheetInfo &sheet = sheets[it->sheets[s]];
+            for (std::size_t f = 0; f < sheet.frames.size(); ++f) {
+                const sf::IntRect source((f % sheet.numColumns) * sheet.cellWidth,
+                                         (f / sheet.numColumns) * sheet.cellHeight,
+                                         sheet.cellWidth,
+                                         sheet.cellHeight);
+                image.copy(sheet.image, sheet.frames[f].left,
+                           sheet.frames[f].top, source);
+            }
+        }
+
+        char suffix[32];
+        std::sprintf(suffix, "_%zu.png", pageIndex);
+        const std::string pageFName = outName + suffix;
+        if (!image.saveToFile(pageFName)) {
+            std::cout << "Error writing " << pageFName << "\n";
+            return 1;
+        }
+        // the page name is relative to the index
+        const std::size_t slash = pageFName.find_last_of("/\\");
+        index.addPage((slash == std::string::npos) ? pageFName :
+                                                     pageFName.substr(slash + 1),
+                      pageSize, height);
+
+        usedArea += it->packer.usedArea();
+        totalArea += static_cast<long>(pageSize) * height;
+    }
+    for (std::size_t i = 0; i < sheets.size(); ++i) {
+        const SheetInfo &sheet = sheets[i];
+        index.addSheet(sheet.name, sheet.page, sheet.numColumns, sheet.numRows);
+        for (std::size_t f = 0; f < sheet.frames.size(); ++f) {
+            index.addFrame(sheet.frames[f]);
+        }
+    }
+    if (!index.save(outName + ".atlas")) {
+        std::cout << "Error writing " << outName << ".atlas\n";
+        return 1;
+    }
+
+    std::cout << "Packed " << sheets.size() << " sheets in " << pages.size()
+            << " pages, " << (100.0 * usedArea / totalArea) << "% of the "
+            "area used\n";
+    return 0;
+}
@@ -0,0 +1,553 @@
+/*
+ * BatchReader.cpp
+ *
+ *  Created on: Apr 18, 2013
+ *      Author: agustin
+ */
+
+#include "BatchReader.h"
+
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+// io_uring needs the syscalls and the 5.6 headers (the probe and the openat,
+// read and close operations, that are enums, came with IORING_FEAT_RW_CUR_POS),
+// the running kernel is probed in Ring::supported()
+#if defined(__linux__) && defined(__NR_io_uring_setup) && \
+    defined(__NR_io_uring_enter) && defined(__NR_io_uring_register) && \
+    defined(__has_include)
+    #if __has_include(<linux/io_uring.h>)
+        #include <linux/io_uring.h>
+        #ifdef IORING_FEAT_RW_CUR_POS
+            #include <sys/mman.h>
+            #define BATCH_READER_URING
+        #endif
+    #endif
+#endif
+
+
+// auxiliar functions
+namespace {
+
+// @brief Blocking read of a whole request (the fallback)
+void
+readBlocking(BatchReader::Request &request)
+{
+    const int fd = ::open(request.path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        request.error = errno;
+        return;
+    }
+    while (request.bytes < request.capacity) {
+        const ssize_t n = ::read(fd, request.buffer + request.bytes,
+                                 request.capacity - request.bytes);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            request.error = errno;
+            break;
+        }
+        if (n == 0) {
+            break;
+        }
+        request.bytes += n;
+    }
+    ::close(fd);
+}
+
+// @brief Report a finished request
+inline bool
+finish(BatchReader::Request &request, const BatchReader::Callback &callback)
+{
+    if (request.error != 0) {
+        printf("Error reading file %s: %s\n", request.path.c_str(),
+               std::strerror(request.error));
+    }
+    if (callback) {
+        callback(request);
+    }
+    return request.error == 0;
+}
+
+}
+
+
+#ifdef BATCH_READER_URING
+
+// The submission and completion rings shared with the kernel
+struct BatchReader::Ring {
+    int fd;
+    unsigned *sqHead;
+    unsigned *sqTail;
+    unsigned *sqMask;
+    unsigned *sqArray;
+    unsigned sqEntries;
+    io_uring_sqe *sqes;
+    unsigned *cqHead;
+    unsigned *cqTail;
+    unsigned *cqMask;
+    io_uring_cqe *cqes;
+    // the mappings
+    void *sqPtr;
+    std::size_t sqSize;
+    void *cqPtr;
+    std::size_t cqSize;
+    std::size_t sqesSize;
+    // the sqes filled and not published yet
+    unsigned toSubmit;
+
+    Ring() : fd(-1), sqes(0), sqPtr(MAP_FAILED), cqPtr(MAP_FAILED),
+        toSubmit(0) {}
+    ~Ring() { destroy(); }
+
+    // @brief Create the ring, returns false if io_uring (or some of the
+    //        operations we need) is not supported
+    bool init(unsigned entries)
+    {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+        if (fd < 0) {
+            return false;
+        }
+        if (!supported()) {
+            destroy();
+            return false;
+        }
+
+        sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single) {
+            sqSize = cqSize = std::max(sqSize, cqSize);
+        }
+        sqPtr = ::mmap(0, sqSize, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (sqPtr == MAP_FAILED) {
+            destroy();
+            return false;
+        }
+        cqPtr = single ? sqPtr :
+            ::mmap(0, cqSize, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        void *sqesPtr = ::mmap(0, sqesSize, PROT_READ | PROT_WRITE,
+                               MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (cqPtr == MAP_FAILED || sqesPtr == MAP_FAILED) {
+            if (sqesPtr != MAP_FAILED) {
+                ::munmap(sqesPtr, sqesSize);
+            }
+            destroy();
+            return false;
+        }
+        sqes = static_cast<io_uring_sqe *>(sqesPtr);
+
+        char *sq = static_cast<char *>(sqPtr);
+        sqHead = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+        sqTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+        sqMask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+        sqEntries = params.sq_entries;
+        char *cq = static_cast<char *>(cqPtr);
+        cqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+        cqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+        cqMask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    void destroy(void)
+    {
+        if (sqes != 0) {
+            ::munmap(sqes, sqesSize);
+            sqes = 0;
+        }
+        if (cqPtr != MAP_FAILED && cqPtr != sqPtr) {
+            ::munmap(cqPtr, cqSize);
+        }
+        cqPtr = MAP_FAILED;
+        if (sqPtr != MAP_FAILED) {
+            ::munmap(sqPtr, sqSize);
+            sqPtr = MAP_FAILED;
+        }
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+
+    // @brief Check that the kernel knows openat, read and close (5.6+)
+    bool supported(void)
+    {
+        const unsigned numOps = 64;
+        std::vector<char> buffer(sizeof(io_uring_probe) +
+                                 numOps * sizeof(io_uring_probe_op), 0);
+        io_uring_probe *probe = reinterpret_cast<io_uring_probe *>(&buffer[0]);
+        if (::syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE,
+                      probe, numOps) < 0) {
+            return false;
+        }
+        const unsigned ops[] = {IORING_OP_OPENAT, IORING_OP_READ,
+                                IORING_OP_CLOSE};
+        for (unsigned i = 0; i < sizeof(ops) / sizeof(ops[0]); ++i) {
+            if (ops[i] > probe->last_op ||
+                !(probe->ops[ops[i]].flags & IO_URING_OP_SUPPORTED)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // @brief Get a cleared sqe to fill (there is always one, we never have
+    //        more operations in flight than entries)
+    io_uring_sqe *nextSqe(std::size_t userData)
+    {
+        const unsigned index = (*sqTail + toSubmit) & *sqMask;
+        io_uring_sqe *sqe = &sqes[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->user_data = userData;
+        sqArray[index] = index;
+        ++toSubmit;
+        return sqe;
+    }
+
+    // @brief Wait for at least one completion without submitting anything
+    bool wait(void)
+    {
+        return ::syscall(__NR_io_uring_enter, fd, 0, 1,
+                         IORING_ENTER_GETEVENTS, 0, 0) >= 0;
+    }
+
+    // @brief Submit the filled sqes and wait for at least one completion
+    bool submitAndWait(void)
+    {
+        // the kernel reads the filled sqes after it sees the new tail
+        __atomic_store_n(sqTail, *sqTail + toSubmit, __ATOMIC_RELEASE);
+        toSubmit = 0;
+        while (true) {
+            // the sqes not consumed by a previous call are submitted too
+            const unsigned pending = *sqTail -
+                __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+            const long r = ::syscall(__NR_io_uring_enter, fd, pending, 1,
+                                     IORING_ENTER_GETEVENTS, 0, 0);
+            if (r >= 0) {
+                return true;
+            }
+            if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                return false;
+            }
+        }
+    }
+};
+
+#else
+
+// No io_uring here, the threads are always used
+struct BatchReader::Ring {
+};
+
+#endif
+
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+BatchReader::readUring(std::vector<Request> &requests, const Callback &callback)
+{
+#ifdef BATCH_READER_URING
+    // Each file goes through open -> read (until EOF or the buffer is full)
+    // -> close, with only one operation in flight at once, so the ring never
+    // overflows with mQueueDepth files in flight.
+    enum Stage {
+        STAGE_OPEN = 0,
+        STAGE_READ,
+        STAGE_CLOSE,
+    };
+    struct State {
+        int fd;
+        Stage stage;
+        bool done;
+    };
+    std::vector<State> states(requests.size());
+    Ring &ring = *mRing;
+
+    std::size_t next = 0;
+    // the files with an operation queued
+    std::size_t inFlight = 0;
+    std::size_t finished = 0;
+    bool ok = true;
+
+    while (finished < requests.size()) {
+        // start as many files as we can
+        while (inFlight < mQueueDepth && next < requests.size()) {
+            Request &request = requests[next];
+            request.bytes = 0;
+            request.error = 0;
+            states[next].fd = -1;
+            states[next].stage = STAGE_OPEN;
+            states[next].done = false;
+            io_uring_sqe *sqe = ring.nextSqe(next);
+            sqe->opcode = IORING_OP_OPENAT;
+            sqe->fd = AT_FDCWD;
+            sqe->addr = reinterpret_cast<std::size_t>(request.path.c_str());
+            sqe->open_flags = O_RDONLY | O_CLOEXEC;
+            ++next;
+            ++inFlight;
+        }
+
+        if (!ring.submitAndWait()) {
+            printf("io_uring_enter failed: %s, using threads\n",
+                   std::strerror(errno));
+            break;
+        }
+
+        // handle all the completions
+        unsigned head = *ring.cqHead;
+        const unsigned tail = __atomic_load_n(ring.cqTail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head) {
+            const io_uring_cqe &cqe = ring.cqes[head & *ring.cqMask];
+            const std::size_t index = static_cast<std::size_t>(cqe.user_data);
+            const int res = cqe.res;
+            Request &request = requests[index];
+            State &state = states[index];
+
+            switch (state.stage) {
+            case STAGE_OPEN:
+                if (res < 0) {
+                    request.error = -res;
+                    ok = finish(request, callback) && ok;
+                    state.done = true;
+                    --inFlight;
+                    ++finished;
+                    continue;
+                }
+                state.fd = res;
+                state.stage = STAGE_READ;
+                break;
+            case STAGE_READ:
+                if (res < 0) {
+                    request.error = -res;
+                    state.stage = STAGE_CLOSE;
+                } else if (res == 0) {
+                    state.stage = STAGE_CLOSE;
+                } else {
+                    request.bytes += res;
+                }
+                break;
+            case STAGE_CLOSE:
+                if (res < 0 && request.error == 0) {
+                    request.error = -res;
+                }
+                ok = finish(request, callback) && ok;
+                state.fd = -1;
+                state.done = true;
+                --inFlight;
+                ++finished;
+                continue;
+            }
+
+            // the next operation of the file
+            if (state.stage == STAGE_READ && request.bytes >= request.capacity) {
+                state.stage = STAGE_CLOSE;
+            }
+            io_uring_sqe *sqe = ring.nextSqe(index);
+            sqe->fd = state.fd;
+            if (state.stage == STAGE_READ) {
+                sqe->opcode = IORING_OP_READ;
+                sqe->addr = reinterpret_cast<std::size_t>(request.buffer +
+                                                          request.bytes);
+                sqe->len = static_cast<unsigned>(
+                    std::min<std::size_t>(request.capacity - request.bytes,
+                                          1u << 30));
+                sqe->off = request.bytes;
+            } else {
+                sqe->opcode = IORING_OP_CLOSE;
+            }
+        }
+        __atomic_store_n(ring.cqHead, head, __ATOMIC_RELEASE);
+    }
+    if (finished == requests.size()) {
+        return ok;
+    }
+
+    // io_uring_enter failed. The kernel only takes the sqes in io_uring_enter
+    // (called from this thread), so the ones it didn't take are withdrawn,
+    // but it owns the buffers of the ones it took until they complete.
+    const unsigned sqHead = __atomic_load_n(ring.sqHead, __ATOMIC_ACQUIRE);
+    inFlight -= *ring.sqTail - sqHead;
+    __atomic_store_n(ring.sqTail, sqHead, __ATOMIC_RELEASE);
+    while (inFlight > 0) {
+        if (!ring.wait()) {
+            // the completions are posted anyway
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        unsigned head = *ring.cqHead;
+        const unsigned tail = __atomic_load_n(ring.cqTail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head) {
+            const io_uring_cqe &cqe = ring.cqes[head & *ring.cqMask];
+            const std::size_t index = static_cast<std::size_t>(cqe.user_data);
+            const int res = cqe.res;
+            Request &request = requests[index];
+            State &state = states[index];
+            --inFlight;
+            if (state.stage == STAGE_OPEN && res >= 0) {
+                state.fd = res;
+            } else if (state.stage == STAGE_OPEN ||
+                       state.stage == STAGE_CLOSE) {
+                // the open failed / the file was read and closed
+                if (res < 0 && request.error == 0) {
+                    request.error = -res;
+                }
+                ok = finish(request, callback) && ok;
+                state.fd = -1;
+                state.done = true;
+            }
+        }
+        __atomic_store_n(ring.cqHead, head, __ATOMIC_RELEASE);
+    }
+
+    // close the files left open and read the rest with the threads (from
+    // the beginning)
+    std::vector<std::size_t> pending;
+    for (std::size_t i = 0; i < requests.size(); ++i) {
+        if (i < next && states[i].done) {
+            continue;
+        }
+        if (i < next && states[i].fd >= 0) {
+            ::close(states[i].fd);
+            // the read was already finished, only the close was missing
+            if (states[i].stage == STAGE_CLOSE) {
+                ok = finish(requests[i], callback) && ok;
+                continue;
+            }
+        }
+        requests[i].bytes = 0;
+        requests[i].error = 0;
+        pending.push_back(i);
+    }
+    return readThreads(requests, callback, &pending) && ok;
+#else
+    return readThreads(requests, callback);
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+BatchReader::readThreads(std::vector<Request> &requests,
+                         const Callback &callback,
+                         const std::vector<std::size_t> *pending)
+{
+    // the workers take the requests in order and queue the finished ones,
+    // the callbacks are called here
+    std::atomic<std::size_t> next(0);
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::vector<std::size_t> done;
+    const std::size_t count = (pending != 0) ? pending->size() :
+        requests.size();
+    if (count == 0) {
+        return true;
+    }
+
+    const std::size_t numThreads =
+        std::max<std::size_t>(1, std::min(mNumThreads, count));
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < numThreads; ++i) {
+        threads.push_back(std::thread([&]() {
+            while (true) {
+                const std::size_t n = next.fetch_add(1);
+                if (n >= count) {
+                    return;
+                }
+                const std::size_t index = (pending != 0) ? (*pending)[n] : n;
+                Request &request = requests[index];
+                request.bytes = 0;
+                request.error = 0;
+                readBlocking(request);
+                std::lock_guard<std::mutex> lock(mutex);
+                done.push_back(index);
+                condition.notify_one();
+            }
+        }));
+    }
+
+    bool ok = true;
+    std::vector<std::size_t> ready;
+    for (std::size_t finished = 0; finished < count; ) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (done.empty()) {
+                condition.wait(lock);
+            }
+            ready.swap(done);
+        }
+        for (std::size_t i = 0; i < ready.size(); ++i) {
+            ok = finish(requests[ready[i]], callback) && ok;
+        }
+        finished += ready.size();
+        ready.clear();
+    }
+
+    for (std::size_t i = 0; i < threads.size(); ++i) {
+        threads[i].join();
+    }
+    return ok;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+BatchReader::BatchReader(Backend backend,
+                         std::size_t queueDepth,
+                         std::size_t numThreads) :
+    mBackend(BACKEND_THREADS)
+,   mQueueDepth(std::max<std::size_t>(queueDepth, 1))
+,   mNumThreads(std::max<std::size_t>(numThreads, 1))
+,   mRing(0)
+{
+#ifdef BATCH_READER_URING
+    if (backend != BACKEND_THREADS) {
+        mRing = new Ring;
+        if (mRing->init(static_cast<unsigned>(mQueueDepth))) {
+            mBackend = BACKEND_URING;
+            // the kernel can round the entries up, never down
+            mQueueDepth = std::min<std::size_t>(mQueueDepth, mRing->sqEntries);
+        } else {
+            delete mRing;
+            mRing = 0;
+        }
+    }
+#else
+    (void) backend;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+BatchReader::~BatchReader()
+{
+    delete mRing;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+BatchReader::read(std::vector<Request> &requests, const Callback &callback)
+{
+    if (requests.empty()) {
+        return true;
+    }
+    if (mBackend == BACKEND_URING) {
+        return readUring(requests, callback);
+    }
+    return readThreads(requests, callback);
+}
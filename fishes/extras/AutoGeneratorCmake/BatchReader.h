@@ -0,0 +1,116 @@
+/*
+ * BatchReader.h
+ *
+ *  Created on: Apr 18, 2013
+ *      Author: agustin
+ */
+
+#ifndef BATCHREADER_H_
+#define BATCHREADER_H_
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <functional>
+
+
+// @brief Reads a list of files at once (i.e. all the assets of a level) into
+// buffers given by the caller. On Linux the opens, reads and closes of all the
+// files are submitted together to the kernel with io_uring (raw syscalls, no
+// liburing needed), so the disk gets many requests at once instead of one
+// round trip per file. When io_uring is not available (old kernel, disabled by
+// the system, other platforms) a pool of threads doing blocking reads is used.
+//
+// The completions are reported on the calling thread (with both backends),
+// in the order they finish, not the order of the requests.
+//
+class BatchReader
+{
+public:
+    // The reading of one file
+    struct Request {
+        // the file to read
+        std::string path;
+        // where the content is read (given by the caller), at most
+        // capacity bytes are read
+        char *buffer;
+        std::size_t capacity;
+
+        // filled when finished: the bytes read and 0 or the errno
+        std::size_t bytes;
+        int error;
+
+        Request() : buffer(0), capacity(0), bytes(0), error(0) {}
+        Request(const std::string &p, char *b, std::size_t c) :
+            path(p), buffer(b), capacity(c), bytes(0), error(0) {}
+
+        // @brief Returns true if the file was read (completely if it
+        //        fits in the buffer)
+        inline bool ok(void) const { return error == 0; }
+    };
+
+    // Called for each finished request
+    typedef std::function<void (Request &)> Callback;
+
+    enum Backend {
+        BACKEND_AUTO = 0,   // io_uring if available, threads otherwise
+        BACKEND_URING,
+        BACKEND_THREADS,
+    };
+
+public:
+    // @brief Create the reader
+    // @param   backend     The backend to use, if io_uring is asked and it is
+    //                      not available the threads are used
+    // @param   queueDepth  The maximum files read at the same time
+    // @param   numThreads  The threads of the fallback pool
+    BatchReader(Backend backend = BACKEND_AUTO,
+                std::size_t queueDepth = 64,
+                std::size_t numThreads = 4);
+    ~BatchReader();
+
+    // @brief Read all the requests, blocks until all of them finished
+    // @param   requests    The files to read (their results are filled)
+    // @param   callback    Called (on this thread) each time one finishes
+    // @returns true if all the files were read, false if some failed (see
+    //          the error of each request)
+    bool read(std::vector<Request> &requests,
+              const Callback &callback = Callback());
+
+    // @brief Returns the backend really used (BACKEND_URING or
+    //        BACKEND_THREADS)
+    inline Backend backend(void) const;
+
+private:
+    // avoid copying
+    BatchReader(const BatchReader &);
+    BatchReader &operator=(const BatchReader &);
+
+    bool readUring(std::vector<Request> &requests, const Callback &callback);
+
+    // @brief Read the requests with the threads
+    // @param   pending     The indices of the requests to read (0 = all)
+    bool readThreads(std::vector<Request> &requests,
+                     const Callback &callback,
+                     const std::vector<std::size_t> *pending = 0);
+
+private:
+    struct Ring;
+
+    Backend mBackend;
+    std::size_t mQueueDepth;
+    std::size_t mNumThreads;
+    Ring *mRing;
+};
+
+
+// Inline implementations
+//
+
+inline BatchReader::Backend
+BatchReader::backend(void) const
+{
+    return mBackend;
+}
+
+#endif /* BATCHREADER_H_ */
@@ -0,0 +1,353 @@
+/*
+ * DirScanner.cpp
+ *
+ *  Created on: Apr 17, 2013
+ *      Author: agustin
+ */
+
+#include "DirScanner.h"
+
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+
+// auxiliar functions
+namespace {
+
+// The record returned by getdents64 (not exported by the libc headers)
+struct LinuxDirent64 {
+    std::uint64_t d_ino;
+    std::int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[1];
+};
+
+// The bytes read from a folder at once
+const std::size_t DENTS_SIZE = 32 << 10;
+// The roots may be links to a folder, but the links inside a tree are not
+// followed (they could make loops)
+const int ROOT_FLAGS = O_RDONLY | O_DIRECTORY | O_CLOEXEC;
+const int DIR_FLAGS = ROOT_FLAGS | O_NOFOLLOW;
+
+// Compare the entries by path
+struct PathLess {
+    const std::vector<char> &arena;
+    PathLess(const std::vector<char> &a) : arena(a) {}
+    bool operator()(const DirScanner::Entry &a, const DirScanner::Entry &b) const
+    {
+        return std::strcmp(&arena[a.offset], &arena[b.offset]) < 0;
+    }
+};
+
+// The state shared by the threads: the subtrees not taken yet
+class SharedQueue
+{
+public:
+    SharedQueue(const std::string &root) :
+        mRoot(root)
+    ,   mBusy(0)
+    ,   mIdle(0)
+    ,   mFailed(false)
+    {
+        mPending.push_back(root);
+    }
+
+    // @brief Returns true if some thread is waiting for work
+    inline bool hungry(void) const
+    {
+        return mIdle.load(std::memory_order_relaxed) > 0;
+    }
+
+    // @brief Give a subtree to the waiting threads
+    void push(const std::string &path)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mPending.push_back(path);
+        mCondition.notify_one();
+    }
+
+    // @brief Take a subtree, waits while the others can still share
+    // @returns false if everything was scanned
+    bool pop(std::string &path)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (mPending.empty() && mBusy > 0) {
+            mIdle.fetch_add(1, std::memory_order_relaxed);
+            mCondition.wait(lock);
+            mIdle.fetch_sub(1, std::memory_order_relaxed);
+        }
+        if (mPending.empty()) {
+            mCondition.notify_all();
+            return false;
+        }
+        path.swap(mPending.back());
+        mPending.pop_back();
+        ++mBusy;
+        return true;
+    }
+
+    // @brief A subtree (taken with pop()) was scanned
+    void done(void)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        --mBusy;
+        if (mBusy == 0 && mPending.empty()) {
+            mCondition.notify_all();
+        }
+    }
+
+    // @brief Returns true if path is the folder the scan started at (the
+    // subtrees pushed later are real folders, checked with d_type)
+    inline bool isRoot(const std::string &path) const { return path == mRoot; }
+
+    inline void fail(void) { mFailed.store(true, std::memory_order_relaxed); }
+    inline bool failed(void) const { return mFailed.load(); }
+
+private:
+    const std::string mRoot;
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::vector<std::string> mPending;
+    std::size_t mBusy;
+    std::atomic<std::size_t> mIdle;
+    std::atomic<bool> mFailed;
+};
+
+// Scans subtrees into its own result
+class Walker
+{
+public:
+    Walker(SharedQueue &queue, const std::vector<std::string> &extensions) :
+        mQueue(queue)
+    ,   mExtensions(extensions)
+    {}
+
+    // @brief Scan subtrees until there is nothing left
+    void run(void)
+    {
+        std::string root;
+        while (mQueue.pop(root)) {
+            const int fd = ::open(root.c_str(), mQueue.isRoot(root) ? ROOT_FLAGS : DIR_FLAGS);
+            if (fd < 0) {
+                printf("Error opening the folder %s\n", root.c_str());
+                mQueue.fail();
+            } else {
+                mPath = root;
+                walk(fd, 0);
+                ::close(fd);
+            }
+            mQueue.done();
+        }
+    }
+
+    DirScanner::Result result;
+
+private:
+    // @brief Add mPath (+ name) to the arena
+    DirScanner::Entry add(const char *name, std::size_t nameLen)
+    {
+        DirScanner::Entry entry;
+        entry.offset = static_cast<std::uint32_t>(result.arena.size());
+        result.arena.insert(result.arena.end(), mPath.begin(), mPath.end());
+        if (name != 0) {
+            if (mPath.empty() || mPath[mPath.size() - 1] != '/') {
+                result.arena.push_back('/');
+            }
+            result.arena.insert(result.arena.end(), name, name + nameLen);
+        }
+        entry.length = static_cast<std::uint32_t>(result.arena.size() -
+                                                   entry.offset);
+        result.arena.push_back('\0');
+        return entry;
+    }
+
+    // @brief Returns true if the name passes the extension filter
+    bool accepted(const char *name, std::size_t nameLen) const
+    {
+        if (mExtensions.empty()) {
+            return true;
+        }
+        for (std::size_t i = 0; i < mExtensions.size(); ++i) {
+            const std::string &ext = mExtensions[i];
+            if (nameLen >= ext.size() &&
+                std::memcmp(name + nameLen - ext.size(), ext.data(),
+                            ext.size()) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // @brief Scan the folder fd (its path is mPath)
+    void walk(int fd, std::size_t depth)
+    {
+        result.folders.push_back(add(0, 0));
+
+        // one buffer per level (we recurse while reading the folder)
+        if (mBuffers.size() <= depth) {
+            mBuffers.resize(depth + 1);
+        }
+        std::vector<char> &buffer = mBuffers[depth];
+        buffer.resize(DENTS_SIZE);
+
+        while (true) {
+            const long read = ::syscall(SYS_getdents64, fd, &buffer[0],
+                                        buffer.size());
+            if (read < 0) {
+                printf("Error reading the folder %s\n", mPath.c_str());
+                mQueue.fail();
+                return;
+            }
+            if (read == 0) {
+                return;
+            }
+            for (long pos = 0; pos < read; ) {
+                const LinuxDirent64 *dirent =
+                    reinterpret_cast<const LinuxDirent64 *>(&buffer[pos]);
+                pos += dirent->d_reclen;
+                const char *name = dirent->d_name;
+                if (name[0] == '.' &&
+                    (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                    continue;
+                }
+                const std::size_t nameLen = std::strlen(name);
+
+                // some file systems don't fill the type
+                unsigned char type = dirent->d_type;
+                if (type == DT_UNKNOWN) {
+                    struct stat info;
+                    if (::fstatat(fd, name, &info, AT_SYMLINK_NOFOLLOW) == 0) {
+                        type = S_ISDIR(info.st_mode) ? DT_DIR : DT_REG;
+                    }
+                }
+
+                if (type != DT_DIR) {
+                    if (accepted(name, nameLen)) {
+                        result.files.push_back(add(name, nameLen));
+                    }
+                    continue;
+                }
+
+                // give the subtree to a waiting thread or scan it here
+                const std::size_t pathLen = mPath.size();
+                if (mPath.empty() || mPath[pathLen - 1] != '/') {
+                    mPath += '/';
+                }
+                mPath.append(name, nameLen);
+                if (mQueue.hungry()) {
+                    mQueue.push(mPath);
+                } else {
+                    const int child = ::openat(fd, name, DIR_FLAGS);
+                    if (child < 0) {
+                        printf("Error opening the folder %s\n", mPath.c_str());
+                        mQueue.fail();
+                    } else {
+                        walk(child, depth + 1);
+                        ::close(child);
+                    }
+                }
+                mPath.resize(pathLen);
+            }
+        }
+    }
+
+private:
+    SharedQueue &mQueue;
+    const std::vector<std::string> &mExtensions;
+    // the path of the folder being scanned
+    std::string mPath;
+    // a deque, growing it keeps the references to the buffers in use
+    std::deque<std::vector<char> > mBuffers;
+};
+
+// Append the entries of other (rebasing its offsets)
+void
+appendEntries(std::vector<DirScanner::Entry> &dest,
+              const std::vector<DirScanner::Entry> &src,
+              std::uint32_t base)
+{
+    const std::size_t first = dest.size();
+    dest.insert(dest.end(), src.begin(), src.end());
+    for (std::size_t i = first; i < dest.size(); ++i) {
+        dest[i].offset += base;
+    }
+}
+
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+void
+DirScanner::Result::sort(void)
+{
+    std::sort(folders.begin(), folders.end(), PathLess(arena));
+    std::sort(files.begin(), files.end(), PathLess(arena));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+DirScanner::Result::clear(void)
+{
+    arena.clear();
+    folders.clear();
+    files.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+DirScanner::scan(const std::string &root,
+                 Result &result,
+                 const std::vector<std::string> &extensions,
+                 std::size_t numThreads)
+{
+    if (root.empty()) {
+        printf("Empty root folder\n");
+        return false;
+    }
+    std::string rootPath = root;
+    while (rootPath.size() > 1 && rootPath[rootPath.size() - 1] == '/') {
+        rootPath.resize(rootPath.size() - 1);
+    }
+
+    SharedQueue queue(rootPath);
+    numThreads = std::max<std::size_t>(numThreads, 1);
+    std::vector<Walker *> walkers;
+    for (std::size_t i = 0; i < numThreads; ++i) {
+        walkers.push_back(new Walker(queue, extensions));
+    }
+
+    // the calling thread is one of them
+    std::vector<std::thread> threads;
+    for (std::size_t i = 1; i < numThreads; ++i) {
+        threads.push_back(std::thread(&Walker::run, walkers[i]));
+    }
+    walkers[0]->run();
+    for (std::size_t i = 0; i < threads.size(); ++i) {
+        threads[i].join();
+    }
+
+    // merge all the results
+    for (std::size_t i = 0; i < walkers.size(); ++i) {
+        const Result &partial = walkers[i]->result;
+        const std::uint32_t base =
+            static_cast<std::uint32_t>(result.arena.size());
+        result.arena.insert(result.arena.end(), partial.arena.begin(),
+                            partial.arena.end());
+        appendEntries(result.folders, partial.folders, base);
+        appendEntries(result.files, partial.files, base);
+        delete walkers[i];
+    }
+    return !queue.failed();
+}
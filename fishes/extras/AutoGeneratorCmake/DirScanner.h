@@ -0,0 +1,75 @@
+/*
+ * DirScanner.h
+ *
+ *  Created on: Apr 17, 2013
+ *      Author: agustin
+ */
+
+#ifndef DIRSCANNER_H_
+#define DIRSCANNER_H_
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+
+// @brief Recursive scanner of big folder trees (the asset folders). The
+// folders are read with getdents64 and opened with openat relative to their
+// parent, the paths are stored one after the other in one buffer (the arena)
+// and the results are vectors of offsets, so scanning tens of thousands of
+// files takes a few allocations. The extension filter is applied while
+// scanning. The subtrees can be scanned by several threads (the order of the
+// results is not deterministic then, see Result::sort()).
+// The root may be a symbolic link to a folder, the links inside the tree are
+// listed as files, never followed.
+//
+class DirScanner
+{
+public:
+    // A path in the arena of the Result
+    struct Entry {
+        std::uint32_t offset;
+        std::uint32_t length;
+    };
+
+    struct Result {
+        // all the paths, NUL terminated
+        std::vector<char> arena;
+        // the folders (the root included) and the files
+        std::vector<Entry> folders;
+        std::vector<Entry> files;
+
+        // @brief Returns the path of an entry
+        inline const char *path(const Entry &entry) const
+        {
+            return &arena[entry.offset];
+        }
+
+        // @brief Sort the folders and the files by path
+        void sort(void);
+
+        // @brief Remove all (keeping the memory)
+        void clear(void);
+    };
+
+public:
+    // @brief Scan a folder tree
+    // @param   root        The root folder (the paths start with it)
+    // @param   result      Where the folders and files are added
+    // @param   extensions  Only the files ending with one of them are
+    //                      returned (i.e. ".png"), all if empty
+    // @param   numThreads  The threads used (1: the calling one only)
+    // @returns true on success, false if the root (or a folder) could not
+    //          be read
+    static bool scan(const std::string &root,
+                     Result &result,
+                     const std::vector<std::string> &extensions =
+                         std::vector<std::string>(),
+                     std::size_t numThreads = 1);
+
+private:
+    DirScanner();
+};
+
+#endif /* DIRSCANNER_H_ */
@@ -12,16 +12,28 @@
 #endif
 
 #include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <dirent.h>
 #include <errno.h>
+#include <cstring>
 #include <stdio.h>
+#include <set>
 #include <stack>
 #include <fstream>
 
 #include "FileManager.h"
 
+// the tool is also built alone (without the game include paths)
+#ifdef FISHES_MEMORY_TRACKING
+        #include <memory/MemoryTracker.h>
+#else
+        #define MEMORY_TAG_SCOPE(tag)
+#endif
+
 
 FileManager *FileManager::mInstance = 0;
+const char *FileManager::PACK_PREFIX = "pack://";
 
 FileManager *FileManager::getInstance(void)
 {
@@ -33,11 +45,54 @@ FileManager *FileManager::getInstance(void)
 }
 
 
+/******************************************************************************/
+bool FileManager::isPackPath(const std::string &fName)
+{
+        return fName.compare(0, std::strlen(PACK_PREFIX), PACK_PREFIX) == 0;
+}
+
+/******************************************************************************/
+const PackArchive *FileManager::findArchive(const std::string &fName,
+                std::string &entryName) const
+{
+        entryName.assign(fName, std::strlen(PACK_PREFIX), std::string::npos);
+        for(std::size_t i = mArchives.size(); i > 0; --i){
+                if(mArchives[i-1]->contains(entryName)){
+                        return mArchives[i-1];
+                }
+        }
+        return 0;
+}
+
+/******************************************************************************/
+bool FileManager::mountArchive(const std::string &fName)
+{
+        MEMORY_TAG_SCOPE(FILE_IO);
+        PackArchive *archive = new PackArchive;
+        if(!archive->open(fName)){
+                printf("Error mounting the archive %s\n", fName.c_str());
+                delete archive;
+                return false;
+        }
+        mArchives.push_back(archive);
+        return true;
+}
+
+/******************************************************************************/
+void FileManager::unmountArchives(void)
+{
+        for(std::size_t i = 0; i < mArchives.size(); ++i){
+                delete mArchives[i];
+        }
+        mArchives.clear();
+}
+
 /* Returns all the folders in a path */
 /******************************************************************************/
 bool FileManager::getFoldersList(const std::string &path,
                 std::list<std::string> &folders)
 {
+        MEMORY_TAG_SCOPE(FILE_IO);
         DIR *dp = NULL;
         struct dirent *dirp = NULL;
         std::string aux, absPath;
@@ -84,6 +139,7 @@ bool FileManager::getFoldersList(const std::string &path,
 bool FileManager::getAllFolders(const std::string &rootFolder,
                 std::list<std::string> &result)
 {
+        MEMORY_TAG_SCOPE(FILE_IO);
         std::stack<std::string> folderStack;
         std::list<std::string> auxList;
         std::string actualFolder;
@@ -124,52 +180,102 @@ bool FileManager::getAllFolders(const std::string &rootFolder,
 /******************************************************************************/
 bool FileManager::readFileContent(const std::string &fName, std::string &contents)
 {
-        char *buffer;
-        std::ifstream is;
-        int fLength = 0;
+        MEMORY_TAG_SCOPE(FILE_IO);
+        FileView view;
 
-        /* abrimos el archivo y lo leemos completo */
-        is.open(fName.c_str(), std::ios::binary );
-        if (!is.good()) {
-        	printf("Error openning file %s\n", fName.c_str());
+        if (!readFileView(fName, view, FileView::ACCESS_SEQUENTIAL)) {
                 return false;
         }
+        // only one copy, with the NULs
+        contents.assign(view.data(), view.size());
 
-        // obtenemos el tamaño y lemos todo
-        is.seekg (0, std::ios::end);
-        fLength = is.tellg();
-        is.seekg (0, std::ios::beg);
+        return true;
+}
 
-        // pedimos memoria
-        buffer = new char [fLength + 1];
-        buffer[fLength] = '\0';
-        // leemos
-        is.read (buffer,fLength);
+/******************************************************************************/
+bool FileManager::readFileView(const std::string &fName, FileView &view,
+                FileView::Access access)
+{
+        if(!isPackPath(fName)){
+                return view.open(fName, access);
+        }
 
-        if (is.fail()) {
-        	printf("error reading the file %s\n", fName.c_str());
-                delete[] buffer;
-                is.close();
+        std::string entryName;
+        const PackArchive *archive = findArchive(fName, entryName);
+        if(!archive){
+                printf("File %s not found in the archives\n", fName.c_str());
                 return false;
         }
+        return archive->read(entryName, view);
+}
 
+/******************************************************************************/
+bool FileManager::scanFolder(const std::string &rootFolder,
+                DirScanner::Result &result,
+                const std::vector<std::string> &extensions,
+                std::size_t numThreads)
+{
+        MEMORY_TAG_SCOPE(FILE_IO);
+        return DirScanner::scan(rootFolder, result, extensions, numThreads);
+}
 
-        is.close();
-        /*! FIXME: ineficiente! */
-        contents = buffer;
-        delete[] buffer;
+/******************************************************************************/
+bool FileManager::readFiles(std::vector<BatchReader::Request> &requests,
+                const BatchReader::Callback &callback)
+{
+        MEMORY_TAG_SCOPE(FILE_IO);
+        if(!mBatchReader){
+                mBatchReader = new BatchReader;
+        }
+        return mBatchReader->read(requests, callback);
+}
 
-        return true;
+/******************************************************************************/
+bool FileManager::watchFolder(const std::string &folder, bool recursive)
+{
+        if(isPackPath(folder)){
+                printf("The archives can't be watched: %s\n", folder.c_str());
+                return false;
+        }
+        MEMORY_TAG_SCOPE(FILE_IO);
+        if(!mFileWatcher){
+                mFileWatcher = new FileWatcher;
+        }
+        return mFileWatcher->addFolder(folder, recursive);
+}
+
+/******************************************************************************/
+void FileManager::unwatchFolders(void)
+{
+        if(mFileWatcher){
+                mFileWatcher->clear();
+        }
+}
+
+/******************************************************************************/
+bool FileManager::pollChanges(std::vector<std::string> &changed)
+{
+        if(!mFileWatcher){
+                changed.clear();
+                return false;
+        }
+        MEMORY_TAG_SCOPE(FILE_IO);
+        return mFileWatcher->poll(changed);
 }
 
 bool FileManager::getAllFiles(const std::string &folderPath, 
                               std::list<std::string> &result, 
                               const std::list<std::string> &extensions)
 {
+        MEMORY_TAG_SCOPE(FILE_IO);
         DIR *dp = NULL;
         struct dirent *dirp = NULL;
         std::string aux, absPath;
 
+        if(isPackPath(folderPath)){
+                return getAllPackFiles(folderPath, result, extensions);
+        }
+
         if((dp  = opendir(folderPath.c_str())) == NULL) {
                 return false;
         }
@@ -211,6 +317,43 @@ bool FileManager::getAllFiles(const std::string &folderPath,
         return true;
 }
 
+/* The files of a folder of the archives (no recursive) */
+/******************************************************************************/
+bool FileManager::getAllPackFiles(const std::string &folderPath,
+                                  std::list<std::string> &result,
+                                  const std::list<std::string> &extensions)
+{
+        // "pack://media/" -> "media/", "pack://" -> ""
+        std::string prefix(folderPath, std::strlen(PACK_PREFIX), std::string::npos);
+        if(!prefix.empty() && prefix[prefix.size()-1] != '/'){
+                prefix.append("/");
+        }
+
+        // the same file can be in several archives
+        std::set<std::string> files;
+        for(std::size_t i = 0; i < mArchives.size(); ++i){
+                const PackArchive &archive = *mArchives[i];
+                for(std::size_t j = 0; j < archive.size(); ++j){
+                        const std::string name = archive.name(j);
+                        if(name.compare(0, prefix.size(), prefix) != 0 ||
+                                        name.find('/', prefix.size()) != std::string::npos){
+                                continue;
+                        }
+                        bool accepted = extensions.empty();
+                        for(std::list<std::string>::const_iterator it = extensions.begin();
+                                        !accepted && it != extensions.end(); ++it){
+                                accepted = name.find(*it, prefix.size()) != std::string::npos;
+                        }
+                        if(accepted){
+                                files.insert(PACK_PREFIX + name);
+                        }
+                }
+        }
+
+        result.assign(files.begin(), files.end());
+        return true;
+}
+
 bool FileManager::writeFile(const std::string &fName, const std::string &data,
                 bool overwrite)
 {
@@ -239,5 +382,43 @@ bool FileManager::writeFile(const std::string &fName, const std::string &data,
         return true;
 }
 
+/******************************************************************************/
+bool FileManager::writeFileIfChanged(const std::string &fName,
+                const std::string &content, bool *written)
+{
+        MEMORY_TAG_SCOPE(FILE_IO);
+        if(written){
+                *written = false;
+        }
 
+        // compare with the current one (only if it has the same size)
+        struct stat info;
+        if(::stat(fName.c_str(), &info) == 0 && S_ISREG(info.st_mode) &&
+                        static_cast<std::size_t>(info.st_size) == content.size()){
+                FileView view;
+                if(content.empty() ||
+                                (view.open(fName, FileView::ACCESS_SEQUENTIAL) &&
+                                 std::memcmp(view.data(), content.data(),
+                                             content.size()) == 0)){
+                        return true;
+                }
+        }
 
+        // the rename replaces it at once
+        char suffix[32];
+        snprintf(suffix, sizeof(suffix), ".tmp%d", int(::getpid()));
+        const std::string tmpName = fName + suffix;
+        if(!writeFile(tmpName, content, true)){
+                ::unlink(tmpName.c_str());
+                return false;
+        }
+        if(::rename(tmpName.c_str(), fName.c_str()) != 0){
+                printf("Error renaming %s to %s\n", tmpName.c_str(), fName.c_str());
+                ::unlink(tmpName.c_str());
+                return false;
+        }
+        if(written){
+                *written = true;
+        }
+        return true;
+}
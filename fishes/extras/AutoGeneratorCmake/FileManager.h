@@ -10,6 +10,13 @@
 
 #include <list>
 #include <string>
+#include <vector>
+
+#include "FileView.h"
+#include "DirScanner.h"
+#include "BatchReader.h"
+#include "PackArchive.h"
+#include "FileWatcher.h"
 
 
 class FileManager {
@@ -26,19 +33,52 @@ public:
          */
         bool getAllFolders(const std::string &rootFolder, std::list<std::string> &result);
 
-        /* Read a file.
+        /* The files of the mounted archives are named "pack://<name in
+         * the archive>" (i.e. "pack://media/fish.png"), the functions that
+         * read files or list folders accept them as the loose ones. */
+        static const char *PACK_PREFIX;
+
+        /* Returns true if the name is of a file in an archive (pack://) */
+        static bool isPackPath(const std::string &fName);
+
+        /* Mount an archive (see PackArchive), its files are found with the
+         * pack:// names. If several archives have the same file, the last
+         * mounted wins (i.e. patches).
+         * RETURNS:
+         *              true            if success
+         *              false           otherwise
+         */
+        bool mountArchive(const std::string &fName);
+
+        /* Unmount all the archives */
+        void unmountArchives(void);
+
+        /* Read a file (binary files with NULs included).
          * RETURNS:
          *              true            if success
          *              false           otherwise
          */
         bool readFileContent(const std::string &fName, std::string &contents);
+
+        /* Get a view of the content of a file without copying it (the big
+         * files are memory mapped, see FileView, the stored files of the
+         * archives point to the mapped archive).
+         * REQUIRES:
+         *              access          how the content is going to be read
+         * RETURNS:
+         *              true            if success
+         *              false           otherwise
+         */
+        bool readFileView(const std::string &fName, FileView &view,
+                          FileView::Access access = FileView::ACCESS_SEQUENTIAL);
         
         /* Returns all the folders in a path */
         bool getFoldersList(const std::string &path, std::list<std::string> &folders);
         
         /* Get all the files that exists in some folder.
          * REQUIRES:
-         *              folderPath              the path of the folder
+         *              folderPath              the path of the folder (or
+         *                                      pack://folder)
          *              extensions              this is a filter (if is empty returns all the files)
          * RETURNS:
          *              true                    on success
@@ -48,6 +88,62 @@ public:
                          std::list<std::string> &result,  
                          const std::list<std::string> &extensions);
 
+        /* Get all the folders and files under "rootFolder" at once, much
+         * faster than getAllFolders() + getAllFiles() for big trees (see
+         * DirScanner).
+         * REQUIRES:
+         *              extensions      the files must end with one of them
+         *                              (all the files if it is empty)
+         *              numThreads      the threads used to scan subtrees
+         * RETURNS:
+         *              true            if success
+         *              false           otherwise
+         */
+        bool scanFolder(const std::string &rootFolder,
+                        DirScanner::Result &result,
+                        const std::vector<std::string> &extensions =
+                                std::vector<std::string>(),
+                        std::size_t numThreads = 1);
+
+        /* Read a list of files at once into the buffers of the requests
+         * (io_uring or a pool of threads, see BatchReader). Blocks until
+         * all of them are read.
+         * REQUIRES:
+         *              requests        the paths and buffers, the results
+         *                              are set when finished
+         *              callback        called for each finished file (on
+         *                              the calling thread), can be empty
+         * RETURNS:
+         *              true            if all the files were read
+         *              false           otherwise
+         */
+        bool readFiles(std::vector<BatchReader::Request> &requests,
+                       const BatchReader::Callback &callback =
+                                BatchReader::Callback());
+
+        /* Watch a folder tree for changed files (see FileWatcher), i.e. to
+         * reload the assets edited while the game is running. The pack://
+         * folders can't be watched.
+         * REQUIRES:
+         *              recursive       watch the subfolders too
+         * RETURNS:
+         *              true            if success
+         *              false           otherwise (or not supported)
+         */
+        bool watchFolder(const std::string &folder, bool recursive = true);
+
+        /* Stop watching all the folders */
+        void unwatchFolders(void);
+
+        /* Get the files changed in the watched folders since the last
+         * batch. The changes are debounced: a burst of saves is returned
+         * once, when it finishes. Never blocks (call it once per frame).
+         * RETURNS:
+         *              true            if there is a batch of changes
+         *              false           otherwise
+         */
+        bool pollChanges(std::vector<std::string> &changed);
+
          /* Writes a file. If the file already exists this ovterwrites the file
          * if and only if the flag overwrite is true TODO this functionality
          * RETURNS:
@@ -57,16 +153,47 @@ public:
         bool writeFile(const std::string &fName, const std::string &content,
                         bool overwrite = true);
 
+        /* Writes a file only if its content is different, so its
+         * modification time (i.e. for make / cmake) changes only when it
+         * really changed. The content is written to a temporary file and
+         * renamed over the old one, the readers never see it half written.
+         * REQUIRES:
+         *              written         set to true if the file was written
+         *                              (can be null)
+         * RETURNS:
+         *              true            if success (written or not needed)
+         *              false           otherwise
+         */
+        bool writeFileIfChanged(const std::string &fName,
+                                const std::string &content,
+                                bool *written = 0);
+
 
         
 
 private:
-        FileManager(){};
-        ~FileManager(){};
+        FileManager() : mBatchReader(0), mFileWatcher(0) {};
+        ~FileManager(){ unmountArchives(); delete mBatchReader;
+                        delete mFileWatcher; };
+
+        /* getAllFiles() of a pack:// folder */
+        bool getAllPackFiles(const std::string &folderPath,
+                             std::list<std::string> &result,
+                             const std::list<std::string> &extensions);
+
+        /* Returns the archive that has a pack:// file (the last mounted)
+         * and the name of the file in it, 0 if no one has it */
+        const PackArchive *findArchive(const std::string &fName,
+                                       std::string &entryName) const;
 
 
 private:
         static FileManager *mInstance;
+        // created the first time it is used
+        BatchReader *mBatchReader;
+        FileWatcher *mFileWatcher;
+        // the mounted archives
+        std::vector<PackArchive *> mArchives;
 
 };
 
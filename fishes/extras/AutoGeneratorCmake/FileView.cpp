@@ -0,0 +1,197 @@
+/*
+ * FileView.cpp
+ *
+ *  Created on: Apr 16, 2013
+ *      Author: agustin
+ */
+
+#include "FileView.h"
+
+#include <cstdio>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// the tool is also built alone (without the game include paths)
+#ifdef FISHES_MEMORY_TRACKING
+    #include <memory/MemoryTracker.h>
+#else
+    #define MEMORY_TAG_SCOPE(tag)
+#endif
+
+
+// auxiliar functions
+namespace {
+int
+adviceOf(FileView::Access access)
+{
+    switch (access) {
+    case FileView::ACCESS_SEQUENTIAL:   return MADV_SEQUENTIAL;
+    case FileView::ACCESS_RANDOM:       return MADV_RANDOM;
+    case FileView::ACCESS_WILLNEED:     return MADV_WILLNEED;
+    default:                            return MADV_NORMAL;
+    }
+}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+FileView::readAll(int fd, std::size_t size)
+{
+    mBuffer.resize(size);
+    std::size_t done = 0;
+    while (done < size) {
+        const ssize_t n = ::read(fd, &mBuffer[done], size - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            // the file was truncated while we read it
+            mBuffer.clear();
+            return false;
+        }
+        done += n;
+    }
+    mData = &mBuffer[0];
+    mSize = size;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+FileView::map(int fd, std::size_t size, Access access)
+{
+    void *map = ::mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+    // only a hint, nothing to do if it fails
+    ::madvise(map, size, adviceOf(access));
+    mMap = map;
+    mData = static_cast<const char *>(map);
+    mSize = size;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+FileView::FileView() :
+    mData(0)
+,   mSize(0)
+,   mMap(0)
+{
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+FileView::~FileView()
+{
+    close();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+FileView::FileView(FileView &&other) :
+    mData(other.mData)
+,   mSize(other.mSize)
+,   mMap(other.mMap)
+,   mBuffer(std::move(other.mBuffer))
+{
+    other.mData = 0;
+    other.mSize = 0;
+    other.mMap = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+FileView &
+FileView::operator=(FileView &&other)
+{
+    if (this != &other) {
+        close();
+        mData = other.mData;
+        mSize = other.mSize;
+        mMap = other.mMap;
+        mBuffer = std::move(other.mBuffer);
+        other.mData = 0;
+        other.mSize = 0;
+        other.mMap = 0;
+    }
+    return *this;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+FileView::open(const std::string &fName, Access access)
+{
+    MEMORY_TAG_SCOPE(FILE_IO);
+    close();
+
+    const int fd = ::open(fName.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        printf("Error opening file %s\n", fName.c_str());
+        return false;
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        printf("%s is not a regular file\n", fName.c_str());
+        ::close(fd);
+        return false;
+    }
+
+    const std::size_t size = static_cast<std::size_t>(info.st_size);
+    bool ok = true;
+    if (size >= MAP_THRESHOLD) {
+        ok = map(fd, size, access);
+    } else if (size > 0) {
+        ok = readAll(fd, size);
+    }
+    // the mapping keeps the file
+    ::close(fd);
+
+    if (!ok) {
+        printf("Error reading file %s\n", fName.c_str());
+        close();
+    }
+    return ok;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+FileView::close(void)
+{
+    if (mMap != 0) {
+        ::munmap(mMap, mSize);
+        mMap = 0;
+    }
+    // the buffer is kept to read the next small file without allocating
+    mBuffer.clear();
+    mData = 0;
+    mSize = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+FileView::borrow(const char *data, std::size_t size)
+{
+    close();
+    mData = data;
+    mSize = size;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+char *
+FileView::allocate(std::size_t size)
+{
+    MEMORY_TAG_SCOPE(FILE_IO);
+    close();
+    mBuffer.resize(size);
+    if (size == 0) {
+        return 0;
+    }
+    mSize = size;
+    mData = &mBuffer[0];
+    return &mBuffer[0];
+}
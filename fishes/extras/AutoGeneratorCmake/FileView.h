@@ -0,0 +1,135 @@
+/*
+ * FileView.h
+ *
+ *  Created on: Apr 16, 2013
+ *      Author: agustin
+ */
+
+#ifndef FILEVIEW_H_
+#define FILEVIEW_H_
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+
+// @brief Read only view of the whole content of a file, without copies. The
+// big files are memory mapped (the pages are read when they are touched, with
+// the access hint given to madvise), the small ones are read at once into a
+// buffer of their size (mapping them costs more than reading them).
+// The content is unmapped when the view is closed or destroyed (the buffer of
+// the small files is kept until destroyed, to be reused by the next open()).
+// The bytes are not NUL terminated (binary files can contain NULs).
+// A view can also point to memory of others (see borrow()).
+//
+class FileView
+{
+public:
+    // The files smaller than this are read, not mapped
+    static const std::size_t MAP_THRESHOLD = 256 << 10;
+
+    // How the content is going to be accessed (madvise hint)
+    enum Access {
+        ACCESS_NORMAL = 0,
+        ACCESS_SEQUENTIAL,  // read once from the begin to the end
+        ACCESS_RANDOM,      // read here and there (no read ahead)
+        ACCESS_WILLNEED,    // everything is going to be read soon
+    };
+
+public:
+    FileView();
+    ~FileView();
+
+    // the views can be moved but not copied
+    FileView(FileView &&other);
+    FileView &operator=(FileView &&other);
+
+    // @brief Open a file (closing the current one)
+    // @param   fName   The file name
+    // @param   access  The expected access
+    // @returns true on success, false otherwise
+    bool open(const std::string &fName, Access access = ACCESS_SEQUENTIAL);
+
+    // @brief Release the content (the views can be reused)
+    void close(void);
+
+    // @brief View memory owned by someone else (i.e. an entry of a mapped
+    //        PackArchive), it must outlive the view
+    void borrow(const char *data, std::size_t size);
+
+    // @brief Make the content a buffer of size bytes to be filled by the
+    //        caller (i.e. decompressed data)
+    // @returns the buffer
+    char *allocate(std::size_t size);
+
+    // @brief Returns the content (0 if empty) and its size
+    inline const char *data(void) const;
+    inline std::size_t size(void) const;
+    inline bool empty(void) const;
+
+    // @brief Returns true if the content is memory mapped
+    inline bool isMapped(void) const;
+
+    // @brief Iterators over the bytes
+    inline const char *begin(void) const;
+    inline const char *end(void) const;
+
+private:
+    // avoid copying
+    FileView(const FileView &);
+    FileView &operator=(const FileView &);
+
+    // @brief Read size bytes of fd into the buffer
+    bool readAll(int fd, std::size_t size);
+
+    // @brief Map size bytes of fd
+    bool map(int fd, std::size_t size, Access access);
+
+private:
+    const char *mData;
+    std::size_t mSize;
+    void *mMap;
+    std::vector<char> mBuffer;
+};
+
+
+// Inline implementations
+//
+
+inline const char *
+FileView::data(void) const
+{
+    return mData;
+}
+
+inline std::size_t
+FileView::size(void) const
+{
+    return mSize;
+}
+
+inline bool
+FileView::empty(void) const
+{
+    return mSize == 0;
+}
+
+inline bool
+FileView::isMapped(void) const
+{
+    return mMap != 0;
+}
+
+inline const char *
+FileView::begin(void) const
+{
+    return mData;
+}
+
+inline const char *
+FileView::end(void) const
+{
+    return mData + mSize;
+}
+
+#endif /* FILEVIEW_H_ */
@@ -0,0 +1,260 @@
+/*
+ * FileWatcher.cpp
+ *
+ *  Created on: Apr 21, 2013
+ *      Author: agustin
+ */
+
+#include "FileWatcher.h"
+
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <cstdint>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+    #include <sys/inotify.h>
+    #define FILE_WATCHER_INOTIFY
+#endif
+
+#include "DirScanner.h"
+
+
+// auxiliar functions
+namespace {
+
+#ifdef FILE_WATCHER_INOTIFY
+// the files are reported once they are closed (completely written) or moved
+// into the folder (the editors that save to a temporary file), the created
+// folders are watched
+const std::uint32_t WATCH_MASK = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE |
+    IN_ONLYDIR;
+#endif
+
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+FileWatcher::addWatch(const std::string &folder, bool recursive)
+{
+#ifdef FILE_WATCHER_INOTIFY
+    const int wd = ::inotify_add_watch(mFd, folder.c_str(), WATCH_MASK);
+    if (wd < 0) {
+        printf("Error watching %s: %s\n", folder.c_str(), std::strerror(errno));
+        return false;
+    }
+    // the same folder twice returns the same descriptor
+    Watch &watch = mWatches[wd];
+    watch.folder = folder;
+    watch.recursive = watch.recursive || recursive;
+    return true;
+#else
+    (void) folder;
+    (void) recursive;
+    return false;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+FileWatcher::readEvents(void)
+{
+#ifdef FILE_WATCHER_INOTIFY
+    alignas(struct inotify_event) char buffer[4096];
+    bool overflow = false;
+    for (;;) {
+        const ssize_t length = ::read(mFd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            // EAGAIN: nothing else queued
+            if (length < 0 && errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        for (ssize_t offset = 0; offset < length; ) {
+            const struct inotify_event *event =
+                reinterpret_cast<const struct inotify_event *>(buffer + offset);
+            offset += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                overflow = true;
+                continue;
+            }
+            WatchMap::iterator it = mWatches.find(event->wd);
+            if (it == mWatches.end()) {
+                continue;
+            }
+            if (event->mask & IN_IGNORED) {
+                // the folder was removed
+                mWatches.erase(it);
+                continue;
+            }
+            if (event->len == 0) {
+                continue;
+            }
+
+            const std::string path = it->second.folder + "/" + event->name;
+            if (event->mask & IN_ISDIR) {
+                // a new folder (created or moved) in a recursive watch, the
+                // files already in it (moved with it or written before it was
+                // watched) are changes too
+                DirScanner::Result tree;
+                if (it->second.recursive &&
+                    (event->mask & (IN_CREATE | IN_MOVED_TO)) &&
+                    DirScanner::scan(path, tree)) {
+                    for (std::size_t i = 0; i < tree.folders.size(); ++i) {
+                        addWatch(tree.path(tree.folders[i]), true);
+                    }
+                    for (std::size_t i = 0; i < tree.files.size(); ++i) {
+                        mPending.insert(tree.path(tree.files[i]));
+                    }
+                    mLastEvent = SteadyClock::now();
+                }
+                continue;
+            }
+            if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+                mPending.insert(path);
+                mLastEvent = SteadyClock::now();
+            }
+        }
+    }
+    if (overflow) {
+        printf("Too many file changes, reloading all the watched files\n");
+        rescan();
+    }
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+FileWatcher::rescan(void)
+{
+    for (std::size_t i = 0; i < mRoots.size(); ++i) {
+        const Watch &root = mRoots[i];
+        DirScanner::Result tree;
+        if (!DirScanner::scan(root.folder, tree)) {
+            printf("Error scanning %s\n", root.folder.c_str());
+            continue;
+        }
+        // the paths start with the root and '/' (the root "/" has it)
+        const std::size_t rootLen = root.folder.size() +
+            (root.folder[root.folder.size() - 1] == '/' ? 0 : 1);
+        if (root.recursive) {
+            // the folders created while the events were lost
+            for (std::size_t f = 0; f < tree.folders.size(); ++f) {
+                addWatch(tree.path(tree.folders[f]), true);
+            }
+        }
+        for (std::size_t f = 0; f < tree.files.size(); ++f) {
+            const char *path = tree.path(tree.files[f]);
+            // only the files directly inside if it is not recursive
+            if (root.recursive || std::strchr(path + rootLen, '/') == 0) {
+                mPending.insert(path);
+            }
+        }
+    }
+    mLastEvent = SteadyClock::now();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+FileWatcher::FileWatcher(unsigned int debounceMs) :
+    mFd(-1)
+,   mDebounce(debounceMs)
+{
+#ifdef FILE_WATCHER_INOTIFY
+    mFd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (mFd < 0) {
+        printf("inotify not available: %s\n", std::strerror(errno));
+    }
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+FileWatcher::~FileWatcher()
+{
+    if (mFd >= 0) {
+        ::close(mFd);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+FileWatcher::addFolder(const std::string &folder, bool recursive)
+{
+    if (!isAvailable()) {
+        return false;
+    }
+    std::string root = folder;
+    while (root.size() > 1 && root[root.size() - 1] == '/') {
+        root.erase(root.size() - 1);
+    }
+    if (!recursive) {
+        if (!addWatch(root, false)) {
+            return false;
+        }
+        Watch watch = {root, false};
+        mRoots.push_back(watch);
+        return true;
+    }
+
+    // all the folders of the tree (the root included)
+    DirScanner::Result result;
+    if (!DirScanner::scan(root, result)) {
+        printf("Error scanning %s\n", root.c_str());
+        return false;
+    }
+    bool ok = true;
+    for (std::size_t i = 0; i < result.folders.size(); ++i) {
+        ok = addWatch(result.path(result.folders[i]), true) && ok;
+    }
+    Watch watch = {root, true};
+    mRoots.push_back(watch);
+    return ok;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+FileWatcher::clear(void)
+{
+#ifdef FILE_WATCHER_INOTIFY
+    for (WatchMap::iterator it = mWatches.begin(); it != mWatches.end(); ++it) {
+        ::inotify_rm_watch(mFd, it->first);
+    }
+    // drop the events already queued
+    readEvents();
+#endif
+    mWatches.clear();
+    mRoots.clear();
+    mPending.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+FileWatcher::poll(std::vector<std::string> &changed)
+{
+    changed.clear();
+    if (!isAvailable()) {
+        return false;
+    }
+    readEvents();
+    if (mPending.empty() || SteadyClock::now() - mLastEvent < mDebounce) {
+        return false;
+    }
+    // the temporary files of the editors are already gone
+    for (std::set<std::string>::const_iterator it = mPending.begin();
+         it != mPending.end(); ++it) {
+        struct stat info;
+        if (::stat(it->c_str(), &info) == 0 && S_ISREG(info.st_mode)) {
+            changed.push_back(*it);
+        }
+    }
+    mPending.clear();
+    return !changed.empty();
+}
@@ -0,0 +1,108 @@
+/*
+ * FileWatcher.h
+ *
+ *  Created on: Apr 21, 2013
+ *      Author: agustin
+ */
+
+#ifndef FILEWATCHER_H_
+#define FILEWATCHER_H_
+
+#include <set>
+#include <map>
+#include <string>
+#include <vector>
+#include <chrono>
+
+
+// @brief Watches folder trees for changed files (i.e. the asset folders while
+// the artists work on them). On Linux it uses inotify: the files written
+// (closed after writing) or moved into the folders are reported, the folders
+// created inside a recursive watch are watched too. Editors usually save in
+// several steps (write a temporary file, rename it, touch it again...) so the
+// changes are debounced: they are collected and reported together once no
+// event arrived for the debounce time. If the kernel queue overflows (the
+// events are lost) all the files of the watched folders are reported.
+// It never blocks, poll() should be called periodically (i.e. once per
+// frame). On other platforms it is not available (addFolder() fails).
+//
+class FileWatcher
+{
+public:
+    // @param   debounceMs  The quiet time needed to report a batch
+    FileWatcher(unsigned int debounceMs = 200);
+    ~FileWatcher();
+
+    // @brief Returns true if the watcher can be used
+    inline bool isAvailable(void) const;
+
+    // @brief Watch a folder
+    // @param   folder      The folder (the reported paths start with it)
+    // @param   recursive   Watch all its subfolders too (and the new ones)
+    // @returns true on success, false otherwise
+    bool addFolder(const std::string &folder, bool recursive = true);
+
+    // @brief Stop watching everything (the pending changes are dropped)
+    void clear(void);
+
+    // @brief Read the pending events and return the batch of changed files
+    //        if it is complete (nothing changed during the debounce time)
+    // @param   changed     The changed files (sorted, without duplicates,
+    //                      only the ones that still exist)
+    // @returns true if a batch was returned, false if there is nothing yet
+    bool poll(std::vector<std::string> &changed);
+
+    // @brief Returns the number of watched folders
+    inline std::size_t numWatches(void) const;
+
+private:
+    // avoid copying
+    FileWatcher(const FileWatcher &);
+    FileWatcher &operator=(const FileWatcher &);
+
+    typedef std::chrono::steady_clock SteadyClock;
+
+    struct Watch {
+        std::string folder;
+        bool recursive;
+    };
+    typedef std::map<int, Watch> WatchMap;
+
+    // @brief Watch only one folder
+    bool addWatch(const std::string &folder, bool recursive);
+
+    // @brief Read all the events queued by the kernel
+    void readEvents(void);
+
+    // @brief Add all the files of the folders given to addFolder() to the
+    //        pending ones (and watch their new subfolders), used when some
+    //        events were lost
+    void rescan(void);
+
+private:
+    int mFd;
+    WatchMap mWatches;
+    // the folders given to addFolder()
+    std::vector<Watch> mRoots;
+    std::set<std::string> mPending;
+    SteadyClock::time_point mLastEvent;
+    std::chrono::milliseconds mDebounce;
+};
+
+
+// Inline implementations
+//
+
+inline bool
+FileWatcher::isAvailable(void) const
+{
+    return mFd >= 0;
+}
+
+inline std::size_t
+FileWatcher::numWatches(void) const
+{
+    return mWatches.size();
+}
+
+#endif /* FILEWATCHER_H_ */
@@ -0,0 +1,201 @@
+/*
+ * Lz4.cpp
+ *
+ *  Created on: Apr 19, 2013
+ *      Author: agustin
+ */
+
+#include "Lz4.h"
+
+#include <vector>
+#include <cstring>
+#include <cstdint>
+
+
+// auxiliar functions
+namespace {
+
+// The format rules: the matches are at least 4 bytes, the last 5 bytes are
+// always literals and the last match starts 12 bytes before the end at most
+const std::size_t MIN_MATCH = 4;
+const std::size_t LAST_LITERALS = 5;
+const std::size_t MF_LIMIT = 12;
+const std::size_t MAX_OFFSET = 65535;
+const unsigned int HASH_LOG = 14;
+
+inline std::uint32_t
+read32(const char *p)
+{
+    std::uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline unsigned int
+hash(std::uint32_t sequence)
+{
+    return (sequence * 2654435761u) >> (32 - HASH_LOG);
+}
+
+// @brief Write a length of 15 or more (after the 15 in the token)
+inline char *
+writeLength(char *op, std::size_t length)
+{
+    for (; length >= 255; length -= 255) {
+        *op++ = static_cast<char>(255);
+    }
+    *op++ = static_cast<char>(length);
+    return op;
+}
+
+// @brief Write a sequence (literals + match, without match if matchLength
+//        is 0)
+char *
+writeSequence(char *op, const char *literals, std::size_t numLiterals,
+              std::size_t offset, std::size_t matchLength)
+{
+    char *token = op++;
+    unsigned char value = 0;
+    if (numLiterals >= 15) {
+        value = 15 << 4;
+        op = writeLength(op, numLiterals - 15);
+    } else {
+        value = static_cast<unsigned char>(numLiterals << 4);
+    }
+    std::memcpy(op, literals, numLiterals);
+    op += numLiterals;
+
+    if (matchLength > 0) {
+        *op++ = static_cast<char>(offset & 0xFF);
+        *op++ = static_cast<char>(offset >> 8);
+        const std::size_t length = matchLength - MIN_MATCH;
+        if (length >= 15) {
+            value |= 15;
+            op = writeLength(op, length - 15);
+        } else {
+            value |= static_cast<unsigned char>(length);
+        }
+    }
+    *token = static_cast<char>(value);
+    return op;
+}
+
+// @brief Read the extension of a length, returns false at the end of input
+inline bool
+readLength(const unsigned char *&ip, const unsigned char *end,
+           std::size_t &length)
+{
+    unsigned char byte;
+    do {
+        if (ip >= end) {
+            return false;
+        }
+        byte = *ip++;
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t
+Lz4::compress(const char *src, std::size_t srcSize,
+              char *dst, std::size_t dstCapacity)
+{
+    if (dstCapacity < compressBound(srcSize)) {
+        return 0;
+    }
+    char *op = dst;
+    std::size_t anchor = 0;
+
+    if (srcSize > MF_LIMIT) {
+        // the last position seen of each hash of 4 bytes
+        std::vector<std::uint32_t> table(1u << HASH_LOG, 0);
+        const std::size_t limit = srcSize - MF_LIMIT;
+        const std::size_t matchLimit = srcSize - LAST_LITERALS;
+        std::size_t ip = 1;
+        table[hash(read32(src))] = 0;
+
+        while (ip < limit) {
+            const std::uint32_t sequence = read32(src + ip);
+            std::uint32_t &slot = table[hash(sequence)];
+            const std::size_t ref = slot;
+            slot = static_cast<std::uint32_t>(ip);
+            if (ip - ref > MAX_OFFSET || read32(src + ref) != sequence) {
+                ++ip;
+                continue;
+            }
+
+            std::size_t length = MIN_MATCH;
+            while (ip + length < matchLimit && src[ref + length] == src[ip + length]) {
+                ++length;
+            }
+            op = writeSequence(op, src + anchor, ip - anchor, ip - ref, length);
+            ip += length;
+            anchor = ip;
+        }
+    }
+
+    // the last literals
+    op = writeSequence(op, src + anchor, srcSize - anchor, 0, 0);
+    return op - dst;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+Lz4::decompress(const char *src, std::size_t srcSize,
+                char *dst, std::size_t dstSize)
+{
+    const unsigned char *ip = reinterpret_cast<const unsigned char *>(src);
+    const unsigned char *end = ip + srcSize;
+    std::size_t op = 0;
+
+    while (ip < end) {
+        const unsigned char token = *ip++;
+
+        // the literals
+        std::size_t numLiterals = token >> 4;
+        if (numLiterals == 15 && !readLength(ip, end, numLiterals)) {
+            return false;
+        }
+        if (numLiterals > static_cast<std::size_t>(end - ip) ||
+            numLiterals > dstSize - op) {
+            return false;
+        }
+        std::memcpy(dst + op, ip, numLiterals);
+        ip += numLiterals;
+        op += numLiterals;
+        if (ip == end) {
+            // the last sequence has no match
+            break;
+        }
+
+        // the match
+        if (end - ip < 2) {
+            return false;
+        }
+        const std::size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > op) {
+            return false;
+        }
+        std::size_t length = token & 15;
+        if (length == 15 && !readLength(ip, end, length)) {
+            return false;
+        }
+        length += MIN_MATCH;
+        if (length > dstSize - op) {
+            return false;
+        }
+        // it can overlap (byte by byte)
+        const char *ref = dst + op - offset;
+        char *out = dst + op;
+        for (std::size_t i = 0; i < length; ++i) {
+            out[i] = ref[i];
+        }
+        op += length;
+    }
+    return op == dstSize;
+}
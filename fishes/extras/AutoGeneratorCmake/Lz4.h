@@ -0,0 +1,52 @@
+/*
+ * Lz4.h
+ *
+ *  Created on: Apr 19, 2013
+ *      Author: agustin
+ */
+
+#ifndef LZ4_H_
+#define LZ4_H_
+
+#include <cstddef>
+
+
+// @brief Compressor / decompressor of the LZ4 block format (the same bytes
+// liblz4 produces and reads with LZ4_compress / LZ4_decompress_safe, without
+// depending on it). The compressor is the simple greedy one (fast, not the
+// best ratio), the decompressor checks all the bounds (the input can be a
+// corrupted file).
+//
+class Lz4
+{
+public:
+    // @brief Returns the max size of the compressed data of size bytes
+    static inline std::size_t compressBound(std::size_t size);
+
+    // @brief Compress src into dst
+    // @param   dst         At least compressBound(srcSize) bytes
+    // @returns the size of the compressed data, 0 on error
+    static std::size_t compress(const char *src, std::size_t srcSize,
+                                char *dst, std::size_t dstCapacity);
+
+    // @brief Decompress src into dst
+    // @param   dstSize     The exact size of the decompressed data
+    // @returns true on success, false if the data is corrupted
+    static bool decompress(const char *src, std::size_t srcSize,
+                           char *dst, std::size_t dstSize);
+
+private:
+    Lz4();
+};
+
+
+// Inline implementations
+//
+
+inline std::size_t
+Lz4::compressBound(std::size_t size)
+{
+    return size + size / 255 + 16;
+}
+
+#endif /* LZ4_H_ */
@@ -0,0 +1,335 @@
+/*
+ * PackArchive.cpp
+ *
+ *  Created on: Apr 19, 2013
+ *      Author: agustin
+ */
+
+#include "PackArchive.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "Lz4.h"
+
+// the tool is also built alone (without the game include paths)
+#ifdef FISHES_MEMORY_TRACKING
+    #include <memory/MemoryTracker.h>
+#else
+    #define MEMORY_TAG_SCOPE(tag)
+#endif
+
+
+// auxiliar functions
+namespace {
+
+const char MAGIC[8] = {'F', 'S', 'H', 'P', 'A', 'C', 'K', '\0'};
+
+// Sort the table of contents by (hash, name)
+struct TocLess {
+    const std::vector<char> &names;
+    TocLess(const std::vector<char> &n) : names(n) {}
+    bool operator()(const PackArchive::TocEntry &a,
+                    const PackArchive::TocEntry &b) const
+    {
+        if (a.hash != b.hash) {
+            return a.hash < b.hash;
+        }
+        return compare(&names[a.nameOffset], a.nameLength,
+                       &names[b.nameOffset], b.nameLength) < 0;
+    }
+    static int compare(const char *a, std::size_t aLen,
+                       const char *b, std::size_t bLen)
+    {
+        const int r = std::memcmp(a, b, std::min(aLen, bLen));
+        if (r != 0) {
+            return r;
+        }
+        return aLen < bLen ? -1 : (aLen > bLen ? 1 : 0);
+    }
+};
+
+// @brief Write zeros up to the next multiple of alignment
+bool
+pad(FILE *file, std::uint64_t &offset, std::size_t alignment)
+{
+    static const char zeros[4096] = {0};
+    std::size_t padding =
+        (alignment - (offset & (alignment - 1))) & (alignment - 1);
+    // any power of 2 is accepted, so it can be bigger than zeros
+    while (padding > 0) {
+        const std::size_t size = std::min(padding, sizeof(zeros));
+        if (std::fwrite(zeros, 1, size, file) != size) {
+            return false;
+        }
+        offset += size;
+        padding -= size;
+    }
+    return true;
+}
+
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+const PackArchive::TocEntry *
+PackArchive::find(const std::string &name) const
+{
+    const std::uint64_t hash = hashName(name.data(), name.size());
+    // the first entry with that hash
+    std::size_t begin = 0;
+    std::size_t count = mNumEntries;
+    while (count > 0) {
+        const std::size_t half = count / 2;
+        if (mToc[begin + half].hash < hash) {
+            begin += half + 1;
+            count -= half + 1;
+        } else {
+            count = half;
+        }
+    }
+    for (std::size_t i = begin; i < mNumEntries && mToc[i].hash == hash; ++i) {
+        if (mToc[i].nameLength == name.size() &&
+            std::memcmp(mNames + mToc[i].nameOffset, name.data(),
+                        name.size()) == 0) {
+            return &mToc[i];
+        }
+    }
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+PackArchive::PackArchive() :
+    mToc(0)
+,   mNumEntries(0)
+,   mNames(0)
+{
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+PackArchive::~PackArchive()
+{
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+PackArchive::open(const std::string &fName)
+{
+    close();
+    if (!mView.open(fName, FileView::ACCESS_NORMAL)) {
+        return false;
+    }
+
+    // check everything once, the lookups trust the table then
+    const std::uint64_t fileSize = mView.size();
+    const FileHeader *header = reinterpret_cast<const FileHeader *>(mView.data());
+    if (fileSize < sizeof(FileHeader) ||
+        std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        header->version != VERSION) {
+        printf("%s is not a pack archive (or of another version)\n",
+               fName.c_str());
+        close();
+        return false;
+    }
+    const std::uint64_t tocSize =
+        std::uint64_t(header->numEntries) * sizeof(TocEntry);
+    if (header->tocOffset % sizeof(std::uint64_t) != 0 ||
+        header->tocOffset > fileSize || tocSize > fileSize - header->tocOffset ||
+        header->namesOffset > fileSize ||
+        header->namesSize > fileSize - header->namesOffset) {
+        printf("Corrupted pack archive %s\n", fName.c_str());
+        close();
+        return false;
+    }
+    const TocEntry *toc =
+        reinterpret_cast<const TocEntry *>(mView.data() + header->tocOffset);
+    for (std::size_t i = 0; i < header->numEntries; ++i) {
+        const TocEntry &entry = toc[i];
+        const bool badData = entry.offset > fileSize ||
+            entry.size > fileSize - entry.offset ||
+            (!(entry.flags & FLAG_LZ4) && entry.size != entry.rawSize) ||
+            // LZ4 can't expand more than 255 times
+            ((entry.flags & FLAG_LZ4) && entry.rawSize / 255 > entry.size);
+        const bool badName = entry.nameOffset > header->namesSize ||
+            entry.nameLength > header->namesSize - entry.nameOffset;
+        const bool unsorted = i > 0 && toc[i - 1].hash > entry.hash;
+        if (badData || badName || unsorted) {
+            printf("Corrupted pack archive %s (entry %zu)\n", fName.c_str(), i);
+            close();
+            return false;
+        }
+    }
+
+    mFileName = fName;
+    mToc = toc;
+    mNumEntries = header->numEntries;
+    mNames = mView.data() + header->namesOffset;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+PackArchive::close(void)
+{
+    mView.close();
+    mFileName.clear();
+    mToc = 0;
+    mNumEntries = 0;
+    mNames = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+PackArchive::read(const std::string &name, FileView &view) const
+{
+    const TocEntry *entry = find(name);
+    if (entry == 0) {
+        return false;
+    }
+    const char *data = mView.data() + entry->offset;
+    if (mView.isMapped() && entry->size > 0) {
+        // start reading all the pages of the entry now
+        const std::size_t page = ::sysconf(_SC_PAGESIZE);
+        const std::size_t begin = entry->offset & ~(page - 1);
+        ::madvise(const_cast<char *>(mView.data()) + begin,
+                  entry->offset + entry->size - begin, MADV_WILLNEED);
+    }
+    if (!(entry->flags & FLAG_LZ4)) {
+        view.borrow(data, entry->size);
+        return true;
+    }
+
+    MEMORY_TAG_SCOPE(FILE_IO);
+    char *buffer = view.allocate(entry->rawSize);
+    if (!Lz4::decompress(data, entry->size, buffer, entry->rawSize)) {
+        printf("Corrupted entry %s in %s\n", name.c_str(), mFileName.c_str());
+        view.close();
+        return false;
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::uint64_t
+PackArchive::hashName(const char *name, std::size_t length)
+{
+    std::uint64_t hash = 14695981039346656037ull;
+    for (std::size_t i = 0; i < length; ++i) {
+        hash ^= static_cast<unsigned char>(name[i]);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+PackArchive::build(const std::string &fName,
+                   const std::vector<Input> &inputs,
+                   bool compress,
+                   std::size_t alignment)
+{
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        printf("The alignment must be a power of 2 (%zu)\n", alignment);
+        return false;
+    }
+    FILE *file = std::fopen(fName.c_str(), "wb");
+    if (file == 0) {
+        printf("Error creating %s\n", fName.c_str());
+        return false;
+    }
+
+    // the header is written at the end (when we know the offsets)
+    FileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::uint64_t offset = sizeof(header);
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+
+    // the data, in the order given (the files of a folder stay together)
+    std::vector<TocEntry> toc;
+    std::vector<char> names;
+    std::vector<char> compressed;
+    FileView view;
+    for (std::size_t i = 0; ok && i < inputs.size(); ++i) {
+        if (!view.open(inputs[i].path)) {
+            ok = false;
+            break;
+        }
+        TocEntry entry;
+        std::memset(&entry, 0, sizeof(entry));
+        entry.hash = hashName(inputs[i].name.data(), inputs[i].name.size());
+        entry.rawSize = view.size();
+        entry.nameOffset = static_cast<std::uint32_t>(names.size());
+        entry.nameLength = static_cast<std::uint32_t>(inputs[i].name.size());
+        names.insert(names.end(), inputs[i].name.begin(), inputs[i].name.end());
+
+        const char *data = view.data();
+        entry.size = view.size();
+        if (compress && !view.empty()) {
+            compressed.resize(Lz4::compressBound(view.size()));
+            const std::size_t size = Lz4::compress(view.data(), view.size(),
+                                                   &compressed[0],
+                                                   compressed.size());
+            // only if it is worth (the png are already compressed)
+            if (size > 0 && size < view.size() - view.size() / 16) {
+                data = &compressed[0];
+                entry.size = size;
+                entry.flags |= FLAG_LZ4;
+            }
+        }
+
+        // the data of the empty files is null
+        ok = pad(file, offset, alignment) &&
+            (entry.size == 0 ||
+             std::fwrite(data, 1, entry.size, file) == entry.size);
+        entry.offset = offset;
+        offset += entry.size;
+        toc.push_back(entry);
+    }
+
+    // the table of contents and the names
+    std::sort(toc.begin(), toc.end(), TocLess(names));
+    for (std::size_t i = 1; ok && i < toc.size(); ++i) {
+        if (!TocLess(names)(toc[i - 1], toc[i])) {
+            printf("Duplicated name in the archive: %s\n",
+                   std::string(&names[toc[i].nameOffset],
+                               toc[i].nameLength).c_str());
+            ok = false;
+        }
+    }
+    if (ok) {
+        ok = pad(file, offset, sizeof(std::uint64_t));
+        header.tocOffset = offset;
+        const std::size_t tocSize = toc.size() * sizeof(TocEntry);
+        ok = ok && (toc.empty() ||
+                    std::fwrite(&toc[0], 1, tocSize, file) == tocSize);
+        offset += tocSize;
+        header.namesOffset = offset;
+        header.namesSize = names.size();
+        ok = ok && (names.empty() ||
+                    std::fwrite(&names[0], 1, names.size(), file) == names.size());
+    }
+
+    // and the header
+    if (ok) {
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.numEntries = static_cast<std::uint32_t>(toc.size());
+        header.alignment = static_cast<std::uint32_t>(alignment);
+        ok = std::fseek(file, 0, SEEK_SET) == 0 &&
+            std::fwrite(&header, sizeof(header), 1, file) == 1;
+    }
+    ok = (std::fclose(file) == 0) && ok;
+    if (!ok) {
+        printf("Error writing the archive %s\n", fName.c_str());
+        std::remove(fName.c_str());
+    }
+    return ok;
+}
@@ -0,0 +1,161 @@
+/*
+ * PackArchive.h
+ *
+ *  Created on: Apr 19, 2013
+ *      Author: agustin
+ */
+
+#ifndef PACKARCHIVE_H_
+#define PACKARCHIVE_H_
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "FileView.h"
+
+
+// @brief Read only archive of asset files (built with the packTool), to ship
+// one file instead of thousands of loose ones. The archive is memory mapped
+// and the stored entries are served without copies (FileView::borrow), the
+// LZ4 compressed ones are decompressed into the view.
+//
+// File layout (little endian):
+//  FileHeader | entry data (each aligned) | TocEntry table | names
+// The table of contents is sorted by (hash of the name, name), so a lookup is
+// a binary search over the hashes. The names are the paths relative to the
+// packed folder, with '/' (i.e. "media/fish.png").
+//
+class PackArchive
+{
+public:
+    static const std::uint32_t VERSION = 1;
+    // the default alignment of the entries
+    static const std::size_t DEFAULT_ALIGNMENT = 16;
+
+    enum Flags {
+        FLAG_LZ4 = 1 << 0,      // the entry is compressed (LZ4 block)
+    };
+
+    struct FileHeader {
+        char magic[8];          // "FSHPACK\0"
+        std::uint32_t version;
+        std::uint32_t numEntries;
+        std::uint64_t tocOffset;
+        std::uint64_t namesOffset;
+        std::uint64_t namesSize;
+        std::uint32_t alignment;
+        std::uint32_t reserved[5];
+    };
+
+    struct TocEntry {
+        std::uint64_t hash;     // hashName(name)
+        std::uint64_t offset;   // of the data in the archive
+        std::uint64_t size;     // stored size
+        std::uint64_t rawSize;  // the size of the file
+        std::uint32_t nameOffset;
+        std::uint32_t nameLength;
+        std::uint32_t flags;
+        std::uint32_t reserved;
+    };
+
+    // A file to put in the archive (for build())
+    struct Input {
+        std::string name;       // the name in the archive
+        std::string path;       // the file to read
+    };
+
+public:
+    PackArchive();
+    ~PackArchive();
+
+    // @brief Open (map) an archive, checking all the table of contents
+    // @returns true on success, false if it can't be read or it is corrupted
+    bool open(const std::string &fName);
+
+    // @brief Close the archive (the views borrowed from it are invalid then)
+    void close(void);
+
+    inline bool isOpen(void) const;
+    inline const std::string &fileName(void) const;
+
+    // @brief Returns the number of entries
+    inline std::size_t size(void) const;
+
+    // @brief Returns the name of the entry i (sorted by hash, not by name)
+    inline std::string name(std::size_t i) const;
+
+    // @brief Returns true if there is an entry with that name
+    inline bool contains(const std::string &name) const;
+
+    // @brief Get the content of an entry (zero copy if not compressed)
+    // @returns true on success, false if not found / corrupted
+    bool read(const std::string &name, FileView &view) const;
+
+    // @brief The hash of the names (FNV-1a, 64 bits)
+    static std::uint64_t hashName(const char *name, std::size_t length);
+
+    // @brief Write an archive
+    // @param   fName       The archive to write
+    // @param   inputs      The files to put
+    // @param   compress    Compress the entries with LZ4 (each one is
+    //                      stored uncompressed if it doesn't get smaller)
+    // @param   alignment   The alignment of the entries (power of 2)
+    // @returns true on success, false otherwise
+    static bool build(const std::string &fName,
+                      const std::vector<Input> &inputs,
+                      bool compress,
+                      std::size_t alignment = DEFAULT_ALIGNMENT);
+
+private:
+    // avoid copying
+    PackArchive(const PackArchive &);
+    PackArchive &operator=(const PackArchive &);
+
+    // @brief Returns the entry of a name or 0
+    const TocEntry *find(const std::string &name) const;
+
+private:
+    std::string mFileName;
+    FileView mView;
+    const TocEntry *mToc;
+    std::size_t mNumEntries;
+    const char *mNames;
+};
+
+
+// Inline implementations
+//
+
+inline bool
+PackArchive::isOpen(void) const
+{
+    return !mView.empty();
+}
+
+inline const std::string &
+PackArchive::fileName(void) const
+{
+    return mFileName;
+}
+
+inline std::size_t
+PackArchive::size(void) const
+{
+    return mNumEntries;
+}
+
+inline std::string
+PackArchive::name(std::size_t i) const
+{
+    return std::string(mNames + mToc[i].nameOffset, mToc[i].nameLength);
+}
+
+inline bool
+PackArchive::contains(const std::string &name) const
+{
+    return find(name) != 0;
+}
+
+#endif /* PACKARCHIVE_H_ */
@@ -25,6 +25,13 @@ include_directories(${ACTUAL_DIRS})
 
  *
  *
+ * Uso: autogenCmake [-i] [-m manifest] root [root ...]
+ * Genera el AutoGen.cmake de cada root (dentro del path de
+ * SURY_FISHES_DEV_PATH). El archivo solo se reescribe si cambia su contenido.
+ * Con -i (incremental) se guarda en el manifest (por defecto
+ * autogenCmake.manifest) el mtime y los archivos de cada directorio, y solo se
+ * vuelven a leer los directorios que cambiaron desde la ultima corrida.
+ *
  * autogenCmake.cpp
  *
  *  Created on: 29/08/2011
@@ -33,11 +40,17 @@ include_directories(${ACTUAL_DIRS})
 
 #include <list>
 #include <map>
+#include <vector>
 #include <string>
-#include <cassert>
+#include <sstream>
 #include <iostream>
+#include <algorithm>
+#include <cstdint>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include <unistd.h>
+#include <sys/stat.h>
 
 
 #include "FileManager.h"
@@ -47,6 +60,13 @@ include_directories(${ACTUAL_DIRS})
 
 #define DEV_PATH_ENV_NAME		"SURY_FISHES_DEV_PATH"
 
+#define MANIFEST_HEADER			"# autogenCmake manifest v1"
+#define DEFAULT_MANIFEST		"autogenCmake.manifest"
+
+// the mtime of a directory changed less than this before the last scan is not
+// trusted (the file systems timestamps are coarse), it is read again
+#define RACY_MARGIN_NS			2000000000LL
+
 
 		// TODO: aca ponemos los folders que queremos evitar
 static std::string folderFilters[] = {
@@ -59,96 +79,248 @@ static std::string folderFilters[] = {
 };
 
 
-static std::string actualPath = "";
-static std::string envPath = "";
+// What we know of a directory: its mtime (changes when a file is added,
+// removed or renamed in it) and the names of its subfolders / files
+struct DirInfo {
+	std::int64_t mtime;
+	std::vector<std::string> folders;
+	std::vector<std::string> headers;
+	std::vector<std::string> sources;
+};
 
+// The directories of a root, by relative path ("." and "./sub/dir")
+struct RootInfo {
+	std::int64_t scanTime;
+	std::map<std::string, DirInfo> dirs;
+};
 
-static void getPathsWithoutTests(const char *path, std::list<std::string> &result)
-{
-	assert(path);
+// The manifest: all the roots by absolute path
+typedef std::map<std::string, RootInfo> Manifest;
 
-	result.clear();
-	assert(FileManager::getInstance()->getAllFolders(path, result));
 
-	std::list<std::string> aux;
-	int i = 0;
-	for(std::list<std::string>::iterator it = result.begin(); it != result.end();
-			++it){
-		i = 0;
-		while(folderFilters[i] != ""){
-			if(it->find(folderFilters[i]) != std::string::npos){
-				aux.push_back(*it);
-				break;
-			}
-			++i;
+static std::string envPath = "";
+
+
+static bool isFiltered(const std::string &relPath)
+{
+	for(int i = 0; folderFilters[i] != ""; ++i){
+		if(relPath.find(folderFilters[i]) != std::string::npos){
+			return true;
 		}
-		std::cout << "Folder: " << *it << "\n";
 	}
+	return false;
+}
 
-	for(std::list<std::string>::iterator it = aux.begin(); it != aux.end();
-			++it){
-		result.remove(*it);
-	}
+static std::int64_t nowNs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return std::int64_t(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
 }
 
+// the last component of a path
+static std::string baseName(const std::string &path)
+{
+	const size_t pos = path.find_last_of('/');
+	return (pos == std::string::npos) ? path : path.substr(pos + 1);
+}
 
-static void getSourcesAndHeaders(const std::list<std::string> &paths,
-								std::list<std::string> &headers,
-								std::list<std::string> &sources)
+static void baseNames(const std::list<std::string> &paths,
+					std::vector<std::string> &names)
 {
-	std::list<std::string> exts;
-	std::list<std::string> aux;
+	names.clear();
+	for(std::list<std::string>::const_iterator it = paths.begin(); it != paths.end(); ++it){
+		names.push_back(baseName(*it));
+	}
+	std::sort(names.begin(), names.end());
+}
 
+// read the subfolders and the sources / headers of one directory
+static bool readDir(const std::string &path, DirInfo &info)
+{
+	FileManager *fm = FileManager::getInstance();
+	std::list<std::string> aux;
+	std::list<std::string> exts;
 
-	std::cout << "Obteniendo Headers\n";
+	if(!fm->getFoldersList(path, aux)){
+		return false;
+	}
+	baseNames(aux, info.folders);
 
 	exts.push_back(".h");
-	headers.clear();
-	for(std::list<std::string>::const_iterator it = paths.begin(); it != paths.end(); ++it){
-		assert(FileManager::getInstance()->getAllFiles(*it, aux, exts));
+	if(!fm->getAllFiles(path, aux, exts)){
+		return false;
+	}
+	baseNames(aux, info.headers);
 
-		headers.insert(headers.begin(), aux.begin(), aux.end());
+	exts.clear();
+	exts.push_back(".cpp");
+	if(!fm->getAllFiles(path, aux, exts)){
+		return false;
 	}
+	baseNames(aux, info.sources);
+	return true;
+}
 
+// Walk the tree of a root. The directories whose mtime didn't change since
+// the old scan (if any) are taken from it, only the others are read.
+static bool scanRoot(const std::string &root, const RootInfo *old,
+					RootInfo &result, size_t &numRead)
+{
+	result.scanTime = nowNs();
+	result.dirs.clear();
+	numRead = 0;
+
+	std::vector<std::string> stack;
+	stack.push_back(".");
+	while(!stack.empty()){
+		const std::string rel = stack.back();
+		stack.pop_back();
+		// the subfolders of a filtered one have its name too
+		if(isFiltered(rel)){
+			continue;
+		}
 
-	std::cout << "Obteniendo Sources\n";
+		const std::string path = root + rel.substr(1);
+		struct stat st;
+		if(stat(path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)){
+			std::cout << "Error leyendo el directorio " << path << "\n";
+			return false;
+		}
+		const std::int64_t mtime = std::int64_t(st.st_mtim.tv_sec) *
+				1000000000LL + st.st_mtim.tv_nsec;
+
+		DirInfo &info = result.dirs[rel];
+		std::map<std::string, DirInfo>::const_iterator it;
+		if(old != 0 && (it = old->dirs.find(rel)) != old->dirs.end() &&
+				it->second.mtime == mtime &&
+				mtime + RACY_MARGIN_NS < old->scanTime){
+			info = it->second;
+		} else {
+			info.mtime = mtime;
+			if(!readDir(path, info)){
+				std::cout << "Error leyendo el directorio " << path << "\n";
+				return false;
+			}
+			++numRead;
+		}
 
-	exts.clear();
-	aux.clear();
-	exts.push_back(".cpp");
-	sources.clear();
-	for(std::list<std::string>::const_iterator it = paths.begin(); it != paths.end(); ++it){
-		assert(FileManager::getInstance()->getAllFiles(*it, aux, exts));
+		for(size_t i = 0; i < info.folders.size(); ++i){
+			stack.push_back(rel + "/" + info.folders[i]);
+		}
+	}
+	return true;
+}
 
-		sources.insert(sources.begin(), aux.begin(), aux.end());
+static bool loadManifest(const std::string &fName, Manifest &manifest)
+{
+	manifest.clear();
+	struct stat st;
+	if(stat(fName.c_str(), &st) != 0){
+		// first run
+		return true;
+	}
+	std::string content;
+	if(!FileManager::getInstance()->readFileContent(fName, content)){
+		return false;
 	}
 
+	std::istringstream is(content);
+	std::string line;
+	if(!std::getline(is, line) || line != MANIFEST_HEADER){
+		std::cout << fName << " no es un manifest valido, se ignora\n";
+		return true;
+	}
+	RootInfo *root = 0;
+	DirInfo *dir = 0;
+	while(std::getline(is, line)){
+		// "<tag> <value>" or "<tag> <number> <value>"
+		const size_t sp = line.find(' ');
+		if(sp == std::string::npos){
+			continue;
+		}
+		const std::string tag = line.substr(0, sp);
+		std::string value = line.substr(sp + 1);
+		if(tag == "root" || tag == "dir"){
+			const size_t sp2 = value.find(' ');
+			if(sp2 == std::string::npos){
+				continue;
+			}
+			const std::int64_t number = strtoll(value.c_str(), 0, 10);
+			value.erase(0, sp2 + 1);
+			if(tag == "root"){
+				root = &manifest[value];
+				root->scanTime = number;
+				dir = 0;
+			} else if(root != 0){
+				dir = &root->dirs[value];
+				dir->mtime = number;
+			}
+		} else if(dir != 0 && tag == "d"){
+			dir->folders.push_back(value);
+		} else if(dir != 0 && tag == "h"){
+			dir->headers.push_back(value);
+		} else if(dir != 0 && tag == "s"){
+			dir->sources.push_back(value);
+		}
+	}
+	return true;
 }
 
+static void buildManifest(const Manifest &manifest, std::string &out)
+{
+	std::ostringstream os;
+	os << MANIFEST_HEADER "\n";
+	for(Manifest::const_iterator r = manifest.begin(); r != manifest.end(); ++r){
+		os << "root " << r->second.scanTime << " " << r->first << "\n";
+		for(std::map<std::string, DirInfo>::const_iterator d = r->second.dirs.begin();
+				d != r->second.dirs.end(); ++d){
+			const DirInfo &info = d->second;
+			os << "dir " << info.mtime << " " << d->first << "\n";
+			for(size_t i = 0; i < info.folders.size(); ++i){
+				os << "d " << info.folders[i] << "\n";
+			}
+			for(size_t i = 0; i < info.headers.size(); ++i){
+				os << "h " << info.headers[i] << "\n";
+			}
+			for(size_t i = 0; i < info.sources.size(); ++i){
+				os << "s " << info.sources[i] << "\n";
+			}
+		}
+	}
+	out = os.str();
+}
 
-static void replaceListPaths(std::list<std::string> &l)
+// the paths (relative to the root, "/sub/dir/file.cpp") of all the
+// directories / headers / sources, sorted so the output is always the same
+static void getSourcesAndHeaders(const RootInfo &root,
+								std::list<std::string> &folders,
+								std::list<std::string> &headers,
+								std::list<std::string> &sources)
 {
-	size_t pos = 0;
-	for(std::list<std::string>::iterator it = l.begin(); it != l.end(); ++it){
-		pos = it->find(envPath);
-		if(pos != std::string::npos) {
-			it->replace(pos, envPath.size(), "");
+	folders.clear();
+	headers.clear();
+	sources.clear();
+	for(std::map<std::string, DirInfo>::const_iterator it = root.dirs.begin();
+			it != root.dirs.end(); ++it){
+		const std::string dir = (it->first == ".") ? "" : it->first.substr(1);
+		const DirInfo &info = it->second;
+		folders.push_back(it->first == "." ? "." : dir);
+		for(size_t i = 0; i < info.headers.size(); ++i){
+			headers.push_back(dir + "/" + info.headers[i]);
 		}
-		pos = it->find("./");
-		if(pos != std::string::npos) {
-			it->replace(pos, 2, "/");
+		for(size_t i = 0; i < info.sources.size(); ++i){
+			sources.push_back(dir + "/" + info.sources[i]);
 		}
 	}
 }
 
 static void constructOutput(std::string &out,
+		const std::string &actualPath,
 		const std::list<std::string> &sources,
 		const std::list<std::string> &headers,
 		const std::list<std::string> &folders)
 {
-
-	std::cout << "Construyendo CMAKE\n";
-
 	out = "IF(NOT DEV_ROOT_PATH)\n"
 			"\tmessage(SEND_ERROR \"No esta seteado DEV_ROOT_PATH\")\n"
 			"endif()\n\n";
@@ -185,25 +357,96 @@ static void constructOutput(std::string &out,
 
 }
 
+// the absolute path of a root (without resolving the links, as the shell)
+static std::string absolutePath(const std::string &root)
+{
+	std::string path = root;
+	if(path.empty() || path[0] != '/'){
+		char *cwd = get_current_dir_name();
+		path = std::string(cwd) + "/" + path;
+		free(cwd);
+	}
+	// remove the "/." and the trailing '/'
+	size_t pos;
+	while((pos = path.find("/./")) != std::string::npos){
+		path.erase(pos, 2);
+	}
+	while(path.size() > 1 && (path[path.size()-1] == '/' ||
+			(path.size() > 2 && path.compare(path.size()-2, 2, "/.") == 0))){
+		path.resize(path[path.size()-1] == '/' ? path.size()-1 : path.size()-2);
+	}
+	return path;
+}
+
+// generate the AutoGen.cmake of a root
+static bool processRoot(const std::string &root, const RootInfo *old,
+						RootInfo &result)
+{
+	const std::string absRoot = absolutePath(root);
+	size_t pos = absRoot.find(envPath);
+	if(pos == std::string::npos){
+		std::cout << "Estamos intentando crear un cmake fuera del repo! ("
+				<< absRoot << ")\n";
+		return false;
+	}
+	std::string actualPath = absRoot;
+	actualPath.replace(pos, envPath.size(), "");
+
+	size_t numRead = 0;
+	if(!scanRoot(absRoot, old, result, numRead)){
+		return false;
+	}
+
+	std::list<std::string> folders;
+	std::list<std::string> headers;
+	std::list<std::string> sources;
+	getSourcesAndHeaders(result, folders, headers, sources);
+
+	std::string out;
+	constructOutput(out, actualPath, sources, headers, folders);
+
+	bool written = false;
+	const std::string fName = absRoot + "/AutoGen.cmake";
+	if(!FileManager::getInstance()->writeFileIfChanged(fName, out, &written)){
+		std::cout << "Error escribiendo " << fName << "\n";
+		return false;
+	}
+	std::cout << actualPath << ": " << result.dirs.size() << " directorios ("
+			<< numRead << " leidos), " << sources.size() << " sources, "
+			<< headers.size() << " headers, AutoGen.cmake "
+			<< (written ? "actualizado" : "sin cambios") << "\n";
+	return true;
+}
+
 int main(int argc, char **args)
 {
-	if(argc < 2){
+	bool incremental = false;
+	std::string manifestName = DEFAULT_MANIFEST;
+	std::vector<std::string> roots;
+	for(int i = 1; i < argc; ++i){
+		if(strcmp(args[i], "-i") == 0){
+			incremental = true;
+		} else if(strcmp(args[i], "-m") == 0 && i + 1 < argc){
+			manifestName = args[++i];
+			incremental = true;
+		} else {
+			roots.push_back(args[i]);
+		}
+	}
+	if(roots.empty()){
 		std::cout << "Hace falta especificar el path sobre el cual se quiere "
-				"realizar el make.\n";
+				"realizar el make.\n"
+				"Uso: autogenCmake [-i] [-m manifest] root [root ...]\n";
 		return 1;
 	}
 
 	// get the actual path
 	char *env = getenv(DEV_PATH_ENV_NAME);
 	if(env == 0){
-		std::cout << "La variable de entorno DEV_PATH_ENV_NAME no fue encontrada\n";
+		std::cout << "La variable de entorno " DEV_PATH_ENV_NAME " no fue encontrada\n";
 		return 1;
 	}
 
-	actualPath = get_current_dir_name();
-	// TODO: windows cambiar / por
-	std::cout << "actual Path: " << actualPath << std::endl;
-
 	envPath = env;
 	if((envPath[envPath.size()-1] == '/') || (envPath[envPath.size()-1] == '\\')){
 		envPath.resize(envPath.size()-1);
@@ -211,36 +454,32 @@ int main(int argc, char **args)
 
 	std::cout << "envPath Path: " << envPath << std::endl;
 
-	size_t pos = actualPath.find(envPath);
-	if(pos == std::string::npos){
-		std::cout << "Estamos intentando crear un cmake fuera del repo!\n";
+	Manifest manifest;
+	if(incremental && !loadManifest(manifestName, manifest)){
 		return 1;
 	}
 
-	actualPath.replace(pos, envPath.size(), "");
-
-	std::cout << "Obteniendo directorios\n";
-	std::list<std::string> folders;
-	// get the paths from the folder
-	getPathsWithoutTests(args[1], folders);
-
-
-	std::cout << "Directorios obtenidos\n";
-	// get the files inside of that paths
-	std::list<std::string> headers;
-	std::list<std::string> sources;
-
-	getSourcesAndHeaders(folders, headers, sources);
-
-	replaceListPaths(folders);
-	replaceListPaths(headers);
-	replaceListPaths(sources);
-
-	std::string out;
-	constructOutput(out,sources,headers,folders);
+	bool ok = true;
+	for(size_t i = 0; i < roots.size(); ++i){
+		const std::string absRoot = absolutePath(roots[i]);
+		Manifest::const_iterator it = manifest.find(absRoot);
+		RootInfo result;
+		if(!processRoot(roots[i], it == manifest.end() ? 0 : &it->second,
+				result)){
+			ok = false;
+			continue;
+		}
+		manifest[absRoot] = result;
+	}
 
-	std::cout << "Escribiendo archivo\n";
-	assert(FileManager::getInstance()->writeFile("AutoGen.cmake", out, true));
+	if(incremental){
+		std::string out;
+		buildManifest(manifest, out);
+		if(!FileManager::getInstance()->writeFileIfChanged(manifestName, out)){
+			std::cout << "Error escribiendo " << manifestName << "\n";
+			return 1;
+		}
+	}
 
-	return 0;
+	return ok ? 0 : 1;
 }
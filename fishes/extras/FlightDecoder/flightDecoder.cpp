@@ -0,0 +1,243 @@
+/* Tool to decode the file written by debug::FlightRecorder (i.e. after a
+ * crash or a hitch) into a readable report: a summary of the frame times, the
+ * slow frames, the asset loads and the logged warnings / errors, in order.
+ *
+ * Usage:
+ *  flightDecoder [--last seconds] [--frames] fishes_flight.bin
+ *      --last      only the records of the last seconds of the file
+ *      --frames    print all the frames (by default only the slow ones)
+ *
+ * flightDecoder.cpp
+ *
+ *  Created on: Apr 14, 2013
+ *      Author: agustin
+ */
+
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <algorithm>
+
+#include <debug/FlightRecorder.h>
+
+
+typedef debug::FlightRecorder FlightRecorder;
+
+// A frame is slow if it takes more than this times the median (or the
+// absolute limit)
+static const float SLOW_FACTOR = 2.f;
+static const float SLOW_LIMIT = 1.f / 30.f;
+
+// The records decoded from the file (without the atomic)
+struct Entry {
+    std::uint64_t seq;
+    std::uint64_t time;
+    std::uint16_t type;
+    std::uint16_t level;
+    std::uint32_t tid;
+    float value;
+    std::uint32_t data;
+    std::string text;
+
+    bool operator<(const Entry &other) const { return seq < other.seq; }
+};
+
+
+// Read the header and the valid records of the file
+static bool read(const std::string &fName, FlightRecorder::FileHeader &header,
+                 std::vector<Entry> &entries, std::size_t &torn)
+{
+    FILE *file = std::fopen(fName.c_str(), "rb");
+    if (file == 0) {
+        std::printf("Error opening %s\n", fName.c_str());
+        return false;
+    }
+    if (std::fread(&header, sizeof(header), 1, file) != 1 ||
+        std::string(header.magic) != "FISHFLR") {
+        std::printf("%s is not a flight recorder file\n", fName.c_str());
+        std::fclose(file);
+        return false;
+    }
+    if (header.version != FlightRecorder::VERSION ||
+        header.recordSize != sizeof(FlightRecorder::Record)) {
+        std::printf("%s: unsupported version %u (record size %u)\n",
+                    fName.c_str(), header.version, header.recordSize);
+        std::fclose(file);
+        return false;
+    }
+
+    const std::uint64_t next = header.next.load();
+    torn = 0;
+    FlightRecorder::Record record;
+    for (std::uint64_t i = 0; i < header.capacity; ++i) {
+        if (std::fread(&record, sizeof(record), 1, file) != 1) {
+            std::printf("%s is truncated\n", fName.c_str());
+            std::fclose(file);
+            return false;
+        }
+        const std::uint64_t seq = record.seq.load();
+        if (seq == 0 || seq > next) {
+            // never written or being written when the process died
+            if (i < next) {
+                ++torn;
+            }
+            continue;
+        }
+        if ((seq - 1) % header.capacity != i) {
+            ++torn;
+            continue;
+        }
+        Entry entry;
+        entry.seq = seq;
+        entry.time = record.time;
+        entry.type = record.type;
+        entry.level = record.level;
+        entry.tid = record.tid;
+        entry.value = record.value;
+        entry.data = record.data;
+        record.text[FlightRecorder::TEXT_SIZE - 1] = '\0';
+        entry.text = record.text;
+        entries.push_back(entry);
+    }
+    std::fclose(file);
+    std::sort(entries.begin(), entries.end());
+    return true;
+}
+
+// Print a record of the timeline
+static void printEntry(const Entry &e, const char *mark)
+{
+    const double t = e.time * 1e-9;
+    switch (e.type) {
+    case FlightRecorder::RECORD_FRAME:
+        std::printf("%10.3f  frame %-8u %8.2f ms%s\n", t, e.data,
+                    e.value * 1e3f, mark);
+        break;
+    case FlightRecorder::RECORD_LOAD:
+        std::printf("%10.3f  load  [%u] %8.2f ms %s%s\n", t, e.tid,
+                    e.value * 1e3f, e.text.c_str(), e.data ? "" : " (FAILED)");
+        break;
+    case FlightRecorder::RECORD_LOG:
+        std::printf("%10.3f  %-5s [%u] line %u, %s", t,
+                    e.level >= 2 ? "ERROR" : "WARN", e.tid, e.data,
+                    e.text.c_str());
+        if (e.text.empty() || e.text[e.text.size() - 1] != '\n') {
+            std::printf("\n");
+        }
+        break;
+    default:
+        std::printf("%10.3f  unknown record type %u\n", t, e.type);
+        break;
+    }
+}
+
+int main(int argc, char **args)
+{
+    double last = 0.;
+    bool allFrames = false;
+    std::string fName;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = args[i];
+        if (arg == "--last" && i + 1 < argc) {
+            last = std::atof(args[++i]);
+        } else if (arg == "--frames") {
+            allFrames = true;
+        } else if (fName.empty() && arg[0] != '-') {
+            fName = arg;
+        } else {
+            fName.clear();
+            break;
+        }
+    }
+    if (fName.empty()) {
+        std::printf("Usage: flightDecoder [--last seconds] [--frames] "
+                    "file\n");
+        return 1;
+    }
+
+    FlightRecorder::FileHeader header;
+    std::vector<Entry> entries;
+    std::size_t torn;
+    if (!read(fName, header, entries, torn)) {
+        return 1;
+    }
+
+    // the header
+    const std::time_t start = static_cast<std::time_t>(header.startTime / 1000000000ull);
+    char date[64];
+    std::strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", std::localtime(&start));
+    const std::uint64_t next = header.next.load();
+    std::printf("%s: pid %u, started %s, %s\n", fName.c_str(), header.pid, date,
+                header.cleanExit ? "clean exit" : "NO CLEAN EXIT (crash?)");
+    std::printf("%llu records written, %zu kept (capacity %llu), %zu torn\n",
+                (unsigned long long) next, entries.size(),
+                (unsigned long long) header.capacity, torn);
+    if (entries.empty()) {
+        return 0;
+    }
+
+    // only the last seconds
+    if (last > 0.) {
+        const std::uint64_t end = entries.back().time;
+        const std::uint64_t window = static_cast<std::uint64_t>(last * 1e9);
+        std::size_t first = 0;
+        while (first < entries.size() && entries[first].time + window < end) {
+            ++first;
+        }
+        entries.erase(entries.begin(), entries.begin() + first);
+    }
+    std::printf("from %.3f s to %.3f s\n\n", entries.front().time * 1e-9,
+                entries.back().time * 1e-9);
+
+    // frame summary
+    std::vector<float> frames;
+    std::size_t loads = 0, failedLoads = 0, warnings = 0, errors = 0;
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+        const Entry &e = entries[i];
+        if (e.type == FlightRecorder::RECORD_FRAME) {
+            frames.push_back(e.value);
+        } else if (e.type == FlightRecorder::RECORD_LOAD) {
+            ++loads;
+            failedLoads += e.data ? 0 : 1;
+        } else if (e.type == FlightRecorder::RECORD_LOG) {
+            (e.level >= 2) ? ++errors : ++warnings;
+        }
+    }
+    float slowLimit = SLOW_LIMIT;
+    if (!frames.empty()) {
+        std::vector<float> sorted(frames);
+        std::sort(sorted.begin(), sorted.end());
+        double sum = 0.;
+        for (std::size_t i = 0; i < sorted.size(); ++i) {
+            sum += sorted[i];
+        }
+        const float median = sorted[sorted.size() / 2];
+        const float p99 = sorted[(sorted.size() * 99) / 100];
+        slowLimit = std::min(SLOW_LIMIT, median * SLOW_FACTOR);
+        const std::size_t slow = sorted.end() -
+            std::upper_bound(sorted.begin(), sorted.end(), slowLimit);
+        std::printf("frames: %zu, avg %.2f ms, median %.2f ms, p99 %.2f ms, "
+                    "max %.2f ms, %zu slow (> %.2f ms)\n", sorted.size(),
+                    sum * 1e3 / sorted.size(), median * 1e3f, p99 * 1e3f,
+                    sorted.back() * 1e3f, slow, slowLimit * 1e3f);
+    }
+    std::printf("loads: %zu (%zu failed), warnings: %zu, errors: %zu\n\n",
+                loads, failedLoads, warnings, errors);
+
+    // the timeline (the frames only if they are slow)
+    std::printf("%10s  event\n", "time (s)");
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+        const Entry &e = entries[i];
+        if (e.type == FlightRecorder::RECORD_FRAME) {
+            const bool slow = e.value > slowLimit;
+            if (slow || allFrames) {
+                printEntry(e, slow ? "  <- SLOW" : "");
+            }
+        } else {
+            printEntry(e, "");
+        }
+    }
+    return 0;
+}
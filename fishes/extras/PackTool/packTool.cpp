@@ -0,0 +1,118 @@
+/* Tool to pack a folder of assets into one archive (see PackArchive), that
+ * the game reads with the "pack://" names of the FileManager.
+ *
+ * Usage:
+ *  packTool [-z] [-a alignment] [-e extension ...] -o out.pack folder
+ *  packTool -l archive.pack
+ *
+ * The name of each file in the archive is its path relative to the folder
+ * (i.e. "packTool -o media.pack media" puts "media/fish.png" as "fish.png",
+ * read then as "pack://fish.png").
+ *  -z  compress the entries with LZ4 (the ones that get smaller)
+ *  -a  the alignment of the entries (16 by default)
+ *  -e  only the files ending with the extension (can be repeated)
+ *  -l  list the entries of an archive
+ *
+ * packTool.cpp
+ *
+ *  Created on: Apr 19, 2013
+ *      Author: agustin
+ */
+
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <iostream>
+#include <algorithm>
+
+#include <FileManager.h>
+#include <PackArchive.h>
+
+
+// List the entries of an archive (sorted by name)
+static int
+listArchive(const std::string &fName)
+{
+    PackArchive archive;
+    if (!archive.open(fName)) {
+        return 1;
+    }
+    std::vector<std::string> names;
+    for (std::size_t i = 0; i < archive.size(); ++i) {
+        names.push_back(archive.name(i));
+    }
+    std::sort(names.begin(), names.end());
+
+    FileView view;
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < names.size(); ++i) {
+        if (!archive.read(names[i], view)) {
+            return 1;
+        }
+        std::cout << view.size() << "\t" << names[i] << "\n";
+        total += view.size();
+    }
+    std::cout << names.size() << " files, " << total << " bytes\n";
+    return 0;
+}
+
+int main(int argc, char **args)
+{
+    std::string outName;
+    std::string folder;
+    std::string listName;
+    std::vector<std::string> extensions;
+    bool compress = false;
+    std::size_t alignment = PackArchive::DEFAULT_ALIGNMENT;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = args[i];
+        if (arg == "-z") {
+            compress = true;
+        } else if (arg == "-a" && i + 1 < argc) {
+            alignment = std::atoi(args[++i]);
+        } else if (arg == "-e" && i + 1 < argc) {
+            extensions.push_back(args[++i]);
+        } else if (arg == "-o" && i + 1 < argc) {
+            outName = args[++i];
+        } else if (arg == "-l" && i + 1 < argc) {
+            listName = args[++i];
+        } else {
+            folder = arg;
+        }
+    }
+    if (!listName.empty()) {
+        return listArchive(listName);
+    }
+    if (outName.empty() || folder.empty()) {
+        std::cout << "Usage: packTool [-z] [-a alignment] [-e extension ...] "
+                "-o out.pack folder\n       packTool -l archive.pack\n";
+        return 1;
+    }
+
+    DirScanner::Result result;
+    if (!FileManager::getInstance()->scanFolder(folder, result, extensions)) {
+        return 1;
+    }
+    result.sort();
+
+    // the names relative to the folder
+    const std::string root = result.path(result.folders[0]);
+    const std::size_t skip = root.size() + (root[root.size() - 1] == '/' ? 0 : 1);
+    std::vector<PackArchive::Input> inputs;
+    for (std::size_t i = 0; i < result.files.size(); ++i) {
+        PackArchive::Input input;
+        input.path = result.path(result.files[i]);
+        input.name = input.path.substr(skip);
+        if (input.path == outName) {
+            continue;
+        }
+        inputs.push_back(input);
+    }
+
+    if (!PackArchive::build(outName, inputs, compress, alignment)) {
+        return 1;
+    }
+    std::cout << inputs.size() << " files packed into " << outName << "\n";
+    return 0;
+}
@@ -0,0 +1,260 @@
+/*
+ * AsyncLog.cpp
+ *
+ *  Created on: Apr 13, 2013
+ *      Author: agustin
+ */
+
+#include "AsyncLog.h"
+
+#include <string>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdarg>
+
+
+// auxiliar functions
+namespace {
+// The max size of a formatted message
+const std::size_t MAX_MESSAGE = 1024;
+// How much the background thread sleeps when there is nothing to write
+const std::chrono::milliseconds IDLE_SLEEP(2);
+
+// Returns the basename of a path (without modifying it)
+const char *
+fileName(const char *path)
+{
+    const char *slash = std::strrchr(path, '/');
+    return (slash != 0) ? slash + 1 : path;
+}
+}
+
+namespace debug {
+
+namespace log_detail {
+
+////////////////////////////////////////////////////////////////////////////////
+void
+formatMessage(char *out, std::size_t size, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    std::vsnprintf(out, size, format, args);
+    va_end(args);
+}
+
+} /* namespace log_detail */
+
+AsyncLog *AsyncLog::mInstance = 0;
+std::once_flag AsyncLog::mCreateFlag;
+thread_local AsyncLog::Ring *AsyncLog::tRing = 0;
+
+////////////////////////////////////////////////////////////////////////////////
+AsyncLog::Ring &
+AsyncLog::createRing(void)
+{
+    Ring *ring = new Ring;
+    ring->buffer = new char[RING_SIZE];
+    ring->head.store(0, std::memory_order_relaxed);
+    ring->tail.store(0, std::memory_order_relaxed);
+    ring->dropped.store(0, std::memory_order_relaxed);
+
+    // the rings are never released (the thread could finish before its
+    // messages are written)
+    {
+        std::lock_guard<std::mutex> lock(mRingsMutex);
+        mRings.push_back(ring);
+    }
+    tRing = ring;
+    return *ring;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+char *
+AsyncLog::reserve(Ring &ring, std::size_t size)
+{
+    std::uint64_t head = ring.head.load(std::memory_order_relaxed);
+    const std::uint64_t tail = ring.tail.load(std::memory_order_acquire);
+    std::size_t pos = head & (RING_SIZE - 1);
+    const std::size_t contiguous = RING_SIZE - pos;
+
+    // the records are never split, skip the end of the ring
+    std::size_t skip = 0;
+    if (contiguous < size) {
+        skip = contiguous;
+    }
+    if (head + skip + size - tail > RING_SIZE) {
+        ring.dropped.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+
+    if (skip > 0) {
+        // a padding record if it fits, if not the consumer knows that it
+        // has to skip the end (less than a Record)
+        if (skip >= sizeof(Record)) {
+            Record *padding = reinterpret_cast<Record *>(ring.buffer + pos);
+            padding->size = skip;
+            padding->numSlots = 0;
+            padding->site = 0;
+            padding->format = 0;
+        }
+        head += skip;
+        ring.head.store(head, std::memory_order_release);
+        pos = 0;
+    }
+    return ring.buffer + pos;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t
+AsyncLog::consume(void)
+{
+    std::vector<Ring *> rings;
+    {
+        std::lock_guard<std::mutex> lock(mRingsMutex);
+        rings = mRings;
+    }
+
+    // the messages of each stream are written at once
+    std::string out[3];
+    char message[MAX_MESSAGE];
+    char line[16];
+    std::size_t written = 0;
+    for (std::size_t i = 0; i < rings.size(); ++i) {
+        Ring &ring = *rings[i];
+        std::uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+        const std::uint64_t head = ring.head.load(std::memory_order_acquire);
+        while (tail < head) {
+            const std::size_t pos = tail & (RING_SIZE - 1);
+            if (RING_SIZE - pos < sizeof(Record)) {
+                tail += RING_SIZE - pos;
+                continue;
+            }
+            const Record *record =
+                reinterpret_cast<const Record *>(ring.buffer + pos);
+            if (record->site != 0) {
+                const LogSite &site = *record->site;
+                record->format(site, ring.buffer + pos + sizeof(Record),
+                               message, sizeof(message));
+                std::snprintf(line, sizeof(line), "%d", site.line);
+                std::string &stream = out[(site.stream == 1) ? 1 : 2];
+                stream += site.label;
+                stream += '[';
+                stream += site.shortName ? fileName(site.file) : site.file;
+                stream += ", ";
+                stream += site.function;
+                stream += ", ";
+                stream += line;
+                stream += "]: ";
+                stream += message;
+                stream += "\33[0m";
+                ++written;
+            }
+            tail += record->size;
+        }
+        ring.tail.store(tail, std::memory_order_release);
+
+        const std::size_t dropped =
+            ring.dropped.exchange(0, std::memory_order_relaxed);
+        if (dropped > 0) {
+            std::snprintf(message, sizeof(message),
+                          "AsyncLog: %zu messages dropped (ring full)\n",
+                          dropped);
+            out[2] += message;
+            mStats.dropped += dropped;
+        }
+    }
+
+    if (!out[1].empty()) {
+        std::fwrite(out[1].data(), 1, out[1].size(), stdout);
+        std::fflush(stdout);
+    }
+    if (!out[2].empty()) {
+        std::fwrite(out[2].data(), 1, out[2].size(), stderr);
+        std::fflush(stderr);
+    }
+    mStats.written += written;
+    return written;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+AsyncLog::threadLoop(void)
+{
+    while (!mExit.load(std::memory_order_acquire)) {
+        std::size_t written;
+        {
+            std::lock_guard<std::mutex> lock(mConsumerMutex);
+            written = consume();
+        }
+        if (written == 0) {
+            std::this_thread::sleep_for(IDLE_SLEEP);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+AsyncLog::shutdown(void)
+{
+    AsyncLog *log = mInstance;
+    log->mExit.store(true, std::memory_order_release);
+    if (log->mThread.joinable()) {
+        log->mThread.join();
+    }
+    log->flush();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+AsyncLog::create(void)
+{
+    mInstance = new AsyncLog;
+    mInstance->mThread = std::thread(&AsyncLog::threadLoop, mInstance);
+    std::atexit(&AsyncLog::shutdown);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+AsyncLog::AsyncLog() :
+    mExit(false)
+{
+    mStats.written = 0;
+    mStats.dropped = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+AsyncLog::~AsyncLog()
+{
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+AsyncLog *
+AsyncLog::getInstance(void)
+{
+    // created by the first log, that can come from any thread
+    std::call_once(mCreateFlag, &AsyncLog::create);
+    return mInstance;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+AsyncLog::flush(void)
+{
+    std::lock_guard<std::mutex> lock(mConsumerMutex);
+    consume();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+AsyncLog::Stats
+AsyncLog::stats(void) const
+{
+    std::lock_guard<std::mutex> lock(const_cast<std::mutex &>(mConsumerMutex));
+    return mStats;
+}
+
+} /* namespace debug */
@@ -0,0 +1,357 @@
+/*
+ * AsyncLog.h
+ *
+ *  Created on: Apr 13, 2013
+ *      Author: agustin
+ */
+
+#ifndef ASYNCLOG_H_
+#define ASYNCLOG_H_
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+
+// Log a message through the AsyncLog (used by the debug* macros of
+// DebugUtil.h when FISHES_ASYNC_LOG is defined).
+// @param   stream      stdout or stderr
+// @param   label       The prefix of the message (colors + "DEBUG")
+// @param   base        1 to print the basename of the file, 0 the full path
+// @param   format      The printf format (string literal)
+#define DEBUG_ASYNC_LOG(stream, label, base, format, ...) \
+    { \
+        static const debug::LogSite debugLogSite_ = { \
+            DEBUG_STREAM_ ## stream, label, __FILE__, base, __FUNCTION__, \
+            __LINE__, format}; \
+        /* never executed, only to check the arguments against format */ \
+        if (0) { fprintf(stream, format, ## __VA_ARGS__); } \
+        debug::AsyncLog::log(debugLogSite_, ## __VA_ARGS__); \
+    }
+#define DEBUG_STREAM_stdout     1
+#define DEBUG_STREAM_stderr     2
+
+
+namespace debug {
+
+// The static information of a log call (one per call site)
+struct LogSite {
+    int stream;
+    const char *label;
+    const char *file;
+    int shortName;
+    const char *function;
+    int line;
+    const char *format;
+};
+
+// @brief Asynchronous backend of the log macros. The calling thread only
+// copies the arguments (strings included) and a pointer to the LogSite into
+// its own ring (lock free, single producer / single consumer) and returns;
+// the formatting and the writes are done by a background thread.
+// If a ring is full the message is dropped (the game loop never waits), the
+// number of dropped messages is printed later.
+// The supported arguments are the ones of the printf family: integers,
+// enums, floating point, pointers and C strings.
+//
+class AsyncLog
+{
+public:
+    // The bytes of the ring of each thread (power of 2)
+    static const std::size_t RING_SIZE = 1 << 18;
+
+    // Formats the arguments of a record into out
+    typedef void (*FormatFn)(const LogSite &site, const char *args,
+                             char *out, std::size_t size);
+
+    struct Stats {
+        std::size_t written;
+        std::size_t dropped;
+    };
+
+public:
+    // @brief Returns the instance (the background thread is started the
+    // first time)
+    static AsyncLog *getInstance(void);
+
+    // @brief Queue a message
+    template<typename... Args>
+    static inline void log(const LogSite &site, Args... args);
+
+    // @brief Write all the messages queued so far (called at exit
+    // automatically)
+    void flush(void);
+
+    // @brief Returns the stats (updated by the background thread)
+    Stats stats(void) const;
+
+private:
+    AsyncLog();
+    ~AsyncLog();
+
+    // avoid copying
+    AsyncLog(const AsyncLog &);
+    AsyncLog &operator=(const AsyncLog &);
+
+    // The ring of a thread: only its thread writes head, only the consumer
+    // (under mConsumerMutex) writes tail
+    struct Ring {
+        char *buffer;
+        std::atomic<std::uint64_t> head;
+        std::atomic<std::uint64_t> tail;
+        std::atomic<std::size_t> dropped;
+    };
+
+    // The header of each record of a ring, followed by the argument slots (8
+    // bytes each) and the strings. A record with site == 0 is padding until
+    // the end of the ring.
+    struct Record {
+        std::uint32_t size;
+        std::uint32_t numSlots;
+        const LogSite *site;
+        FormatFn format;
+    };
+
+    static const std::size_t SLOT_SIZE = 8;
+
+    // @brief Returns the ring of the calling thread (created the first time)
+    inline Ring &ring(void);
+    Ring &createRing(void);
+
+    // @brief Reserve size bytes (multiple of 8) in a ring
+    // @returns the memory or 0 if the ring is full
+    char *reserve(Ring &ring, std::size_t size);
+    inline void commit(Ring &ring, std::size_t size);
+
+    // @brief Write the queued messages (mConsumerMutex must be taken)
+    // @returns the number of messages written
+    std::size_t consume(void);
+
+    // @brief The background thread / the atexit() function
+    void threadLoop(void);
+    static void shutdown(void);
+
+    // @brief Create the instance and start its thread (only once)
+    static void create(void);
+
+private:
+    static AsyncLog *mInstance;
+    static std::once_flag mCreateFlag;
+    static thread_local Ring *tRing;
+
+    std::mutex mRingsMutex;
+    std::vector<Ring *> mRings;
+    std::mutex mConsumerMutex;
+    std::atomic<bool> mExit;
+    std::thread mThread;
+    Stats mStats;
+};
+
+
+// Serialization of the arguments. Each argument takes a slot of 8 bytes, the
+// strings are copied after the slots (the slot keeps its offset)
+//
+namespace log_detail {
+
+// @brief Convert the arguments to the types passed to snprintf
+template<typename T, bool IS_INTEGRAL = std::is_integral<T>::value ||
+                                        std::is_enum<T>::value,
+                     bool IS_FLOAT = std::is_floating_point<T>::value,
+                     bool IS_POINTER = std::is_pointer<T>::value>
+struct Arg {
+    static_assert(IS_INTEGRAL || IS_FLOAT || IS_POINTER,
+                  "Argument type not supported by the AsyncLog");
+};
+
+// integers and enums, stored as they are
+template<typename T>
+struct Arg<T, true, false, false> {
+    static_assert(sizeof(T) <= 8, "Integer too big for the AsyncLog");
+    static inline std::size_t stringSize(T) { return 0; }
+    static inline void store(char *slot, char *&, T value)
+    {
+        std::memcpy(slot, &value, sizeof(T));
+    }
+    static inline T load(const char *slot, const char *)
+    {
+        T value;
+        std::memcpy(&value, slot, sizeof(T));
+        return value;
+    }
+};
+
+// floating point, stored as double (as printf receives them)
+template<typename T>
+struct Arg<T, false, true, false> {
+    static inline std::size_t stringSize(T) { return 0; }
+    static inline void store(char *slot, char *&, T value)
+    {
+        const double d = value;
+        std::memcpy(slot, &d, sizeof(d));
+    }
+    static inline double load(const char *slot, const char *)
+    {
+        double d;
+        std::memcpy(&d, slot, sizeof(d));
+        return d;
+    }
+};
+
+// pointers, only the address
+template<typename T>
+struct Arg<T, false, false, true> {
+    static inline std::size_t stringSize(T) { return 0; }
+    static inline void store(char *slot, char *&, T value)
+    {
+        const void *ptr = value;
+        std::memcpy(slot, &ptr, sizeof(ptr));
+    }
+    static inline const void *load(const char *slot, const char *)
+    {
+        const void *ptr;
+        std::memcpy(&ptr, slot, sizeof(ptr));
+        return ptr;
+    }
+};
+
+// C strings, copied (they could be temporaries)
+struct StringArg {
+    static inline const char *safe(const char *str)
+    {
+        return (str != 0) ? str : "(null)";
+    }
+    static inline std::size_t stringSize(const char *str)
+    {
+        return std::strlen(safe(str)) + 1;
+    }
+    static inline void store(char *slot, char *&strings, const char *str)
+    {
+        str = safe(str);
+        const std::size_t size = std::strlen(str) + 1;
+        std::memcpy(strings, str, size);
+        // the offset of the string from its slot
+        const std::uint64_t offset = strings - slot;
+        std::memcpy(slot, &offset, sizeof(offset));
+        strings += size;
+    }
+    static inline const char *load(const char *slot, const char *)
+    {
+        std::uint64_t offset;
+        std::memcpy(&offset, slot, sizeof(offset));
+        return slot + offset;
+    }
+};
+template<>
+struct Arg<const char *, false, false, true> : public StringArg {};
+template<>
+struct Arg<char *, false, false, true> : public StringArg {};
+
+// @brief The total size of the strings of the arguments
+inline std::size_t
+stringsSize(void)
+{
+    return 0;
+}
+template<typename T, typename... Rest>
+inline std::size_t
+stringsSize(T first, Rest... rest)
+{
+    return Arg<T>::stringSize(first) + stringsSize(rest...);
+}
+
+// @brief Store the arguments in the slots
+inline void
+storeArgs(char *, char *&)
+{
+}
+template<typename T, typename... Rest>
+inline void
+storeArgs(char *slot, char *&strings, T first, Rest... rest)
+{
+    Arg<T>::store(slot, strings, first);
+    storeArgs(slot + 8, strings, rest...);
+}
+
+// The indices 0..N-1 of the arguments (to load them all in one expression)
+template<std::size_t... I>
+struct Indices {};
+template<std::size_t N, std::size_t... I>
+struct MakeIndices : MakeIndices<N - 1, N - 1, I...> {};
+template<std::size_t... I>
+struct MakeIndices<0, I...> {
+    typedef Indices<I...> Type;
+};
+
+// @brief snprintf with the format of the site (not a literal)
+void formatMessage(char *out, std::size_t size, const char *format, ...);
+
+template<typename... Args, std::size_t... I>
+inline void
+formatArgs(const LogSite &site, const char *slots, char *out,
+           std::size_t size, Indices<I...>)
+{
+    formatMessage(out, size, site.format,
+                  Arg<Args>::load(slots + I * 8, slots)...);
+}
+
+// @brief The FormatFn of a list of argument types
+template<typename... Args>
+void
+format(const LogSite &site, const char *slots, char *out, std::size_t size)
+{
+    formatArgs<Args...>(site, slots, out, size,
+                        typename MakeIndices<sizeof...(Args)>::Type());
+}
+
+} /* namespace log_detail */
+
+
+// Inline implementations
+//
+
+inline AsyncLog::Ring &
+AsyncLog::ring(void)
+{
+    return (tRing != 0) ? *tRing : createRing();
+}
+
+inline void
+AsyncLog::commit(Ring &ring, std::size_t size)
+{
+    ring.head.store(ring.head.load(std::memory_order_relaxed) + size,
+                    std::memory_order_release);
+}
+
+template<typename... Args>
+inline void
+AsyncLog::log(const LogSite &site, Args... args)
+{
+    const std::size_t numSlots = sizeof...(Args);
+    const std::size_t size = (sizeof(Record) + numSlots * SLOT_SIZE +
+        log_detail::stringsSize(args...) + 7) & ~std::size_t(7);
+
+    AsyncLog *log = getInstance();
+    Ring &r = log->ring();
+    char *data = log->reserve(r, size);
+    if (data == 0) {
+        return;
+    }
+
+    Record *record = reinterpret_cast<Record *>(data);
+    record->size = size;
+    record->numSlots = numSlots;
+    record->site = &site;
+    record->format = &log_detail::format<Args...>;
+    char *slots = data + sizeof(Record);
+    char *strings = slots + numSlots * SLOT_SIZE;
+    log_detail::storeArgs(slots, strings, args...);
+    log->commit(r, size);
+}
+
+} /* namespace debug */
+#endif /* ASYNCLOG_H_ */
@@ -47,6 +47,62 @@
 #define DEBUG_INVERT	"\33[7m"
 
 
+// Log severities. The calls with a severity below FISHES_LOG_LEVEL are
+// removed at compile time (i.e. -DFISHES_LOG_LEVEL=1 keeps only the
+// warnings and errors).
+#define DEBUG_LEVEL_DEBUG		0
+#define DEBUG_LEVEL_WARNING		1
+#define DEBUG_LEVEL_ERROR		2
+#ifndef FISHES_LOG_LEVEL
+	#define FISHES_LOG_LEVEL	DEBUG_LEVEL_DEBUG
+#endif
+
+// Log categories, a category can be removed at compile time defining
+// FISHES_LOG_DISABLE_<CATEGORY>. Usage:
+//	debugCAT(UI, debugWARNING, "Sprite %zu not found\n", id);
+#define debugCAT(category, macro, ...)	DEBUG_CATEGORY_ ## category(macro(__VA_ARGS__))
+#ifndef FISHES_LOG_DISABLE_GENERAL
+	#define DEBUG_CATEGORY_GENERAL(log)	log
+#else
+	#define DEBUG_CATEGORY_GENERAL(log)
+#endif
+#ifndef FISHES_LOG_DISABLE_UI
+	#define DEBUG_CATEGORY_UI(log)		log
+#else
+	#define DEBUG_CATEGORY_UI(log)
+#endif
+#ifndef FISHES_LOG_DISABLE_JOBS
+	#define DEBUG_CATEGORY_JOBS(log)	log
+#else
+	#define DEBUG_CATEGORY_JOBS(log)
+#endif
+#ifndef FISHES_LOG_DISABLE_IO
+	#define DEBUG_CATEGORY_IO(log)		log
+#else
+	#define DEBUG_CATEGORY_IO(log)
+#endif
+
+
+// The warnings and errors are also kept by the FlightRecorder (only the
+// format, with or without DEBUG) to know what happened before a crash.
+#ifdef FISHES_FLIGHT_RECORDER
+	#include "FlightRecorder.h"
+	#if FISHES_LOG_LEVEL <= DEBUG_LEVEL_WARNING
+		#define DEBUG_FLIGHT_WARNING(format)	FLIGHT_RECORD_LOG(DEBUG_LEVEL_WARNING, format)
+	#else
+		#define DEBUG_FLIGHT_WARNING(format)
+	#endif
+	#if FISHES_LOG_LEVEL <= DEBUG_LEVEL_ERROR
+		#define DEBUG_FLIGHT_ERROR(format)		FLIGHT_RECORD_LOG(DEBUG_LEVEL_ERROR, format)
+	#else
+		#define DEBUG_FLIGHT_ERROR(format)
+	#endif
+#else
+	#define DEBUG_FLIGHT_WARNING(format)
+	#define DEBUG_FLIGHT_ERROR(format)
+#endif
+
+
 #ifdef DEBUG
 	#include <assert.h>
 	#include <iostream>
@@ -55,57 +111,79 @@
 	#define ASSERT(x)	assert(x);
 	//#define OGRELOG(x)	Ogre::LogManager().getSingleton().logMessage(x)
 	#define OGRELOG(x)	std::cerr << "OGRELOG: " << (x) << std::endl;
-	#define debug(format, ...) {fprintf(stderr, "\33[0mDEBUG[%s, %s, %d]: ", \
-					 __FILE__, __FUNCTION__, __LINE__); \
-					fprintf(stderr, format , ## __VA_ARGS__);}
-
-	#define debugRED(format, ...) {fprintf(stderr, DEBUG_RED "DEBUG[%s, %s, %d]: ", \
-					 __FILE__, __FUNCTION__, __LINE__); \
-					fprintf(stderr, format "\33[0m", ## __VA_ARGS__);}
-
-	#define debugYELLOW(format, ...) {fprintf(stderr, DEBUG_YELLOW "DEBUG[%s, %s, %d]: ", \
-					 __FILE__, __FUNCTION__, __LINE__); \
-					fprintf(stderr, format "\33[0m", ## __VA_ARGS__);}
-
-	#define debugBLUE(format, ...) {fprintf(stderr, DEBUG_BLUE "DEBUG[%s, %s, %d]: ", \
-					 __FILENAME__, __FUNCTION__, __LINE__); \
-					fprintf(stderr, format "\33[0m", ## __VA_ARGS__);}
-
-	#define debugGREEN(format, ...) {fprintf(stderr, DEBUG_GREEN "DEBUG[%s, %s, %d]: ", \
-					 __FILENAME__, __FUNCTION__, __LINE__); \
-					fprintf(stderr, format "\33[0m", ## __VA_ARGS__);}
-
-	#define debugColor(color, format, ...) {fprintf(stderr, color "DEBUG[%s, %s, %d]: ", \
-					 __FILENAME__, __FUNCTION__, __LINE__); \
-					fprintf(stderr, format "\33[0m", ## __VA_ARGS__);}
-
-	#define debugOPTIMIZATION(format, ...) {fprintf(stderr, DEBUG_ULINE DEBUG_INVERT "DEBUG[%s, %s, %d]: ", \
-					 __FILENAME__, __FUNCTION__, __LINE__); \
-					fprintf(stderr, format "\33[0m", ## __VA_ARGS__);}
-
-	#define debugRAUL(format, ...) {fprintf(stderr,DEBUG_BOLD DEBUG_YELLOW "DEBUG[%s, %s, %d]: ", \
-					 __FILE__, __FUNCTION__, __LINE__); \
-					fprintf(stderr, format "\33[0m" "\33[0m", ## __VA_ARGS__);}
-
-	#define debugERROR(format, ...) {fprintf(stderr, DEBUG_RED DEBUG_INVERT "DEBUG[%s, %s, %d]: ", \
-						 __FILE__, __FUNCTION__, __LINE__); \
-						fprintf(stderr, format "\33[0m", ## __VA_ARGS__);}
-
-	#define debugWARNING(format, ...) {fprintf(stderr, DEBUG_ULINE DEBUG_RED "DEBUG[%s, %s, %d]: ", \
-						 __FILE__, __FUNCTION__, __LINE__); \
-						fprintf(stderr, format "\33[0m", ## __VA_ARGS__);}
-
-	#define testBEGIN(format, ...) {fprintf(stdout, DEBUG_YELLOW "TEST_BEGIN[%s, %s, %d]: ", \
-					 __FILENAME__, __FUNCTION__, __LINE__); \
-					fprintf(stdout, format "\33[0m", ## __VA_ARGS__);}
-
-	#define testSUCCESS(format, ...) {fprintf(stdout, DEBUG_GREEN "TEST_SUCCESS[%s, %s, %d]: ", \
-					 __FILENAME__, __FUNCTION__, __LINE__); \
-					fprintf(stdout, format "\33[0m", ## __VA_ARGS__);}
 
-	#define testFAIL(format, ...) {fprintf(stdout, DEBUG_RED "TEST_FAIL[%s, %s, %d]: ", \
-					 __FILENAME__, __FUNCTION__, __LINE__); \
-					fprintf(stdout, format "\33[0m", ## __VA_ARGS__);}
+	// Print "<label>[file, function, line]: <message>". With FISHES_ASYNC_LOG
+	// the message is queued and written by a background thread (see
+	// AsyncLog.h), if not it is written synchronously.
+	// base = 1 prints only the basename of the file.
+	#ifdef FISHES_ASYNC_LOG
+		#include "AsyncLog.h"
+		#define DEBUG_PRINT(stream, label, base, format, ...) \
+				DEBUG_ASYNC_LOG(stream, label, base, format, ## __VA_ARGS__)
+	#else
+		#define DEBUG_PRINT(stream, label, base, format, ...) \
+				{fprintf(stream, label "[%s, %s, %d]: ", \
+				 (base) ? __FILENAME__ : __FILE__, __FUNCTION__, __LINE__); \
+				fprintf(stream, format "\33[0m", ## __VA_ARGS__);}
+	#endif
+
+	#if FISHES_LOG_LEVEL <= DEBUG_LEVEL_DEBUG
+		#define DEBUG_PRINT_DEBUG(...)		DEBUG_PRINT(__VA_ARGS__)
+	#else
+		#define DEBUG_PRINT_DEBUG(...)
+	#endif
+	#if FISHES_LOG_LEVEL <= DEBUG_LEVEL_WARNING
+		#define DEBUG_PRINT_WARNING(...)	DEBUG_PRINT(__VA_ARGS__)
+	#else
+		#define DEBUG_PRINT_WARNING(...)
+	#endif
+	#if FISHES_LOG_LEVEL <= DEBUG_LEVEL_ERROR
+		#define DEBUG_PRINT_ERROR(...)		DEBUG_PRINT(__VA_ARGS__)
+	#else
+		#define DEBUG_PRINT_ERROR(...)
+	#endif
+
+	#define debug(format, ...) DEBUG_PRINT_DEBUG(stderr, "\33[0mDEBUG", 0, \
+					format, ## __VA_ARGS__)
+
+	#define debugRED(format, ...) DEBUG_PRINT_DEBUG(stderr, DEBUG_RED "DEBUG", 0, \
+					format, ## __VA_ARGS__)
+
+	#define debugYELLOW(format, ...) DEBUG_PRINT_DEBUG(stderr, DEBUG_YELLOW "DEBUG", 0, \
+					format, ## __VA_ARGS__)
+
+	#define debugBLUE(format, ...) DEBUG_PRINT_DEBUG(stderr, DEBUG_BLUE "DEBUG", 1, \
+					format, ## __VA_ARGS__)
+
+	#define debugGREEN(format, ...) DEBUG_PRINT_DEBUG(stderr, DEBUG_GREEN "DEBUG", 1, \
+					format, ## __VA_ARGS__)
+
+	#define debugColor(color, format, ...) DEBUG_PRINT_DEBUG(stderr, color "DEBUG", 1, \
+					format, ## __VA_ARGS__)
+
+	#define debugOPTIMIZATION(format, ...) DEBUG_PRINT_DEBUG(stderr, \
+					DEBUG_ULINE DEBUG_INVERT "DEBUG", 1, format, ## __VA_ARGS__)
+
+	#define debugRAUL(format, ...) DEBUG_PRINT_DEBUG(stderr, \
+					DEBUG_BOLD DEBUG_YELLOW "DEBUG", 0, format, ## __VA_ARGS__)
+
+	#define debugERROR(format, ...) {DEBUG_FLIGHT_ERROR(format); \
+					DEBUG_PRINT_ERROR(stderr, DEBUG_RED DEBUG_INVERT "DEBUG", 0, \
+					format, ## __VA_ARGS__)}
+
+	#define debugWARNING(format, ...) {DEBUG_FLIGHT_WARNING(format); \
+					DEBUG_PRINT_WARNING(stderr, DEBUG_ULINE DEBUG_RED "DEBUG", 0, \
+					format, ## __VA_ARGS__)}
+
+	// the tests results are never filtered
+	#define testBEGIN(format, ...) DEBUG_PRINT(stdout, DEBUG_YELLOW "TEST_BEGIN", 1, \
+					format, ## __VA_ARGS__)
+
+	#define testSUCCESS(format, ...) DEBUG_PRINT(stdout, DEBUG_GREEN "TEST_SUCCESS", 1, \
+					format, ## __VA_ARGS__)
+
+	#define testFAIL(format, ...) DEBUG_PRINT(stdout, DEBUG_RED "TEST_FAIL", 1, \
+					format, ## __VA_ARGS__)
 
 #else
 	#define ASSERT(x)
@@ -118,8 +196,8 @@
 	#define debugColor(color, format, ...)
 	#define debugOPTIMIZATION(format, ...)
 	#define debugRAUL(format, ...)
-	#define debugERROR(format, ...)
-	#define debugWARNING(format, ...)
+	#define debugERROR(format, ...)	{DEBUG_FLIGHT_ERROR(format);}
+	#define debugWARNING(format, ...)	{DEBUG_FLIGHT_WARNING(format);}
 	#define testBEGIN(format, ...)
 	#define testSUCCESS(format, ...)
 	#define testFAIL(format, ...)
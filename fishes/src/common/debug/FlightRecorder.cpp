@@ -0,0 +1,172 @@
+/*
+ * FlightRecorder.cpp
+ *
+ *  Created on: Apr 14, 2013
+ *      Author: agustin
+ */
+
+#include "FlightRecorder.h"
+
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "DebugUtil.h"
+
+
+static_assert(sizeof(debug::FlightRecorder::FileHeader) == 64,
+              "The FileHeader is part of the file format");
+static_assert(sizeof(debug::FlightRecorder::Record) == 128,
+              "The Record is part of the file format");
+
+namespace debug {
+
+FlightRecorder *FlightRecorder::mInstance = 0;
+thread_local std::uint32_t FlightRecorder::tThreadId = 0;
+
+////////////////////////////////////////////////////////////////////////////////
+std::uint32_t
+FlightRecorder::threadId(void)
+{
+    tThreadId = static_cast<std::uint32_t>(::syscall(SYS_gettid));
+    return tThreadId;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+FlightRecorder::FlightRecorder() :
+    mOpen(false)
+,   mHeader(0)
+,   mRecords(0)
+,   mCapacity(0)
+,   mMapSize(0)
+,   mFrame(0)
+{
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+FlightRecorder::~FlightRecorder()
+{
+    close();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+FlightRecorder *
+FlightRecorder::getInstance(void)
+{
+    // created before any thread uses it (open() is called from main)
+    if (!mInstance) {
+        mInstance = new FlightRecorder;
+    }
+    return mInstance;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+FlightRecorder::open(const std::string &fName, std::size_t capacity)
+{
+    if (isOpen()) {
+        debugWARNING("The flight recorder is already open\n");
+        return false;
+    }
+    if (capacity == 0) {
+        debugERROR("Invalid capacity\n");
+        return false;
+    }
+
+    // keep the file of the last run (the one we want after a crash)
+    const std::string prev = fName + ".prev";
+    std::rename(fName.c_str(), prev.c_str());
+
+    const int fd = ::open(fName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        debugERROR("Error creating the flight recorder file %s\n",
+                   fName.c_str());
+        return false;
+    }
+    const std::size_t size = sizeof(FileHeader) + capacity * sizeof(Record);
+    if (::ftruncate(fd, size) != 0) {
+        debugERROR("Error resizing the flight recorder file %s\n",
+                   fName.c_str());
+        ::close(fd);
+        return false;
+    }
+    void *map = ::mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    // the mapping keeps the file
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        debugERROR("Error mapping the flight recorder file %s\n",
+                   fName.c_str());
+        return false;
+    }
+
+    // the file is zero filled: all the records are invalid (seq 0)
+    mHeader = static_cast<FileHeader *>(map);
+    mRecords = reinterpret_cast<Record *>(mHeader + 1);
+    mCapacity = capacity;
+    mMapSize = size;
+    mFrame = 0;
+
+    std::memcpy(mHeader->magic, "FISHFLR", 8);
+    mHeader->version = VERSION;
+    mHeader->recordSize = sizeof(Record);
+    mHeader->capacity = capacity;
+    mHeader->startTime = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    mHeader->pid = static_cast<std::uint32_t>(::getpid());
+    mHeader->cleanExit = 0;
+    mHeader->next.store(0, std::memory_order_relaxed);
+    mStart = std::chrono::steady_clock::now();
+
+    mOpen.store(true, std::memory_order_release);
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+FlightRecorder::close(void)
+{
+    if (!isOpen()) {
+        return;
+    }
+    // the threads still recording could be writing, the mapping is kept
+    mOpen.store(false, std::memory_order_release);
+    mHeader->cleanExit = 1;
+    ::msync(mHeader, mMapSize, MS_ASYNC);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+FlightRecorder::recordLog(int level, const char *file, int line,
+                          const char *format)
+{
+    if (!isOpen()) {
+        return;
+    }
+    std::uint64_t seq;
+    Record &record = begin(RECORD_LOG, seq);
+    record.level = static_cast<std::uint16_t>(level);
+    record.value = 0.f;
+    record.data = static_cast<std::uint32_t>(line);
+
+    // "file: format"
+    const char *slash = std::strrchr(file, '/');
+    file = (slash != 0) ? slash + 1 : file;
+    std::size_t len = std::strlen(file);
+    if (len > TEXT_SIZE / 2) {
+        len = TEXT_SIZE / 2;
+    }
+    std::memcpy(record.text, file, len);
+    record.text[len++] = ':';
+    record.text[len++] = ' ';
+    std::strncpy(record.text + len, format, TEXT_SIZE - len - 1);
+    record.text[TEXT_SIZE - 1] = '\0';
+    publish(record, seq);
+}
+
+} /* namespace debug */
@@ -0,0 +1,229 @@
+/*
+ * FlightRecorder.h
+ *
+ *  Created on: Apr 14, 2013
+ *      Author: agustin
+ */
+
+#ifndef FLIGHTRECORDER_H_
+#define FLIGHTRECORDER_H_
+
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+
+// Recording macros. They compile to nothing unless FISHES_FLIGHT_RECORDER is
+// defined (cmake -DFISHES_FLIGHT_RECORDER=ON, the default), and do nothing
+// until FlightRecorder::open() is called.
+//  FLIGHT_RECORD_FRAME(timeFrame);                     // seconds
+//  FLIGHT_RECORD_LOAD(fName.c_str(), seconds, ok);
+//  FLIGHT_RECORD_LOG(DEBUG_LEVEL_ERROR, "format");     // only the format
+//
+#ifdef FISHES_FLIGHT_RECORDER
+    #define FLIGHT_RECORD_FRAME(seconds) \
+        debug::FlightRecorder::getInstance()->recordFrame(seconds)
+    #define FLIGHT_RECORD_LOAD(name, seconds, ok) \
+        debug::FlightRecorder::getInstance()->recordLoad(name, seconds, ok)
+    #define FLIGHT_RECORD_LOG(level, format) \
+        debug::FlightRecorder::getInstance()->recordLog(level, __FILE__, \
+                                                         __LINE__, format)
+#else
+    #define FLIGHT_RECORD_FRAME(seconds)
+    #define FLIGHT_RECORD_LOAD(name, seconds, ok)
+    #define FLIGHT_RECORD_LOG(level, format)
+#endif
+
+
+namespace debug {
+
+// @brief Keeps the last records (frame times, asset loads and log events) in
+// a fixed size ring stored in a memory mapped file. The pages belong to the
+// kernel, so the file keeps everything recorded until the very last moment
+// even if the process crashes (only a power loss would lose them).
+// Recording is lock free: an atomic increment, a clock read and a copy of
+// 128 bytes, from any thread.
+// The file is decoded offline with extras/FlightDecoder; the file of the
+// previous run is kept as <fName>.prev.
+//
+class FlightRecorder
+{
+public:
+    // The default number of records (4 MB, ~9 minutes of frames at 60 fps)
+    static const std::size_t DEFAULT_CAPACITY = 1 << 15;
+
+    static const std::uint32_t VERSION = 1;
+    static const std::size_t TEXT_SIZE = 96;
+
+    enum RecordType {
+        RECORD_FRAME = 1,   // value: seconds, data: frame number
+        RECORD_LOAD,        // value: seconds, data: 1 if loaded, text: name
+        RECORD_LOG,         // level, data: line, text: "file: format"
+    };
+
+    // The layout of the file: a FileHeader followed by capacity Records.
+    // Record i (seq = i + 1) is stored at records[i % capacity]. A record
+    // whose seq does not match its slot was being written (torn) and is
+    // ignored.
+    struct FileHeader {
+        char magic[8];                      // "FISHFLR"
+        std::uint32_t version;
+        std::uint32_t recordSize;
+        std::uint64_t capacity;
+        std::uint64_t startTime;            // ns since epoch (wall clock)
+        std::uint32_t pid;
+        std::uint32_t cleanExit;            // 1 after close()
+        std::atomic<std::uint64_t> next;    // records written so far
+        char padding[64 - 48];
+    };
+
+    struct Record {
+        std::atomic<std::uint64_t> seq;
+        std::uint64_t time;                 // ns since startTime
+        std::uint16_t type;
+        std::uint16_t level;
+        std::uint32_t tid;
+        float value;
+        std::uint32_t data;
+        char text[TEXT_SIZE];
+    };
+
+public:
+    // @brief Returns the instance
+    static FlightRecorder *getInstance(void);
+
+    // @brief Create (truncate) the file and start recording
+    // @param   fName       The file name
+    // @param   capacity    The number of records kept
+    // @returns true on success, false otherwise
+    bool open(const std::string &fName,
+              std::size_t capacity = DEFAULT_CAPACITY);
+
+    // @brief Mark the file as cleanly closed and stop recording
+    void close(void);
+
+    // @brief Returns true if it is recording
+    inline bool isOpen(void) const;
+
+    // @brief Record the duration of a frame (seconds)
+    inline void recordFrame(float seconds);
+
+    // @brief Record an asset load
+    // @param   name        The asset (the end is kept if it is too long)
+    // @param   seconds     The load time
+    // @param   ok          If it was loaded
+    inline void recordLoad(const char *name, float seconds, bool ok);
+
+    // @brief Record a log event (the format, the arguments are not kept)
+    void recordLog(int level, const char *file, int line, const char *format);
+
+private:
+    FlightRecorder();
+    ~FlightRecorder();
+
+    // avoid copying
+    FlightRecorder(const FlightRecorder &);
+    FlightRecorder &operator=(const FlightRecorder &);
+
+    // @brief Take the next record and fill the common fields, the caller
+    // fills the rest and calls publish()
+    inline Record &begin(RecordType type, std::uint64_t &seq);
+    inline void publish(Record &record, std::uint64_t seq);
+
+    static std::uint32_t threadId(void);
+
+    // @brief Copy the last size - 1 chars of str at most
+    static inline void copyTail(char *dest, std::size_t size, const char *str);
+
+private:
+    static FlightRecorder *mInstance;
+    static thread_local std::uint32_t tThreadId;
+
+    std::atomic<bool> mOpen;
+    FileHeader *mHeader;
+    Record *mRecords;
+    std::size_t mCapacity;
+    std::size_t mMapSize;
+    std::uint32_t mFrame;
+    std::chrono::steady_clock::time_point mStart;
+};
+
+
+// Inline implementations
+//
+
+inline bool
+FlightRecorder::isOpen(void) const
+{
+    return mOpen.load(std::memory_order_acquire);
+}
+
+inline FlightRecorder::Record &
+FlightRecorder::begin(RecordType type, std::uint64_t &seq)
+{
+    const std::uint64_t index =
+        mHeader->next.fetch_add(1, std::memory_order_relaxed);
+    seq = index + 1;
+    Record &record = mRecords[index % mCapacity];
+    // invalid while we write it
+    record.seq.store(0, std::memory_order_relaxed);
+    record.time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - mStart).count();
+    record.type = type;
+    record.level = 0;
+    record.tid = (tThreadId != 0) ? tThreadId : threadId();
+    return record;
+}
+
+inline void
+FlightRecorder::publish(Record &record, std::uint64_t seq)
+{
+    record.seq.store(seq, std::memory_order_release);
+}
+
+inline void
+FlightRecorder::copyTail(char *dest, std::size_t size, const char *str)
+{
+    std::size_t len = std::strlen(str);
+    if (len >= size) {
+        str += len - (size - 1);
+        len = size - 1;
+    }
+    std::memcpy(dest, str, len);
+    dest[len] = '\0';
+}
+
+inline void
+FlightRecorder::recordFrame(float seconds)
+{
+    if (!isOpen()) {
+        return;
+    }
+    std::uint64_t seq;
+    Record &record = begin(RECORD_FRAME, seq);
+    record.value = seconds;
+    // only the main loop records frames
+    record.data = mFrame++;
+    record.text[0] = '\0';
+    publish(record, seq);
+}
+
+inline void
+FlightRecorder::recordLoad(const char *name, float seconds, bool ok)
+{
+    if (!isOpen()) {
+        return;
+    }
+    std::uint64_t seq;
+    Record &record = begin(RECORD_LOAD, seq);
+    record.value = seconds;
+    record.data = ok ? 1 : 0;
+    copyTail(record.text, TEXT_SIZE, name);
+    publish(record, seq);
+}
+
+} /* namespace debug */
+#endif /* FLIGHTRECORDER_H_ */
@@ -0,0 +1,252 @@
+/*
+ * Profiler.cpp
+ *
+ *  Created on: Apr 12, 2013
+ *      Author: agustin
+ */
+
+#include "Profiler.h"
+
+#include <cstdio>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "DebugUtil.h"
+
+
+// auxiliar functions
+namespace {
+// Returns a string escaped to be put between quotes in JSON
+std::string
+jsonEscape(const char *str)
+{
+    std::string result;
+    for (; *str != '\0'; ++str) {
+        const char c = *str;
+        if (c == '"' || c == '\\') {
+            result += '\\';
+            result += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            result += escaped;
+        } else {
+            result += c;
+        }
+    }
+    return result;
+}
+}
+
+namespace debug {
+
+Profiler *Profiler::mInstance = 0;
+std::once_flag Profiler::mCreateFlag;
+thread_local Profiler::ThreadRing *Profiler::tRing = 0;
+
+////////////////////////////////////////////////////////////////////////////////
+Profiler::ThreadRing &
+Profiler::createRing(void)
+{
+    ThreadRing *ring = new ThreadRing;
+    ring->written.store(0, std::memory_order_relaxed);
+    ring->read = 0;
+    ring->tid = static_cast<std::uint32_t>(::syscall(SYS_gettid));
+    ring->name = 0;
+
+    // the rings are never released (the thread could finish before its
+    // events are flushed)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mRings.push_back(ring);
+    }
+    tRing = ring;
+    return *ring;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+Profiler::drain(ThreadRing &ring)
+{
+    const std::uint64_t written = ring.written.load(std::memory_order_acquire);
+    std::uint64_t read = ring.read;
+
+    // the oldest events were overwritten
+    if (written - read > RING_SIZE) {
+        mDropped.fetch_add(written - read - RING_SIZE, std::memory_order_relaxed);
+        read = written - RING_SIZE;
+    }
+
+    const std::size_t first = mTrace.size();
+    for (; read < written; ++read) {
+        TraceEvent traceEvent;
+        traceEvent.event = ring.events[read & (RING_SIZE - 1)];
+        traceEvent.tid = ring.tid;
+        mTrace.push_back(traceEvent);
+    }
+
+    // the thread could have overwritten the events we were copying, discard
+    // them (the ones older than the last RING_SIZE - 1 written)
+    const std::uint64_t after = ring.written.load(std::memory_order_acquire);
+    if (after - ring.read >= RING_SIZE) {
+        // the slot of the event being written (after) is not valid either
+        const std::uint64_t oldestValid = after - RING_SIZE + 1;
+        const std::uint64_t copiedFrom = written - (mTrace.size() - first);
+        if (oldestValid > copiedFrom) {
+            const std::size_t overwritten = static_cast<std::size_t>(
+                std::min<std::uint64_t>(oldestValid - copiedFrom,
+                                        mTrace.size() - first));
+            mTrace.erase(mTrace.begin() + first,
+                         mTrace.begin() + first + overwritten);
+            mDropped.fetch_add(overwritten, std::memory_order_relaxed);
+        }
+    }
+    ring.read = written;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+Profiler::trim(void)
+{
+    if (mTrace.size() > mMaxEvents) {
+        const std::size_t excess = mTrace.size() - mMaxEvents;
+        mTrace.erase(mTrace.begin(), mTrace.begin() + excess);
+        mDropped.fetch_add(excess, std::memory_order_relaxed);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+Profiler::create(void)
+{
+    mInstance = new Profiler;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+Profiler::Profiler() :
+    mEnabled(true)
+,   mStart(std::chrono::steady_clock::now())
+,   mDropped(0)
+,   mMaxEvents(MAX_EVENTS)
+{
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+Profiler::~Profiler()
+{
+    for (std::size_t i = 0; i < mRings.size(); ++i) {
+        delete mRings[i];
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+Profiler *
+Profiler::getInstance(void)
+{
+    // the first PROFILE_* can come from any thread (workers, loaders)
+    std::call_once(mCreateFlag, &Profiler::create);
+    return mInstance;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+Profiler::setThreadName(const char *name)
+{
+    getInstance()->ring().name = name;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+Profiler::flush(void)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (std::size_t i = 0; i < mRings.size(); ++i) {
+        drain(*mRings[i]);
+    }
+    trim();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+Profiler::exportChromeTrace(const std::string &fName)
+{
+    flush();
+
+    FILE *file = std::fopen(fName.c_str(), "w");
+    if (file == 0) {
+        debugERROR("Error opening the trace file %s\n", fName.c_str());
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    const int pid = static_cast<int>(::getpid());
+    std::fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+
+    // the names of the threads
+    bool first = true;
+    for (std::size_t i = 0; i < mRings.size(); ++i) {
+        if (mRings[i]->name == 0) {
+            continue;
+        }
+        std::fprintf(file, "%s{\"name\": \"thread_name\", \"ph\": \"M\", "
+                     "\"pid\": %d, \"tid\": %u, \"args\": {\"name\": \"%s\"}}",
+                     first ? "" : ",\n", pid, mRings[i]->tid,
+                     jsonEscape(mRings[i]->name).c_str());
+        first = false;
+    }
+
+    // the scopes as complete events (times in microseconds)
+    for (std::size_t i = 0; i < mTrace.size(); ++i) {
+        const TraceEvent &t = mTrace[i];
+        std::fprintf(file, "%s{\"name\": \"%s\", \"ph\": \"X\", \"pid\": %d, "
+                     "\"tid\": %u, \"ts\": %.3f, \"dur\": %.3f}",
+                     first ? "" : ",\n", jsonEscape(t.event.name).c_str(),
+                     pid, t.tid,
+                     t.event.begin * 1e-3,
+                     (t.event.end - t.event.begin) * 1e-3);
+        first = false;
+    }
+    std::fprintf(file, "\n]}\n");
+
+    const bool ok = !std::ferror(file);
+    std::fclose(file);
+    if (!ok) {
+        debugERROR("Error writing the trace file %s\n", fName.c_str());
+    }
+    return ok;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+Profiler::clear(void)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (std::size_t i = 0; i < mRings.size(); ++i) {
+        mRings[i]->read = mRings[i]->written.load(std::memory_order_acquire);
+    }
+    mTrace.clear();
+    mDropped.store(0, std::memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+Profiler::setMaxEvents(std::size_t maxEvents)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mMaxEvents = maxEvents;
+    trim();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t
+Profiler::numEvents(void)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mTrace.size();
+}
+
+} /* namespace debug */
@@ -0,0 +1,266 @@
+/*
+ * Profiler.h
+ *
+ *  Created on: Apr 12, 2013
+ *      Author: agustin
+ */
+
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+
+// Scoped timing macros. They compile to nothing unless FISHES_PROFILER is
+// defined (cmake -DFISHES_PROFILER=ON), so they can be left in the hot paths.
+// The name must be a string literal (only the pointer is recorded).
+//
+//  void AnimatedSprite::update(float timeFrame)
+//  {
+//      PROFILE_FUNCTION();
+//      ...
+//      {
+//          PROFILE_SCOPE("configureRect");
+//          ...
+//      }
+//  }
+//
+#ifdef FISHES_PROFILER
+    #define PROFILE_CONCAT_(a, b)   a ## b
+    #define PROFILE_CONCAT(a, b)    PROFILE_CONCAT_(a, b)
+    #define PROFILE_SCOPE(name) \
+        debug::ProfileScope PROFILE_CONCAT(profileScope_, __LINE__)(name)
+    #define PROFILE_FUNCTION()      PROFILE_SCOPE(__FUNCTION__)
+    #define PROFILE_THREAD(name)    debug::Profiler::setThreadName(name)
+#else
+    #define PROFILE_SCOPE(name)
+    #define PROFILE_FUNCTION()
+    #define PROFILE_THREAD(name)
+#endif
+
+
+namespace debug {
+
+// @brief Process-wide profiler. Each thread records its scopes (begin and end
+// time) in its own ring buffer, without locks nor allocations, so recording
+// costs a couple of clock reads. The rings are drained by flush(), called
+// out of the hot path (i.e. once per frame from the main loop), into the
+// trace kept in memory, which can be exported as Chrome trace JSON (open it in
+// chrome://tracing or https://ui.perfetto.dev).
+// If a thread records more than RING_SIZE scopes between two flushes the
+// oldest ones are lost, and the trace keeps only the last maxEvents() ones
+// (so flushing every frame for a long time doesn't grow it forever), both
+// are counted in droppedEvents().
+//
+class Profiler
+{
+public:
+    // The number of events of each thread ring (power of 2)
+    static const std::size_t RING_SIZE = 1 << 16;
+    // The default max number of events of the trace (32 MB)
+    static const std::size_t MAX_EVENTS = 1 << 20;
+
+    // A recorded scope
+    struct Event {
+        const char *name;
+        std::uint64_t begin;    // ns since the profiler started
+        std::uint64_t end;
+    };
+
+public:
+    // @brief Returns the instance
+    static Profiler *getInstance(void);
+
+    // @brief Enable / disable the recording at runtime (enabled by default)
+    inline void setEnabled(bool enabled);
+    inline bool isEnabled(void) const;
+
+    // @brief Returns the current time (ns since the profiler started)
+    inline std::uint64_t now(void) const;
+
+    // @brief Record a scope of the calling thread
+    inline void record(const char *name, std::uint64_t begin, std::uint64_t end);
+
+    // @brief Name the calling thread in the trace (string literal)
+    static void setThreadName(const char *name);
+
+    // @brief Move the events of all the rings to the trace. Can be called
+    // from any thread (usually the main one, once per frame).
+    void flush(void);
+
+    // @brief Flush and write the trace as Chrome trace JSON
+    // @param   fName   The file name
+    // @returns true on success, false otherwise
+    bool exportChromeTrace(const std::string &fName);
+
+    // @brief Remove all the events of the trace (the rings are flushed and
+    // discarded)
+    void clear(void);
+
+    // @brief Set the max number of events of the trace, the oldest ones are
+    // dropped when it is full
+    void setMaxEvents(std::size_t maxEvents);
+    inline std::size_t maxEvents(void) const;
+
+    // @brief Returns the number of events in the trace / lost
+    std::size_t numEvents(void);
+    inline std::size_t droppedEvents(void) const;
+
+private:
+    Profiler();
+    ~Profiler();
+
+    // avoid copying
+    Profiler(const Profiler &);
+    Profiler &operator=(const Profiler &);
+
+    // The ring of a thread. Only its thread writes it, only flush() (under
+    // mMutex) reads it.
+    struct ThreadRing {
+        Event events[RING_SIZE];
+        // events written / read so far (never wrapped)
+        std::atomic<std::uint64_t> written;
+        std::uint64_t read;
+        std::uint32_t tid;
+        const char *name;
+    };
+
+    // An event of the trace
+    struct TraceEvent {
+        Event event;
+        std::uint32_t tid;
+    };
+
+    // @brief Returns the ring of the calling thread (created the first time)
+    inline ThreadRing &ring(void);
+    ThreadRing &createRing(void);
+
+    // @brief Drain a ring into the trace (mMutex must be taken)
+    void drain(ThreadRing &ring);
+
+    // @brief Drop the oldest events of the trace over the max (mMutex must
+    // be taken)
+    void trim(void);
+
+    // @brief Create the instance (only once)
+    static void create(void);
+
+private:
+    static Profiler *mInstance;
+    static std::once_flag mCreateFlag;
+    static thread_local ThreadRing *tRing;
+
+    std::atomic<bool> mEnabled;
+    std::chrono::steady_clock::time_point mStart;
+    std::atomic<std::size_t> mDropped;
+
+    // protect the list of rings and the trace
+    std::mutex mMutex;
+    std::vector<ThreadRing *> mRings;
+    std::deque<TraceEvent> mTrace;
+    std::size_t mMaxEvents;
+};
+
+
+// @brief Record the lifetime of a scope (see PROFILE_SCOPE)
+//
+class ProfileScope
+{
+public:
+    inline ProfileScope(const char *name);
+    inline ~ProfileScope();
+
+private:
+    // avoid copying
+    ProfileScope(const ProfileScope &);
+    ProfileScope &operator=(const ProfileScope &);
+
+private:
+    const char *mName;
+    std::uint64_t mBegin;
+};
+
+
+// Inline implementations
+//
+
+inline void
+Profiler::setEnabled(bool enabled)
+{
+    mEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+inline bool
+Profiler::isEnabled(void) const
+{
+    return mEnabled.load(std::memory_order_relaxed);
+}
+
+inline std::uint64_t
+Profiler::now(void) const
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - mStart).count();
+}
+
+inline Profiler::ThreadRing &
+Profiler::ring(void)
+{
+    return (tRing != 0) ? *tRing : createRing();
+}
+
+inline void
+Profiler::record(const char *name, std::uint64_t begin, std::uint64_t end)
+{
+    ThreadRing &r = ring();
+    const std::uint64_t index = r.written.load(std::memory_order_relaxed);
+    Event &event = r.events[index & (RING_SIZE - 1)];
+    event.name = name;
+    event.begin = begin;
+    event.end = end;
+    // publish the event to flush()
+    r.written.store(index + 1, std::memory_order_release);
+}
+
+inline std::size_t
+Profiler::maxEvents(void) const
+{
+    return mMaxEvents;
+}
+
+inline std::size_t
+Profiler::droppedEvents(void) const
+{
+    return mDropped.load(std::memory_order_relaxed);
+}
+
+inline
+ProfileScope::ProfileScope(const char *name) :
+    mName(0)
+,   mBegin(0)
+{
+    Profiler *profiler = Profiler::getInstance();
+    if (profiler->isEnabled()) {
+        mName = name;
+        mBegin = profiler->now();
+    }
+}
+
+inline
+ProfileScope::~ProfileScope()
+{
+    if (mName != 0) {
+        Profiler *profiler = Profiler::getInstance();
+        profiler->record(mName, mBegin, profiler->now());
+    }
+}
+
+} /* namespace debug */
+#endif /* PROFILER_H_ */
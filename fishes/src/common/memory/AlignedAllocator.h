@@ -0,0 +1,77 @@
+/*
+ * AlignedAllocator.h
+ *
+ *  Created on: Apr 6, 2013
+ *      Author: agustin
+ */
+
+#ifndef ALIGNEDALLOCATOR_H_
+#define ALIGNEDALLOCATOR_H_
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+
+namespace memory {
+
+// The size of the cache line we align to
+static const std::size_t CACHE_LINE_SIZE = 64;
+
+// @brief Allocator for the std containers that returns memory aligned to
+// ALIGNMENT bytes (i.e. std::vector<float, AlignedAllocator<float> >), used
+// to avoid sharing cache lines between arrays processed by different threads.
+//
+template<typename T, std::size_t ALIGNMENT = CACHE_LINE_SIZE>
+class AlignedAllocator
+{
+public:
+    static_assert(ALIGNMENT >= sizeof(void *) &&
+                  (ALIGNMENT & (ALIGNMENT - 1)) == 0,
+                  "The alignment must be a power of 2");
+
+    typedef T value_type;
+    typedef T *pointer;
+    typedef const T *const_pointer;
+    typedef T &reference;
+    typedef const T &const_reference;
+    typedef std::size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+
+    template<typename U>
+    struct rebind {
+        typedef AlignedAllocator<U, ALIGNMENT> other;
+    };
+
+public:
+    AlignedAllocator() {}
+    template<typename U>
+    AlignedAllocator(const AlignedAllocator<U, ALIGNMENT> &) {}
+
+    inline T *allocate(std::size_t count)
+    {
+        void *ptr = 0;
+        if (posix_memalign(&ptr, ALIGNMENT, count * sizeof(T)) != 0) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T *>(ptr);
+    }
+    inline void deallocate(T *ptr, std::size_t)
+    {
+        std::free(ptr);
+    }
+
+    template<typename U>
+    inline bool operator==(const AlignedAllocator<U, ALIGNMENT> &) const
+    {
+        return true;
+    }
+    template<typename U>
+    inline bool operator!=(const AlignedAllocator<U, ALIGNMENT> &) const
+    {
+        return false;
+    }
+};
+
+} /* namespace memory */
+#endif /* ALIGNEDALLOCATOR_H_ */
@@ -0,0 +1,259 @@
+/*
+ * MemoryTracker.cpp
+ *
+ *  Created on: Apr 15, 2013
+ *      Author: agustin
+ */
+
+#include "MemoryTracker.h"
+
+#include <new>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+
+
+// auxiliar functions
+namespace {
+
+// The counters, constant initialized (used before main())
+std::atomic<std::size_t> sLive[memory::MemoryTracker::TAG_COUNT];
+std::atomic<std::size_t> sPeak[memory::MemoryTracker::TAG_COUNT];
+std::atomic<std::size_t> sAllocations[memory::MemoryTracker::TAG_COUNT];
+std::atomic<std::size_t> sFrees[memory::MemoryTracker::TAG_COUNT];
+
+thread_local memory::MemoryTracker::Tag tCurrentTag =
+    memory::MemoryTracker::TAG_OTHER;
+
+const char *TAG_NAMES[memory::MemoryTracker::TAG_COUNT] = {
+    "other", "ui", "animation", "textures", "file_io"
+};
+
+#ifdef FISHES_MEMORY_TRACKING
+// The header of each allocation (keeps the 16 bytes alignment of malloc)
+struct Header {
+    std::size_t size;
+    std::uint32_t tag;
+    std::uint32_t magic;
+};
+static_assert(sizeof(Header) == 16, "The header must keep the alignment");
+const std::uint32_t HEADER_MAGIC = 0x4d454d54;  // "MEMT"
+
+void *
+trackedAlloc(std::size_t size)
+{
+    Header *header = static_cast<Header *>(std::malloc(sizeof(Header) + size));
+    if (header == 0) {
+        return 0;
+    }
+    header->size = size;
+    header->tag = tCurrentTag;
+    header->magic = HEADER_MAGIC;
+    memory::MemoryTracker::allocated(tCurrentTag, size);
+    return header + 1;
+}
+
+void
+trackedFree(void *ptr)
+{
+    if (ptr == 0) {
+        return;
+    }
+    Header *header = static_cast<Header *>(ptr) - 1;
+    // a wrong pointer (or a double delete), crash here and not later
+    if (header->magic != HEADER_MAGIC) {
+        std::abort();
+    }
+    header->magic = 0;
+    memory::MemoryTracker::freed(
+        static_cast<memory::MemoryTracker::Tag>(header->tag), header->size);
+    std::free(header);
+}
+
+// Print the report at exit
+struct ReportAtExit {
+    static void print(void)
+    {
+        memory::MemoryTracker::report(stderr);
+    }
+    ReportAtExit()
+    {
+        std::atexit(&ReportAtExit::print);
+    }
+};
+ReportAtExit sReportAtExit;
+#endif
+
+}
+
+
+#ifdef FISHES_MEMORY_TRACKING
+////////////////////////////////////////////////////////////////////////////////
+void *
+operator new(std::size_t size)
+{
+    void *ptr = trackedAlloc(size);
+    if (ptr == 0) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void *
+operator new[](std::size_t size)
+{
+    void *ptr = trackedAlloc(size);
+    if (ptr == 0) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void *
+operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    return trackedAlloc(size);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void *
+operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+    return trackedAlloc(size);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+operator delete(void *ptr) noexcept
+{
+    trackedFree(ptr);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+operator delete[](void *ptr) noexcept
+{
+    trackedFree(ptr);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+operator delete(void *ptr, const std::nothrow_t &) noexcept
+{
+    trackedFree(ptr);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+operator delete[](void *ptr, const std::nothrow_t &) noexcept
+{
+    trackedFree(ptr);
+}
+#endif
+
+
+namespace memory {
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+MemoryTracker::isEnabled(void)
+{
+#ifdef FISHES_MEMORY_TRACKING
+    return true;
+#else
+    return false;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+MemoryTracker::Stats
+MemoryTracker::stats(Tag tag)
+{
+    Stats stats;
+    stats.liveBytes = sLive[tag].load(std::memory_order_relaxed);
+    stats.peakBytes = sPeak[tag].load(std::memory_order_relaxed);
+    stats.allocations = sAllocations[tag].load(std::memory_order_relaxed);
+    stats.frees = sFrees[tag].load(std::memory_order_relaxed);
+    return stats;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+MemoryTracker::Stats
+MemoryTracker::total(void)
+{
+    Stats total = {0, 0, 0, 0};
+    for (int i = 0; i < TAG_COUNT; ++i) {
+        const Stats s = stats(static_cast<Tag>(i));
+        total.liveBytes += s.liveBytes;
+        total.peakBytes += s.peakBytes;
+        total.allocations += s.allocations;
+        total.frees += s.frees;
+    }
+    return total;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const char *
+MemoryTracker::tagName(Tag tag)
+{
+    return (tag >= 0 && tag < TAG_COUNT) ? TAG_NAMES[tag] : "invalid";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+MemoryTracker::Tag
+MemoryTracker::currentTag(void)
+{
+    return tCurrentTag;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+MemoryTracker::Tag
+MemoryTracker::setCurrentTag(Tag tag)
+{
+    const Tag previous = tCurrentTag;
+    tCurrentTag = tag;
+    return previous;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+MemoryTracker::report(FILE *file)
+{
+    std::fprintf(file, "%-10s %14s %14s %12s %12s\n", "memory", "live bytes",
+                 "peak bytes", "allocs", "frees");
+    for (int i = 0; i < TAG_COUNT; ++i) {
+        const Stats s = stats(static_cast<Tag>(i));
+        std::fprintf(file, "%-10s %14zu %14zu %12zu %12zu\n",
+                     TAG_NAMES[i], s.liveBytes, s.peakBytes, s.allocations,
+                     s.frees);
+    }
+    const Stats t = total();
+    std::fprintf(file, "%-10s %14zu %14s %12zu %12zu\n", "total",
+                 t.liveBytes, "", t.allocations, t.frees);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+MemoryTracker::allocated(Tag tag, std::size_t bytes)
+{
+    const std::size_t live =
+        sLive[tag].fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    sAllocations[tag].fetch_add(1, std::memory_order_relaxed);
+    std::size_t peak = sPeak[tag].load(std::memory_order_relaxed);
+    while (live > peak &&
+           !sPeak[tag].compare_exchange_weak(peak, live,
+                                             std::memory_order_relaxed)) {
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+MemoryTracker::freed(Tag tag, std::size_t bytes)
+{
+    sLive[tag].fetch_sub(bytes, std::memory_order_relaxed);
+    sFrees[tag].fetch_add(1, std::memory_order_relaxed);
+}
+
+} /* namespace memory */
@@ -0,0 +1,123 @@
+/*
+ * MemoryTracker.h
+ *
+ *  Created on: Apr 15, 2013
+ *      Author: agustin
+ */
+
+#ifndef MEMORYTRACKER_H_
+#define MEMORYTRACKER_H_
+
+#include <cstddef>
+#include <cstdio>
+
+
+// Tag the allocations done in a scope (and in all the functions called from
+// it) with a subsystem. Compiles to nothing unless FISHES_MEMORY_TRACKING is
+// defined (cmake -DFISHES_MEMORY_TRACKING=ON).
+//
+//  TextureHandle TextureCache::get(const std::string &fName)
+//  {
+//      MEMORY_TAG_SCOPE(TEXTURES);
+//      ...
+//  }
+//
+#ifdef FISHES_MEMORY_TRACKING
+    #define MEMORY_CONCAT_(a, b)    a ## b
+    #define MEMORY_CONCAT(a, b)     MEMORY_CONCAT_(a, b)
+    #define MEMORY_TAG_SCOPE(tag) \
+        memory::MemoryTagScope MEMORY_CONCAT(memoryTagScope_, __LINE__)( \
+            memory::MemoryTracker::TAG_ ## tag)
+#else
+    #define MEMORY_TAG_SCOPE(tag)
+#endif
+
+
+namespace memory {
+
+// @brief Counts the heap memory of each subsystem. When FISHES_MEMORY_TRACKING
+// is defined the global operator new / delete are replaced: each allocation
+// takes a 16 bytes header with its size and the tag of the thread when it was
+// allocated (see MEMORY_TAG_SCOPE), so it is released from the right
+// subsystem wherever it is deleted. The counters are atomics (no locks).
+// Everything allocated through new (std containers, boost::shared_ptr, the
+// SFML objects) is counted; malloc() and posix_memalign() are not.
+// The report is printed to stderr at exit.
+//
+// Only static functions: it has to work from operator new, before main().
+//
+class MemoryTracker
+{
+public:
+    enum Tag {
+        TAG_OTHER = 0,      // not tagged
+        TAG_UI,             // sprites, pools, grids, animation systems
+        TAG_ANIMATION,      // animation sets, frame tables and libraries
+        TAG_TEXTURES,       // textures and decoded images
+        TAG_FILE_IO,        // file contents, paths and lists of files
+        TAG_COUNT
+    };
+
+    struct Stats {
+        std::size_t liveBytes;
+        std::size_t peakBytes;
+        std::size_t allocations;    // so far
+        std::size_t frees;
+    };
+
+public:
+    // @brief Returns true if the tracking is compiled in
+    static bool isEnabled(void);
+
+    // @brief Returns the counters of a tag
+    static Stats stats(Tag tag);
+
+    // @brief Returns the counters of all the tags together (the peak is the
+    // sum of the peaks)
+    static Stats total(void);
+
+    // @brief Returns the name of a tag ("ui", "textures", ...)
+    static const char *tagName(Tag tag);
+
+    // @brief The tag of the allocations of the calling thread
+    static Tag currentTag(void);
+    static Tag setCurrentTag(Tag tag);
+
+    // @brief Print a table with the counters of each tag
+    static void report(FILE *file);
+
+    // @brief Count memory allocated / released by other means (called by
+    // operator new / delete)
+    static void allocated(Tag tag, std::size_t bytes);
+    static void freed(Tag tag, std::size_t bytes);
+
+private:
+    MemoryTracker();
+};
+
+
+// @brief Set the tag of the calling thread while it lives (see
+// MEMORY_TAG_SCOPE)
+//
+class MemoryTagScope
+{
+public:
+    inline MemoryTagScope(MemoryTracker::Tag tag) :
+        mPrevious(MemoryTracker::setCurrentTag(tag))
+    {}
+    inline ~MemoryTagScope()
+    {
+        MemoryTracker::setCurrentTag(mPrevious);
+    }
+
+private:
+    // avoid copying
+    MemoryTagScope(const MemoryTagScope &);
+    MemoryTagScope &operator=(const MemoryTagScope &);
+
+private:
+    MemoryTracker::Tag mPrevious;
+};
+
+} /* namespace memory */
+#endif /* MEMORYTRACKER_H_ */
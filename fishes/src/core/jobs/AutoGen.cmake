@@ -0,0 +1,21 @@
+IF(NOT DEV_ROOT_PATH)
+	message(SEND_ERROR "No esta seteado DEV_ROOT_PATH")
+endif()
+
+set(CP /core/jobs)
+
+set(SRCS
+	${SRCS}
+	${DEV_ROOT_PATH}/core/jobs/JobSystem.cpp
+)
+
+set(HDRS
+	${HDRS}
+	${DEV_ROOT_PATH}/core/jobs/JobSystem.h
+)
+
+set(ACTUAL_DIRS
+	${DEV_ROOT_PATH}/core/jobs
+)
+
+include_directories(${ACTUAL_DIRS})
@@ -0,0 +1,312 @@
+/*
+ * JobSystem.cpp
+ *
+ *  Created on: Apr 6, 2013
+ *      Author: agustin
+ */
+
+#include "JobSystem.h"
+
+#include <debug/DebugUtil.h>
+#include <debug/Profiler.h>
+
+
+namespace jobs {
+
+////////////////////////////////////////////////////////////////////////////////
+JobSystem::Job *
+JobSystem::create(const Task &task, Job *parent)
+{
+    mJobs.emplace_back();
+    Job *job = &mJobs.back();
+    job->task = task;
+    job->parent = parent;
+    job->pending.store(1, std::memory_order_relaxed);
+    job->waiting.store(1, std::memory_order_relaxed);
+    job->done = false;
+    if (parent != 0) {
+        parent->pending.fetch_add(1, std::memory_order_relaxed);
+    }
+    mUnfinished.fetch_add(1, std::memory_order_relaxed);
+    return job;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+JobSystem::schedule(Job *job, Job *const *deps, std::size_t numDeps)
+{
+    if (numDeps > 0) {
+        ASSERT(deps != 0);
+        std::lock_guard<std::mutex> lock(mDepsMutex);
+        for (std::size_t i = 0; i < numDeps; ++i) {
+            if (!deps[i]->done) {
+                deps[i]->dependents.push_back(job);
+                job->waiting.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // remove the scheduling guard, if the dependencies are already finished
+    // the job can run
+    if (job->waiting.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        enqueue(job, mNextQueue);
+        mNextQueue = (mNextQueue + 1) % mQueues.size();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+JobSystem::enqueue(Job *job, std::size_t queue)
+{
+    Queue &q = *mQueues[queue];
+    {
+        std::lock_guard<std::mutex> lock(q.mutex);
+        q.jobs.push_back(job);
+    }
+    mQueued.fetch_add(1, std::memory_order_release);
+
+    // take the lock so a worker checking mQueued cannot miss the wake up
+    {
+        std::lock_guard<std::mutex> lock(mSleepMutex);
+    }
+    mWake.notify_one();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+JobSystem::Job *
+JobSystem::pop(std::size_t queue)
+{
+    if (mQueued.load(std::memory_order_acquire) == 0) {
+        return 0;
+    }
+
+    // our queue first, newest job (the hottest in cache)
+    Queue &own = *mQueues[queue];
+    {
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.jobs.empty()) {
+            Job *job = own.jobs.back();
+            own.jobs.pop_back();
+            mQueued.fetch_sub(1, std::memory_order_relaxed);
+            return job;
+        }
+    }
+
+    // steal the oldest job of the others
+    const std::size_t numQueues = mQueues.size();
+    for (std::size_t i = 1; i < numQueues; ++i) {
+        Queue &victim = *mQueues[(queue + i) % numQueues];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.jobs.empty()) {
+            Job *job = victim.jobs.front();
+            victim.jobs.pop_front();
+            mQueued.fetch_sub(1, std::memory_order_relaxed);
+            ++own.stolen;
+            return job;
+        }
+    }
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+JobSystem::execute(Job *job)
+{
+    if (job->task) {
+        job->task();
+    }
+    if (job->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        finish(job);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+JobSystem::finish(Job *job)
+{
+    std::vector<Job *> dependents;
+    {
+        std::lock_guard<std::mutex> lock(mDepsMutex);
+        job->done = true;
+        dependents.swap(job->dependents);
+    }
+    for (std::size_t i = 0; i < dependents.size(); ++i) {
+        Job *dependent = dependents[i];
+        if (dependent->waiting.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            enqueue(dependent, i % mQueues.size());
+        }
+    }
+
+    Job *parent = job->parent;
+    if (parent != 0 &&
+        parent->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        finish(parent);
+    }
+    mUnfinished.fetch_sub(1, std::memory_order_release);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+JobSystem::runOne(std::size_t queue)
+{
+    Job *job = pop(queue);
+    if (job == 0) {
+        return false;
+    }
+    // counted before executing it, once the last job finished the main thread
+    // can read the stats
+    ++mQueues[queue]->executed;
+    execute(job);
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+JobSystem::workerLoop(std::size_t queue)
+{
+    PROFILE_THREAD("JobSystem worker");
+    while (!mExit.load(std::memory_order_acquire)) {
+        if (runOne(queue)) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(mSleepMutex);
+        while (!mExit.load(std::memory_order_acquire) &&
+               mQueued.load(std::memory_order_acquire) == 0) {
+            mWake.wait(lock);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+JobSystem::JobSystem(std::size_t numThreads) :
+    mQueued(0)
+,   mExit(false)
+,   mUnfinished(0)
+,   mNextQueue(0)
+{
+    if (numThreads == 0) {
+        numThreads = std::thread::hardware_concurrency();
+        if (numThreads == 0) {
+            numThreads = 1;
+        }
+    }
+    mQueues.reserve(numThreads);
+    for (std::size_t i = 0; i < numThreads; ++i) {
+        Queue *queue = new Queue;
+        queue->executed = 0;
+        queue->stolen = 0;
+        mQueues.push_back(queue);
+    }
+    resetStats();
+
+    // the queue 0 is the main thread one
+    mWorkers.reserve(numThreads - 1);
+    for (std::size_t i = 1; i < numThreads; ++i) {
+        mWorkers.push_back(std::thread(&JobSystem::workerLoop, this, i));
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+JobSystem::~JobSystem()
+{
+    sync();
+    {
+        std::lock_guard<std::mutex> lock(mSleepMutex);
+        mExit.store(true, std::memory_order_release);
+    }
+    mWake.notify_all();
+    for (std::size_t i = 0; i < mWorkers.size(); ++i) {
+        mWorkers[i].join();
+    }
+    for (std::size_t i = 0; i < mQueues.size(); ++i) {
+        delete mQueues[i];
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+JobSystem::Job *
+JobSystem::submit(const Task &task, Job *const *deps, std::size_t numDeps)
+{
+    Job *job = create(task, 0);
+    schedule(job, deps, numDeps);
+    return job;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+JobSystem::Job *
+JobSystem::parallelFor(std::size_t begin,
+                       std::size_t end,
+                       std::size_t grainSize,
+                       const RangeTask &task,
+                       Job *const *deps,
+                       std::size_t numDeps)
+{
+    ASSERT(grainSize > 0);
+
+    // the root job is never executed, it only waits for the chunks. All the
+    // chunks share the same copy of the task (alive until sync())
+    Job *root = create(Task(), 0);
+    mRangeTasks.push_back(task);
+    const RangeTask *rangeTask = &mRangeTasks.back();
+
+    for (std::size_t chunk = begin; chunk < end; chunk += grainSize) {
+        const std::size_t chunkEnd = (end - chunk > grainSize) ?
+                                      chunk + grainSize : end;
+        Job *job = create([rangeTask, chunk, chunkEnd]() {
+                              (*rangeTask)(chunk, chunkEnd);
+                          },
+                          root);
+        schedule(job, deps, numDeps);
+    }
+
+    // remove the root own part
+    if (root->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        finish(root);
+    }
+    return root;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+JobSystem::wait(Job *job)
+{
+    ASSERT(job != 0);
+    while (!job->finished()) {
+        if (!runOne(0)) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+JobSystem::sync(void)
+{
+    while (mUnfinished.load(std::memory_order_acquire) > 0) {
+        if (!runOne(0)) {
+            std::this_thread::yield();
+        }
+    }
+
+    for (std::size_t i = 0; i < mQueues.size(); ++i) {
+        mStats.jobsExecuted += mQueues[i]->executed;
+        mStats.jobsStolen += mQueues[i]->stolen;
+        mQueues[i]->executed = 0;
+        mQueues[i]->stolen = 0;
+    }
+    mJobs.clear();
+    mRangeTasks.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+JobSystem::resetStats(void)
+{
+    mStats.jobsExecuted = 0;
+    mStats.jobsStolen = 0;
+}
+
+} /* namespace jobs */
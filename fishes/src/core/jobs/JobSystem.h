@@ -0,0 +1,201 @@
+/*
+ * JobSystem.h
+ *
+ *  Created on: Apr 6, 2013
+ *      Author: agustin
+ */
+
+#ifndef JOBSYSTEM_H_
+#define JOBSYSTEM_H_
+
+#include <deque>
+#include <vector>
+#include <cstddef>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <boost/function.hpp>
+
+
+namespace jobs {
+
+// @brief Small work-stealing thread pool used to split the per frame work
+// (i.e. the animation update) between all the cores.
+// Each thread has its own queue, it runs the jobs of its queue (newest first)
+// and when it is empty it steals the oldest jobs of the other queues. The
+// thread that creates the JobSystem (the main thread) is one of the threads:
+// it executes jobs while it waits, so JobSystem(1) runs everything inline.
+//
+// The jobs are created from the main thread only (submit / parallelFor), a
+// job can depend on other jobs (it is not started until all of them
+// finished). The jobs of a frame live until sync() is called (the frame
+// barrier), so the Job pointers are valid until then.
+//
+class JobSystem
+{
+public:
+    typedef boost::function<void (void)> Task;
+    // The task of a parallelFor, called with a sub range [begin, end)
+    typedef boost::function<void (std::size_t, std::size_t)> RangeTask;
+
+    class Job;
+
+    struct Stats {
+        std::size_t jobsExecuted;
+        std::size_t jobsStolen;
+    };
+
+public:
+    // @param   numThreads  The number of threads (including the main one),
+    //                      0 = the number of cores
+    JobSystem(std::size_t numThreads = 0);
+    ~JobSystem();
+
+    // @brief Returns the number of threads (including the main one)
+    inline std::size_t numThreads(void) const;
+
+    // @brief Create a new job.
+    // @param   task        The function to execute
+    // @param   deps        The jobs that must finish before this one starts
+    // @param   numDeps     The number of dependencies
+    // @returns the job (valid until sync())
+    Job *submit(const Task &task, Job *const *deps = 0, std::size_t numDeps = 0);
+
+    // @brief Split the range [begin, end) in chunks of grainSize elements (the
+    // last one could be smaller) and call task for each of them in parallel.
+    // The chunks begin at begin + k * grainSize, so if begin and grainSize
+    // are multiples of N every chunk is aligned to N.
+    // @param   begin       The first element
+    // @param   end         One past the last element
+    // @param   grainSize   The size of each chunk (> 0)
+    // @param   task        The function called for each chunk
+    // @param   deps        The jobs that must finish before the chunks start
+    // @param   numDeps     The number of dependencies
+    // @returns a job that finishes when all the chunks finished
+    Job *parallelFor(std::size_t begin,
+                     std::size_t end,
+                     std::size_t grainSize,
+                     const RangeTask &task,
+                     Job *const *deps = 0,
+                     std::size_t numDeps = 0);
+
+    // @brief Wait (executing jobs) until a job finishes
+    void wait(Job *job);
+
+    // @brief The frame barrier: wait until all the jobs finished and release
+    // them. Must be called from the main thread.
+    void sync(void);
+
+    // @brief Stats functions (updated in sync())
+    inline const Stats &stats(void) const;
+    void resetStats(void);
+
+private:
+    // avoid copying
+    JobSystem(const JobSystem &);
+    JobSystem &operator=(const JobSystem &);
+
+    // The queue of each thread
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Job *> jobs;
+        std::size_t executed;
+        std::size_t stolen;
+    };
+
+    // @brief Create a job (without enqueue it)
+    Job *create(const Task &task, Job *parent);
+
+    // @brief Register the dependencies of a job and enqueue it if it has none
+    void schedule(Job *job, Job *const *deps, std::size_t numDeps);
+
+    // @brief Put a job in the queue of a thread
+    void enqueue(Job *job, std::size_t queue);
+
+    // @brief Get a job from our queue or steal one of the others
+    Job *pop(std::size_t queue);
+
+    // @brief Execute a job and finish it
+    void execute(Job *job);
+
+    // @brief Called when a job (and all its children) finished
+    void finish(Job *job);
+
+    // @brief Execute one job if there is any
+    // @returns true if a job was executed
+    bool runOne(std::size_t queue);
+
+    // @brief The worker threads function
+    void workerLoop(std::size_t queue);
+
+private:
+    std::vector<std::thread> mWorkers;
+    std::vector<Queue *> mQueues;
+
+    // to sleep the workers when there is no work
+    std::mutex mSleepMutex;
+    std::condition_variable mWake;
+    std::atomic<std::size_t> mQueued;
+    std::atomic<bool> mExit;
+
+    // the jobs of the current frame (stable addresses, main thread only)
+    std::deque<Job> mJobs;
+    std::deque<RangeTask> mRangeTasks;
+    std::atomic<std::size_t> mUnfinished;
+    std::size_t mNextQueue;
+
+    // protect the dependencies of the jobs
+    std::mutex mDepsMutex;
+
+    Stats mStats;
+};
+
+
+// @brief A unit of work, it finishes when its task and all its children (the
+// chunks of a parallelFor) finished.
+//
+class JobSystem::Job
+{
+public:
+    // @brief Check if the job finished
+    inline bool finished(void) const;
+
+private:
+    friend class JobSystem;
+
+    Task task;
+    Job *parent;
+    // the task itself + the children not finished yet
+    std::atomic<int> pending;
+    // the dependencies not finished yet (+1 while being scheduled)
+    std::atomic<int> waiting;
+    // the jobs waiting for this one (protected by mDepsMutex)
+    std::vector<Job *> dependents;
+    bool done;
+};
+
+
+// Inline implementations
+//
+
+inline std::size_t
+JobSystem::numThreads(void) const
+{
+    return mQueues.size();
+}
+
+inline const JobSystem::Stats &
+JobSystem::stats(void) const
+{
+    return mStats;
+}
+
+inline bool
+JobSystem::Job::finished(void) const
+{
+    return pending.load(std::memory_order_acquire) == 0;
+}
+
+} /* namespace jobs */
+#endif /* JOBSYSTEM_H_ */
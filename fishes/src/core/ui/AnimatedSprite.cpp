@@ -6,10 +6,16 @@
  */
 
 #include "AnimatedSprite.h"
+#include "AsyncTextureLoader.h"
+#include "AnimationClock.h"
+
+#include <cmath>
+#include <algorithm>
 
 #include <SFML/System/Vector2.hpp>
 
 #include <debug/DebugUtil.h>
+#include <debug/Profiler.h>
 
 
 // auxiliar functions
@@ -23,55 +29,142 @@ getIndexFromTime(const float currTime, const float factor,
     return begIndx +
             static_cast<std::size_t>((currTime * factor) * (endIdnx - begIndx + 1));
 }
+
+// The current time of the clock used by the lazy sprites
+inline double
+clockNow(void)
+{
+    return ui::AnimationClock::getInstance()->now();
+}
 }
 
 namespace ui {
 
 ////////////////////////////////////////////////////////////////////////////////
-bool
-AnimatedSprite::checkAnimTable(const std::vector<AnimIndices> &animation) const
-{
-    // this function is ultra verbose just to print almost all the possible
-    // errors at once
-    bool valid = true;
-    const std::size_t numSprites = mNumColumns * mNumRows;
-    for(std::size_t i = 0, size = animation.size(); i < size; ++i){
-        const AnimIndices &animI = animation[i];
-        if (animI.animTime < 0.f) {
-            valid = false;
-            debugERROR("Animation %zu has invalid time\n", i);
-        }
-        if (animI.begin > numSprites) {
-            valid = false;
-            debugERROR("Animation %zu has invalid begin: %zu\n", i, animI.begin);
-        }
-        if (animI.end > numSprites) {
-            valid = false;
-            debugERROR("Animation %zu has invalid end: %zu\n", i, animI.end);
-        }
-        if (animI.begin > animI.end) {
-            valid = false;
-            debugERROR("Animation %zu has invalid begin[%zu] or end[%zu]\n",
-                i, animI.begin, animI.end);
+void
+AnimatedSprite::setAnimationSet(const AnimationSet::Ptr &set)
+{
+    ASSERT(set.get() != 0);
+
+    mSet = set;
+    mRevision = AnimationSet::revision();
+    setTexture(*mSet->texture().get());
+    setTextureRect(mSet->frame(0));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+AnimatedSprite::retarget(void)
+{
+    mRevision = AnimationSet::revision();
+    if (mSet.get() == 0 || mSet->numFrames() == 0) {
+        return;
+    }
+
+    // keep the current frame inside the (maybe new) animation
+    unsigned int frame = (mSystem != 0) ? mSystem->mFrameIndex[mSystemID] :
+        mFrameIndex;
+    if (mAnimIndex < mSet->numAnims()) {
+        const AnimationSet::Anim &anim = mSet->anim(mAnimIndex);
+        frame = std::min<unsigned int>(std::max<unsigned int>(frame, anim.begin),
+                                       anim.end);
+        if (mSystem != 0) {
+            mSystem->mBegin[mSystemID] = anim.begin;
+            mSystem->mEnd[mSystemID] = anim.end;
         }
     }
-    return valid;
+    frame = std::min<unsigned int>(frame, mSet->numFrames() - 1);
+    if (mSystem != 0) {
+        mSystem->mFrameIndex[mSystemID] = frame;
+    } else {
+        mFrameIndex = frame;
+    }
+
+    // the texture of a library sheet could change
+    setTexture(*mSet->texture().get());
+    configureRect(frame);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void
-AnimatedSprite::configureRect(const std::size_t index)
+AnimatedSprite::copyFrom(const AnimatedSprite &other)
 {
-    const std::size_t row = index / mNumColumns;
-    const std::size_t col = index - (mNumColumns * row);
-    ASSERT(row < mNumRows);
-    ASSERT(col < mNumColumns);
+    sf::Sprite::operator=(other);
+    mSet = other.mSet;
+    mFlags = other.mFlags;
+    mAccumTime = other.mAccumTime;
+    mAnimTime = other.mAnimTime;
+    mTimeFactor = other.mTimeFactor;
+    mFrameIndex = other.mFrameIndex;
+    mAnimIndex = other.mAnimIndex;
+    mStartTime = other.mStartTime;
+    mRevision = other.mRevision;
+
+    // the playback state lives in the system, get it from there
+    if (other.mSystem != 0) {
+        other.mSystem->loadState(other.mSystemID, *this);
+    }
+}
 
-    // put the rectangle over there
-    mRect.top = row * mRect.height;
-    mRect.left = col * mRect.width;
+////////////////////////////////////////////////////////////////////////////////
+void
+AnimatedSprite::moveFrom(AnimatedSprite &other)
+{
+    ASSERT(mSystem == 0);
+
+    sf::Sprite::operator=(other);
+    mSet.swap(other.mSet);
+    other.mSet.reset();
+    mFlags = other.mFlags;
+    mAccumTime = other.mAccumTime;
+    mAnimTime = other.mAnimTime;
+    mTimeFactor = other.mTimeFactor;
+    mFrameIndex = other.mFrameIndex;
+    mAnimIndex = other.mAnimIndex;
+    mStartTime = other.mStartTime;
+    mRevision = other.mRevision;
+
+    // take its place in the system
+    if (other.mSystem != 0) {
+        mSystem = other.mSystem;
+        mSystemID = other.mSystemID;
+        mSystem->mSprites[mSystemID] = this;
+        other.mSystem = 0;
+        other.mSystemID = 0;
+    }
 
-    setTextureRect(mRect);
+    // and its pending build
+    if (other.mPendingBuild.get() != 0) {
+        mPendingBuild.swap(other.mPendingBuild);
+        other.mPendingBuild.reset();
+        *mPendingBuild = this;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+AnimatedSprite::cancelBuild(void)
+{
+    if (mPendingBuild.get() != 0) {
+        // the loader callback still holds the pointer
+        *mPendingBuild = 0;
+        mPendingBuild.reset();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+AnimatedSprite::pauseLazy(void)
+{
+    // keep the time already played
+    mAccumTime = static_cast<float>(clockNow() - mStartTime);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+AnimatedSprite::resumeLazy(void)
+{
+    mStartTime = clockNow() - mAccumTime;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -83,17 +176,69 @@ AnimatedSprite::AnimatedSprite() :
 ,   mAccumTime(0.f)
 ,   mAnimTime(0.f)
 ,   mTimeFactor(0.f)
-,   mNumRows(0u)
-,   mNumColumns(0u)
+,   mFrameIndex(0u)
 ,   mAnimIndex(0u)
+,   mSystem(0)
+,   mSystemID(0)
+,   mStartTime(0.)
+,   mRevision(0)
 {
 
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-AnimatedSprite::~AnimatedSprite()
+AnimatedSprite::AnimatedSprite(const AnimatedSprite &other) :
+    sf::Sprite()
+,   mSystem(0)
+,   mSystemID(0)
 {
+    copyFrom(other);
+}
 
+////////////////////////////////////////////////////////////////////////////////
+AnimatedSprite &
+AnimatedSprite::operator=(const AnimatedSprite &other)
+{
+    if (this != &other) {
+        if (mSystem != 0) {
+            mSystem->remove(*this);
+        }
+        cancelBuild();
+        copyFrom(other);
+    }
+    return *this;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+AnimatedSprite::AnimatedSprite(AnimatedSprite &&other) :
+    sf::Sprite()
+,   mSystem(0)
+,   mSystemID(0)
+{
+    moveFrom(other);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+AnimatedSprite &
+AnimatedSprite::operator=(AnimatedSprite &&other)
+{
+    if (this != &other) {
+        if (mSystem != 0) {
+            mSystem->remove(*this);
+        }
+        cancelBuild();
+        moveFrom(other);
+    }
+    return *this;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+AnimatedSprite::~AnimatedSprite()
+{
+    cancelBuild();
+    if (mSystem != 0) {
+        mSystem->remove(*this);
+    }
 }
 
 
@@ -103,30 +248,85 @@ AnimatedSprite::build(const std::string &textFName,
                       std::size_t numColumns,
                       std::size_t numRows)
 {
+    PROFILE_FUNCTION();
+
     if (textFName.empty()) {
         debugERROR("textFName is empty\n");
         return false;
     }
-    // check if we have to create a new texture
-    if (mTexture.get() == 0){
-        mTexture.reset(new sf::Texture());
-    }
-    if (!mTexture->loadFromFile(textFName)) {
+    TextureHandle texture = TextureCache::getInstance()->get(textFName);
+    if (texture.get() == 0) {
         debugERROR("Error loading texture: %s\n", textFName.c_str());
         return false;
     }
+    return build(texture, numColumns, numRows);
+}
 
-    // set the texture to the sprite
-    setTexture(*mTexture.get());
+////////////////////////////////////////////////////////////////////////////////
+void
+AnimatedSprite::buildAsync(AsyncTextureLoader &loader,
+                           const std::string &textFName,
+                           std::size_t numColumns,
+                           std::size_t numRows,
+                           const boost::function<void (bool)> &onBuilt)
+{
+    // the callback doesn't hold the sprite but the token, that the sprite
+    // updates when it is moved or destroyed
+    cancelBuild();
+    mPendingBuild.reset(new AnimatedSprite *(this));
+    const boost::shared_ptr<AnimatedSprite *> token = mPendingBuild;
+    loader.request(textFName,
+                   [token, numColumns, numRows, onBuilt]
+                   (const TextureHandle &texture)
+    {
+        AnimatedSprite *sprite = *token;
+        if (sprite == 0) {
+            return;
+        }
+        sprite->mPendingBuild.reset();
+        const bool built = sprite->build(texture, numColumns, numRows);
+        if (onBuilt) {
+            onBuilt(built);
+        }
+    });
+}
 
-    // texture loaded ok, configure the rectangle size now
-    sf::Vector2u textSize = mTexture->getSize();
-    mRect.width = textSize.x / numColumns;
-    mRect.height = textSize.y / numRows;
+////////////////////////////////////////////////////////////////////////////////
+bool
+AnimatedSprite::build(const TextureHandle &texture,
+                      std::size_t numColumns,
+                      std::size_t numRows)
+{
+    // all the sprites with the same texture and layout share the set
+    return build(AnimationSet::grid(texture, numColumns, numRows));
+}
 
-    mNumColumns = numColumns;
-    mNumRows = numRows;
+////////////////////////////////////////////////////////////////////////////////
+bool
+AnimatedSprite::build(const AtlasIndex &atlas, const std::string &sheetName)
+{
+    return build(AnimationSet::fromAtlas(atlas, sheetName));
+}
 
+////////////////////////////////////////////////////////////////////////////////
+bool
+AnimatedSprite::build(const AnimationLibrary::Ptr &library,
+                      const std::string &sheetName)
+{
+    return build(AnimationSet::fromLibrary(library, sheetName));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+AnimatedSprite::build(const AnimationSet::Ptr &set)
+{
+    PROFILE_FUNCTION();
+
+    if (set.get() == 0) {
+        debugERROR("Invalid animation set\n");
+        return false;
+    }
+    setAnimationSet(set);
     return true;
 }
 
@@ -134,11 +334,13 @@ AnimatedSprite::build(const std::string &textFName,
 bool
 AnimatedSprite::createAnimTable(const std::vector<AnimIndices> &animations)
 {
-    // only check this in debug
-    ASSERT(checkAnimTable(animations));
+    if (mSet.get() == 0) {
+        debugERROR("The sprite is not built\n");
+        return false;
+    }
 
-    // copy the table
-    mAnimations = animations;
+    // copy the table into a new set (same layout)
+    mSet = mSet->withAnims(animations);
     return true;
 }
 
@@ -146,17 +348,26 @@ AnimatedSprite::createAnimTable(const std::vector<AnimIndices> &animations)
 void
 AnimatedSprite::setAnim(const std::size_t animID, const float time)
 {
-    ASSERT(animID < mAnimations.size());
+    ASSERT(mSet.get() != 0 && animID < mSet->numAnims());
 
     // check which is the time that we should use
-    mAnimTime = (time < 0.f) ? mAnimations[animID].animTime : time;
-    mTimeFactor = 1.f / mAnimTime;
-    mAccumTime = 0.f;
+    const AnimationSet::Anim &anim = mSet->anim(animID);
+    mAnimIndex = animID;
+    if (mSystem != 0) {
+        mSystem->setAnim(mSystemID,
+                         anim.begin,
+                         anim.end,
+                         (time < 0.f) ? anim.animTime : time);
+    } else {
+        mAnimTime = (time < 0.f) ? anim.animTime : time;
+        mTimeFactor = 1.f / mAnimTime;
+        mAccumTime = 0.f;
+        mFrameIndex = anim.begin;
+        mStartTime = clockNow();
+    }
 
     // configure the rectangle
-    mAnimIndex = animID;
-    mFrameIndex = mAnimations[mAnimIndex].begin;
-    configureRect(mFrameIndex);
+    configureRect(anim.begin);
     setFlag(Flag::PLAYING);
 }
 
@@ -164,6 +375,20 @@ AnimatedSprite::setAnim(const std::size_t animID, const float time)
 void
 AnimatedSprite::update(float timeFrame)
 {
+    PROFILE_FUNCTION();
+
+    // the system is the one who updates the sprite, the lazy ones are
+    // evaluated when needed
+    if (mSystem != 0) {
+        return;
+    }
+    if (mRevision != AnimationSet::revision()) {
+        retarget();
+    }
+    if (checkFlag(Flag::LAZY)) {
+        return;
+    }
+
     if (checkFlag(Flag::STOPPED) || !checkFlag(Flag::PLAYING)) {
         return;
     }
@@ -182,10 +407,11 @@ AnimatedSprite::update(float timeFrame)
     }
 
     // check which is the frame we have to show
+    const AnimationSet::Anim &anim = mSet->anim(mAnimIndex);
     const std::size_t frameIndex = getIndexFromTime(mAccumTime,
                                                     mTimeFactor,
-                                                    mAnimations[mAnimIndex].begin,
-                                                    mAnimations[mAnimIndex].end);
+                                                    anim.begin,
+                                                    anim.end);
     if (frameIndex != mFrameIndex){
         // configure the new frame
         mFrameIndex = frameIndex;
@@ -194,5 +420,85 @@ AnimatedSprite::update(float timeFrame)
 
 }
 
+////////////////////////////////////////////////////////////////////////////////
+bool
+AnimatedSprite::setLazy(bool lazy)
+{
+    if (mSystem != 0) {
+        debugWARNING("A sprite in an AnimationSystem can't be lazy\n");
+        return false;
+    }
+    if (lazy == checkFlag(Flag::LAZY)) {
+        return true;
+    }
+
+    // translate the accumulated time into the start time and back
+    if (lazy) {
+        mStartTime = clockNow() - mAccumTime;
+        setFlag(Flag::LAZY);
+    } else {
+        if (!checkFlag(Flag::STOPPED)) {
+            pauseLazy();
+        }
+        unsetFlag(Flag::LAZY);
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+AnimatedSprite::evaluate(void)
+{
+    if (mRevision != AnimationSet::revision()) {
+        retarget();
+    }
+
+    // a lazy sprite is never in a system, mFlags is the real state
+    if ((mFlags & (Flag::LAZY | Flag::STOPPED | Flag::PLAYING)) !=
+        (Flag::LAZY | Flag::PLAYING)) {
+        return;
+    }
+
+    const AnimationSet::Anim &anim = mSet->anim(mAnimIndex);
+    double elapsed = clockNow() - mStartTime;
+    if (elapsed < 0.) {
+        elapsed = 0.;
+    }
+    if (elapsed >= mAnimTime) {
+        if (mFlags & Flag::LOOP) {
+            // move the start time to the beginning of the current loop
+            const double loops = std::floor(elapsed * mTimeFactor);
+            mStartTime += loops * mAnimTime;
+            elapsed -= loops * mAnimTime;
+            if (elapsed >= mAnimTime) {
+                elapsed = 0.;
+            }
+        } else {
+            // finished, stay in the last frame
+            unsetFlag(Flag::PLAYING);
+            mAccumTime = mAnimTime;
+            if (mFrameIndex != anim.end) {
+                mFrameIndex = anim.end;
+                configureRect(anim.end);
+            }
+            return;
+        }
+    }
+
+    // same mapping than update()
+    mAccumTime = static_cast<float>(elapsed);
+    std::size_t frameIndex = getIndexFromTime(mAccumTime,
+                                              mTimeFactor,
+                                              anim.begin,
+                                              anim.end);
+    if (frameIndex > anim.end) {
+        frameIndex = anim.end;
+    }
+    if (frameIndex != mFrameIndex){
+        mFrameIndex = frameIndex;
+        configureRect(frameIndex);
+    }
+}
+
 
 } /* namespace ui */
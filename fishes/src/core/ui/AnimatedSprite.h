@@ -9,16 +9,23 @@
 #define ANIMATEDSPRITE_H_
 
 #include <string>
+#include <vector>
 #include <cstddef>
+#include <boost/function.hpp>
 #include <boost/shared_ptr.hpp>
 
 #include <SFML/Graphics/Sprite.hpp>
 #include <SFML/Graphics/Texture.hpp>
 #include <SFML/Graphics/Rect.hpp>
 
+#include "AnimationSystem.h"
+#include "TextureCache.h"
+#include "AnimationSet.h"
 
 namespace ui {
 
+class AsyncTextureLoader;
+
 class AnimatedSprite : public sf::Sprite
 {
     // internal flags
@@ -27,17 +34,25 @@ class AnimatedSprite : public sf::Sprite
         STOPPED =       (1 << 0),
         LOOP =          (1 << 1),
         PLAYING =       (1 << 2),
+        LAZY =          (1 << 3),
     };
 public:
-    struct AnimIndices {
-        std::size_t begin;
-        std::size_t end;
-        float animTime;
-    };
+    typedef AnimationSet::AnimIndices AnimIndices;
 public:
     AnimatedSprite();
     ~AnimatedSprite();
 
+    // @brief The copy of a sprite is never attached to an AnimationSystem,
+    // it will have the same playback state than the original one.
+    AnimatedSprite(const AnimatedSprite &other);
+    AnimatedSprite &operator=(const AnimatedSprite &other);
+
+    // @brief Moving a sprite keeps it in its AnimationSystem (the new sprite
+    // takes the place of the old one) and its pending buildAsync() (the new
+    // sprite will be built). The moved sprite is left empty.
+    AnimatedSprite(AnimatedSprite &&other);
+    AnimatedSprite &operator=(AnimatedSprite &&other);
+
     // @brief Construct the animated sprite from file (texture) and set the size
     // of the animation (in width and height). The sprite number will be ordered
     // like this:
@@ -45,15 +60,81 @@ public:
     // 4    5   6   7
     // 8    9   10  11...
     // Where each number represent the rectangle.
-    // @param   textFName   Texture file name.
+    // The texture is taken from the TextureCache (loaded only once for all
+    // the sprites using the same file).
+    // @param   textFName   Texture file name (loose or pack://name).
     // @param   numColumns  The number of columns
     // @param   numRows     The number of rows
     bool build(const std::string &textFName,
                std::size_t numColumns = 1,
                std::size_t numRows = 1);
 
+    // @brief Asynchronous version of the build above. The texture is requested
+    // to the loader and the sprite is built when it is ready (from
+    // loader.update()). If the sprite is destroyed before that the build (and
+    // onBuilt) is cancelled, if it is moved the new sprite is built instead.
+    // Calling it again cancels the previous one.
+    // The animation table / setAnim should be configured after that (i.e.
+    // in the onBuilt callback).
+    // @param   loader      The loader used to load the texture
+    // @param   textFName   Texture file name.
+    // @param   numColumns  The number of columns
+    // @param   numRows     The number of rows
+    // @param   onBuilt     Optional callback called with the result of the
+    //                      build
+    void buildAsync(AsyncTextureLoader &loader,
+                    const std::string &textFName,
+                    std::size_t numColumns = 1,
+                    std::size_t numRows = 1,
+                    const boost::function<void (bool)> &onBuilt =
+                        boost::function<void (bool)>());
+
+    // @brief Same as above but using an already loaded texture
+    // @param   texture     The texture handle (from the TextureCache)
+    // @param   numColumns  The number of columns
+    // @param   numRows     The number of rows
+    bool build(const TextureHandle &texture,
+               std::size_t numColumns = 1,
+               std::size_t numRows = 1);
+
+    // @brief Same as above for sheets with a number of columns and rows fixed
+    // at compile time, i.e. sprite.build<6, 3>(texture).
+    // @param   texture     The texture handle (from the TextureCache)
+    template<std::size_t COLUMNS, std::size_t ROWS>
+    inline bool build(const TextureHandle &texture);
+
+    // @brief Construct the animated sprite from a sheet of a texture atlas.
+    // The frames are taken from the atlas index instead of being computed
+    // from a uniform grid, the frame numbers are the same than the original
+    // sheet ones.
+    // The atlas should live while the sprite use it.
+    // @param   atlas       The atlas index (already loaded)
+    // @param   sheetName   The name of the sheet in the atlas
+    bool build(const AtlasIndex &atlas, const std::string &sheetName);
+
+    // @brief Construct the animated sprite from a sheet of a compiled
+    // animation library. The texture and the layout are taken from the sheet,
+    // and the animation table of the sheet is used directly (no need to call
+    // createAnimTable()), the animation IDs are the indices of the sheet
+    // animations (see AnimationLibrary::findAnim()).
+    // @param   library     The animation library
+    // @param   sheetName   The name of the sheet in the library
+    bool build(const AnimationLibrary::Ptr &library,
+               const std::string &sheetName);
+
+    // @brief Construct the animated sprite from an AnimationSet (texture,
+    // layout and animations shared with other sprites). This is the cheapest
+    // way to build a lot of sprites of the same kind.
+    // @param   set         The animation set
+    bool build(const AnimationSet::Ptr &set);
+
+    // @brief Returns the AnimationSet used by the sprite (to build other ones)
+    inline const AnimationSet::Ptr &animationSet(void) const;
+
     // @brief Create animation table. This animation table is used associate
     // sprite ranges to a given animation name (ID = size_t).
+    // Note that this creates a new AnimationSet only for this sprite, to
+    // share the table build the other sprites with animationSet().
     // The frames will be:
     // 0    1   2   3
     // 4    5   6   7
@@ -83,76 +164,150 @@ public:
     inline void setLoop(bool loop);
 
     // @brief This function must be called every frame to update the animation logic
-    // It will also draw the sprite into the associated window
+    // It will also draw the sprite into the associated window.
+    // If the sprite belongs to an AnimationSystem this function does nothing,
+    // the system will update it.
     // @param timeFrame     The last time frame.
     void update(float timeFrame);
 
+    // @brief Set / unset the lazy playback mode. A lazy sprite doesn't
+    // accumulate the time each frame (update() does nothing), it keeps the
+    // time its animation started and the frame is computed from the
+    // AnimationClock only when evaluate() is called. This way the sprites that
+    // are hidden or culled cost nothing per frame.
+    // The frame is computed with the same time to frame mapping than
+    // update(), but from the exact elapsed time, so it doesn't match update()
+    // step by step at the ends of the animation: update() drops the time
+    // exceeding the animation on each loop (and keeps the old frame on that
+    // step) while a lazy loop keeps its phase, and a finished animation is
+    // left in its last frame instead of the last one update() showed.
+    // A sprite in an AnimationSystem can't be lazy (the system already
+    // updates it).
+    // @param   lazy    Enable or disable the lazy mode
+    // @returns false if the sprite is in an AnimationSystem
+    bool setLazy(bool lazy);
+    inline bool isLazy(void) const;
+
+    // @brief Set the frame of a lazy sprite from the AnimationClock (see
+    // setLazy() for the differences with update()). Must be called before
+    // drawing it (only for the visible ones) or querying its frame. Does
+    // nothing if the sprite is not lazy.
+    void evaluate(void);
+
+    // @brief Returns the AnimationSystem that handles this sprite (if any)
+    inline AnimationSystem *animationSystem(void) const;
+
 
 private:
+    friend class AnimationSystem;
+
+    // @brief Returns the flags of the sprite (ours or the ones in the system)
+    inline int &flags(void);
+    inline int flags(void) const;
+
     // @brief Flags manipulation functions
     inline void setFlag(Flag f);
     inline void unsetFlag(Flag f);
     inline bool checkFlag(Flag f) const;
     inline void clearFlags(void);
 
-    // @brief Check if the animation table is valid
-    bool checkAnimTable(const std::vector<AnimIndices> &animation) const;
-
     // @brief Configure the rectangle for a given sprite index
-    void configureRect(const std::size_t index);
+    inline void configureRect(const std::size_t index);
 
-private:
-    typedef std::vector<AnimIndices> AnimationVec;
+    // @brief Set the AnimationSet of the sprite (keeping the playback state)
+    void setAnimationSet(const AnimationSet::Ptr &set);
+
+    // @brief Take the frames / animations of the set after a reload (see
+    // AnimationSet::revision()), keeping the playback state
+    void retarget(void);
+
+    // @brief Copy all the data (but the AnimationSystem) from other sprite
+    void copyFrom(const AnimatedSprite &other);
+
+    // @brief Take all the data (and the AnimationSystem slot) of other sprite
+    void moveFrom(AnimatedSprite &other);
 
+    // @brief Cancel the pending buildAsync() (if any)
+    void cancelBuild(void);
 
-    boost::shared_ptr<sf::Texture> mTexture;
+    // @brief Freeze / resume the time of a lazy sprite (stop / play)
+    void pauseLazy(void);
+    void resumeLazy(void);
+
+private:
+    // shared
+    AnimationSet::Ptr mSet;
+
+    // playback state
     int mFlags;
     float mAccumTime;
     float mAnimTime;
     float mTimeFactor;
-    std::size_t mFrameIndex;
-    sf::IntRect mRect;
-    std::size_t mNumRows;
-    std::size_t mNumColumns;
-    AnimationVec mAnimations;
-    std::size_t mAnimIndex;
+    unsigned int mFrameIndex;
+    unsigned int mAnimIndex;
+    AnimationSystem *mSystem;
+    unsigned int mSystemID;
+    // the AnimationClock time when the animation started (lazy mode)
+    double mStartTime;
+    // the AnimationSet::revision() of the current frame
+    std::size_t mRevision;
+    // the sprite to build when the pending buildAsync() finishes (shared
+    // with the loader callback, 0 if it was cancelled)
+    boost::shared_ptr<AnimatedSprite *> mPendingBuild;
 };
 
 
 // Inline implementations
 //
 
+inline int &
+AnimatedSprite::flags(void)
+{
+    return (mSystem == 0) ? mFlags : mSystem->mFlags[mSystemID];
+}
+inline int
+AnimatedSprite::flags(void) const
+{
+    return (mSystem == 0) ? mFlags : mSystem->mFlags[mSystemID];
+}
+
 inline void
 AnimatedSprite::setFlag(Flag f)
 {
-    mFlags |= f;
+    flags() |= f;
 }
 inline void
 AnimatedSprite::unsetFlag(Flag f)
 {
-    mFlags &= ~f;
+    flags() &= ~f;
 }
 inline bool
 AnimatedSprite::checkFlag(Flag f) const
 {
-    return mFlags & f;
+    return flags() & f;
 }
 inline void
 AnimatedSprite::clearFlags(void)
 {
-    mFlags = Flag::NONE;
+    flags() = Flag::NONE;
 }
 
 
 inline void
 AnimatedSprite::play(void)
 {
+    if (checkFlag(Flag::LAZY) && checkFlag(Flag::STOPPED)) {
+        resumeLazy();
+    }
     unsetFlag(Flag::STOPPED);
     setFlag(Flag::PLAYING);
 }
 inline void
 AnimatedSprite::stop(void)
 {
+    if (checkFlag(Flag::LAZY) && !checkFlag(Flag::STOPPED)) {
+        pauseLazy();
+    }
     setFlag(Flag::STOPPED);
 }
 inline bool
@@ -161,6 +316,12 @@ AnimatedSprite::isStopped(void) const
     return checkFlag(Flag::STOPPED);
 }
 
+inline bool
+AnimatedSprite::isLazy(void) const
+{
+    return checkFlag(Flag::LAZY);
+}
+
 inline void
 AnimatedSprite::setLoop(bool loop)
 {
@@ -171,5 +332,30 @@ AnimatedSprite::setLoop(bool loop)
     }
 }
 
+inline void
+AnimatedSprite::configureRect(const std::size_t index)
+{
+    setTextureRect(mSet->frame(index));
+}
+
+template<std::size_t COLUMNS, std::size_t ROWS>
+inline bool
+AnimatedSprite::build(const TextureHandle &texture)
+{
+    return build(AnimationSet::grid<COLUMNS, ROWS>(texture));
+}
+
+inline const AnimationSet::Ptr &
+AnimatedSprite::animationSet(void) const
+{
+    return mSet;
+}
+
+inline AnimationSystem *
+AnimatedSprite::animationSystem(void) const
+{
+    return mSystem;
+}
+
 } /* namespace ui */
 #endif /* ANIMATEDSPRITE_H_ */
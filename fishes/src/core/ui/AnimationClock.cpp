@@ -0,0 +1,25 @@
+/*
+ * AnimationClock.cpp
+ *
+ *  Created on: Apr 10, 2013
+ *      Author: agustin
+ */
+
+#include "AnimationClock.h"
+
+
+namespace ui {
+
+AnimationClock *AnimationClock::mInstance = 0;
+
+////////////////////////////////////////////////////////////////////////////////
+AnimationClock *
+AnimationClock::getInstance(void)
+{
+    if (!mInstance) {
+        mInstance = new AnimationClock;
+    }
+    return mInstance;
+}
+
+} /* namespace ui */
@@ -0,0 +1,76 @@
+/*
+ * AnimationClock.h
+ *
+ *  Created on: Apr 10, 2013
+ *      Author: agustin
+ */
+
+#ifndef ANIMATIONCLOCK_H_
+#define ANIMATIONCLOCK_H_
+
+
+namespace ui {
+
+// @brief The global game clock used by the lazy AnimatedSprites: instead of
+// accumulating the time of each sprite every frame they keep the time their
+// animation started and compute the frame from now() only when needed.
+// The game loop should call advance() once per frame (so the animations are
+// paused when the game is paused).
+// This class is not thread safe, it should be used from the main thread.
+//
+class AnimationClock
+{
+public:
+    // @brief Returns the instance
+    static AnimationClock *getInstance(void);
+
+    // @brief Advance the clock
+    // @param   timeFrame   The last time frame.
+    inline void advance(float timeFrame);
+
+    // @brief Returns the time elapsed since the clock was created / reset (in
+    // seconds, double to keep the precision after hours of game)
+    inline double now(void) const;
+
+    // @brief Set the clock to 0. The lazy sprites playing will jump to the
+    // first frame (their start time is in the future), set their animation
+    // again after calling this.
+    inline void reset(void);
+
+private:
+    AnimationClock() : mNow(0.) {}
+    ~AnimationClock() {}
+
+    // avoid copying
+    AnimationClock(const AnimationClock &);
+    AnimationClock &operator=(const AnimationClock &);
+
+private:
+    static AnimationClock *mInstance;
+    double mNow;
+};
+
+
+// Inline implementations
+//
+
+inline void
+AnimationClock::advance(float timeFrame)
+{
+    mNow += timeFrame;
+}
+
+inline double
+AnimationClock::now(void) const
+{
+    return mNow;
+}
+
+inline void
+AnimationClock::reset(void)
+{
+    mNow = 0.;
+}
+
+} /* namespace ui */
+#endif /* ANIMATIONCLOCK_H_ */
@@ -0,0 +1,303 @@
+/*
+ * AnimationKernel.cpp
+ *
+ *  Created on: Mar 5, 2013
+ *      Author: agustin
+ */
+
+#include "AnimationKernel.h"
+
+#include <cstring>
+
+#include <debug/DebugUtil.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  define ANIMATION_KERNEL_X86
+#  include <immintrin.h>
+#endif
+
+
+// auxiliar functions
+namespace {
+
+using namespace ui::AnimationKernel;
+
+typedef void (*KernelFun)(const Arrays &, std::size_t, std::size_t, float,
+                          std::uint64_t *);
+
+// Mark the element i as changed
+inline void
+setChanged(std::uint64_t *changedMask, std::size_t i, std::uint64_t bits = 1)
+{
+    changedMask[i >> 6] |= bits << (i & 63);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+updateScalar(const Arrays &a,
+             std::size_t begin,
+             std::size_t end,
+             float timeFrame,
+             std::uint64_t *changedMask)
+{
+    for (std::size_t i = begin; i < end; ++i) {
+        if ((a.flags[i] & (STOPPED | PLAYING)) != PLAYING) {
+            continue;
+        }
+
+        const float accumTime = a.accumTime[i] + timeFrame;
+        if (accumTime >= a.animTime[i]) {
+            if (a.flags[i] & LOOP) {
+                a.accumTime[i] = 0.f;
+            } else {
+                a.accumTime[i] = accumTime;
+                a.flags[i] &= ~PLAYING;
+            }
+            continue;
+        }
+        a.accumTime[i] = accumTime;
+
+        const unsigned int frame = a.begin[i] +
+            static_cast<unsigned int>((accumTime * a.timeFactor[i]) *
+                                      (a.end[i] - a.begin[i] + 1));
+        if (frame != a.frameIndex[i]) {
+            a.frameIndex[i] = frame;
+            setChanged(changedMask, i);
+        }
+    }
+}
+
+#ifdef ANIMATION_KERNEL_X86
+
+////////////////////////////////////////////////////////////////////////////////
+// SSE2 helpers (no blendv in SSE2)
+__attribute__((target("sse2")))
+inline __m128i
+select128(__m128i mask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+__attribute__((target("sse2")))
+inline __m128
+select128(__m128 mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+__attribute__((target("sse2")))
+void
+updateSSE2(const Arrays &a,
+           std::size_t begin,
+           std::size_t end,
+           float timeFrame,
+           std::uint64_t *changedMask)
+{
+    const __m128i stateMask = _mm_set1_epi32(STOPPED | PLAYING);
+    const __m128i playing = _mm_set1_epi32(PLAYING);
+    const __m128i loop = _mm_set1_epi32(LOOP);
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128 dt = _mm_set1_ps(timeFrame);
+
+    std::size_t i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m128i flags = _mm_loadu_si128((const __m128i *)(a.flags + i));
+        const __m128i active =
+            _mm_cmpeq_epi32(_mm_and_si128(flags, stateMask), playing);
+        const __m128i isLoop =
+            _mm_cmpeq_epi32(_mm_and_si128(flags, loop), loop);
+
+        // advance the time
+        const __m128 oldTime = _mm_loadu_ps(a.accumTime + i);
+        const __m128 time = _mm_add_ps(oldTime, dt);
+        const __m128i expired = _mm_castps_si128(
+            _mm_cmpge_ps(time, _mm_loadu_ps(a.animTime + i)));
+
+        // wrap the looping ones, keep the time of the inactive ones
+        const __m128 wrapped = _mm_castsi128_ps(_mm_and_si128(expired, isLoop));
+        _mm_storeu_ps(a.accumTime + i,
+                      select128(_mm_castsi128_ps(active),
+                                _mm_andnot_ps(wrapped, time),
+                                oldTime));
+
+        // stop the finished ones
+        const __m128i stop =
+            _mm_andnot_si128(isLoop, _mm_and_si128(active, expired));
+        flags = _mm_andnot_si128(_mm_and_si128(stop, playing), flags);
+        _mm_storeu_si128((__m128i *)(a.flags + i), flags);
+
+        // the frame index
+        const __m128i beg = _mm_loadu_si128((const __m128i *)(a.begin + i));
+        const __m128i en = _mm_loadu_si128((const __m128i *)(a.end + i));
+        const __m128 count =
+            _mm_cvtepi32_ps(_mm_add_epi32(_mm_sub_epi32(en, beg), one));
+        const __m128 factor =
+            _mm_mul_ps(_mm_mul_ps(time, _mm_loadu_ps(a.timeFactor + i)), count);
+        const __m128i frame = _mm_add_epi32(beg, _mm_cvttps_epi32(factor));
+        const __m128i oldFrame =
+            _mm_loadu_si128((const __m128i *)(a.frameIndex + i));
+        const __m128i changed =
+            _mm_andnot_si128(_mm_cmpeq_epi32(frame, oldFrame),
+                             _mm_andnot_si128(expired, active));
+        const int bits = _mm_movemask_ps(_mm_castsi128_ps(changed));
+        if (bits == 0) {
+            continue;
+        }
+        _mm_storeu_si128((__m128i *)(a.frameIndex + i),
+                         select128(changed, frame, oldFrame));
+
+        setChanged(changedMask, i, static_cast<std::uint64_t>(bits));
+    }
+
+    // the rest
+    updateScalar(a, i, end, timeFrame, changedMask);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+__attribute__((target("avx2")))
+void
+updateAVX2(const Arrays &a,
+           std::size_t begin,
+           std::size_t end,
+           float timeFrame,
+           std::uint64_t *changedMask)
+{
+    const __m256i stateMask = _mm256_set1_epi32(STOPPED | PLAYING);
+    const __m256i playing = _mm256_set1_epi32(PLAYING);
+    const __m256i loop = _mm256_set1_epi32(LOOP);
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256 dt = _mm256_set1_ps(timeFrame);
+
+    std::size_t i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256i flags = _mm256_loadu_si256((const __m256i *)(a.flags + i));
+        const __m256i active =
+            _mm256_cmpeq_epi32(_mm256_and_si256(flags, stateMask), playing);
+        const __m256i isLoop =
+            _mm256_cmpeq_epi32(_mm256_and_si256(flags, loop), loop);
+
+        // advance the time
+        const __m256 oldTime = _mm256_loadu_ps(a.accumTime + i);
+        const __m256 time = _mm256_add_ps(oldTime, dt);
+        const __m256i expired = _mm256_castps_si256(
+            _mm256_cmp_ps(time, _mm256_loadu_ps(a.animTime + i), _CMP_GE_OQ));
+
+        // wrap the looping ones, keep the time of the inactive ones
+        const __m256 wrapped =
+            _mm256_castsi256_ps(_mm256_and_si256(expired, isLoop));
+        _mm256_storeu_ps(a.accumTime + i,
+                         _mm256_blendv_ps(oldTime,
+                                          _mm256_andnot_ps(wrapped, time),
+                                          _mm256_castsi256_ps(active)));
+
+        // stop the finished ones
+        const __m256i stop =
+            _mm256_andnot_si256(isLoop, _mm256_and_si256(active, expired));
+        flags = _mm256_andnot_si256(_mm256_and_si256(stop, playing), flags);
+        _mm256_storeu_si256((__m256i *)(a.flags + i), flags);
+
+        // the frame index
+        const __m256i beg = _mm256_loadu_si256((const __m256i *)(a.begin + i));
+        const __m256i en = _mm256_loadu_si256((const __m256i *)(a.end + i));
+        const __m256 count =
+            _mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_sub_epi32(en, beg), one));
+        const __m256 factor = _mm256_mul_ps(
+            _mm256_mul_ps(time, _mm256_loadu_ps(a.timeFactor + i)), count);
+        const __m256i frame = _mm256_add_epi32(beg, _mm256_cvttps_epi32(factor));
+        const __m256i oldFrame =
+            _mm256_loadu_si256((const __m256i *)(a.frameIndex + i));
+        const __m256i changed =
+            _mm256_andnot_si256(_mm256_cmpeq_epi32(frame, oldFrame),
+                                _mm256_andnot_si256(expired, active));
+        const int bits = _mm256_movemask_ps(_mm256_castsi256_ps(changed));
+        if (bits == 0) {
+            continue;
+        }
+        _mm256_storeu_si256((__m256i *)(a.frameIndex + i),
+                            _mm256_blendv_epi8(oldFrame, frame, changed));
+
+        setChanged(changedMask, i, static_cast<std::uint64_t>(bits));
+    }
+
+    // the rest
+    updateScalar(a, i, end, timeFrame, changedMask);
+}
+
+#endif // ANIMATION_KERNEL_X86
+
+
+// the implementations table (indexed by Type)
+const KernelFun KERNELS[NUM_TYPES] = {
+    updateScalar,
+#ifdef ANIMATION_KERNEL_X86
+    updateSSE2,
+    updateAVX2,
+#else
+    0,
+    0,
+#endif
+};
+
+}
+
+namespace ui {
+namespace AnimationKernel {
+
+////////////////////////////////////////////////////////////////////////////////
+Type
+bestAvailable(void)
+{
+    static const Type best = isAvailable(AVX2) ? AVX2 :
+                             isAvailable(SSE2) ? SSE2 : SCALAR;
+    return best;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+isAvailable(Type type)
+{
+    switch (type) {
+    case SCALAR:
+        return true;
+#ifdef ANIMATION_KERNEL_X86
+    case SSE2:
+        return __builtin_cpu_supports("sse2");
+    case AVX2:
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return false;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const char *
+name(Type type)
+{
+    static const char *NAMES[NUM_TYPES] = {"scalar", "sse2", "avx2"};
+    ASSERT(type < NUM_TYPES);
+    return NAMES[type];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+update(Type type,
+       const Arrays &arrays,
+       std::size_t begin,
+       std::size_t end,
+       float timeFrame,
+       std::uint64_t *changedMask)
+{
+    ASSERT(isAvailable(type));
+    ASSERT((begin & 63) == 0);
+    ASSERT(begin <= end);
+
+    // clean the bits of the range
+    std::memset(changedMask + (begin >> 6), 0,
+                ((end - begin + 63) >> 6) * sizeof(std::uint64_t));
+
+    KERNELS[type](arrays, begin, end, timeFrame, changedMask);
+}
+
+} /* namespace AnimationKernel */
+} /* namespace ui */
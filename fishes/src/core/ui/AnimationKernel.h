@@ -0,0 +1,88 @@
+/*
+ * AnimationKernel.h
+ *
+ *  Created on: Mar 5, 2013
+ *      Author: agustin
+ */
+
+#ifndef ANIMATIONKERNEL_H_
+#define ANIMATIONKERNEL_H_
+
+#include <cstddef>
+#include <cstdint>
+
+
+namespace ui {
+
+// @brief The kernel used by the AnimationSystem to advance a lot of sprites at
+// once. It has a scalar version and SSE2 / AVX2 versions (4 / 8 sprites per
+// instruction) chosen at runtime depending on the cpu.
+//
+namespace AnimationKernel {
+
+// The flags used by the kernel, they must be the same than the ones used by
+// the AnimatedSprite
+enum Flag {
+    STOPPED =       (1 << 0),
+    LOOP =          (1 << 1),
+    PLAYING =       (1 << 2),
+};
+
+// The different implementations
+enum Type {
+    SCALAR = 0,
+    SSE2,
+    AVX2,
+
+    NUM_TYPES,
+};
+
+// The arrays the kernel work with (all of them with the same size)
+struct Arrays {
+    // input / output
+    float *accumTime;
+    int *flags;
+    unsigned int *frameIndex;
+
+    // input only
+    const float *animTime;
+    const float *timeFactor;
+    const unsigned int *begin;
+    const unsigned int *end;
+};
+
+// @brief Returns the best implementation supported by this cpu
+Type
+bestAvailable(void);
+
+// @brief Check if an implementation can run in this cpu
+bool
+isAvailable(Type type);
+
+// @brief Returns the name of an implementation
+const char *
+name(Type type);
+
+// @brief Advance the timers of the elements [begin, end), wrap the looping
+// animations, stop the finished ones and compute the new frame index of each
+// element (the texture rectangle is then taken from the sprite FrameTable).
+// The bits of changedMask corresponding to [begin, end) are overwritten with
+// 1 if the frame of the element changed, 0 otherwise (bit i is
+// changedMask[i / 64] & (1 << (i % 64))).
+// @param   type        The implementation to use (must be available)
+// @param   arrays      The arrays to process
+// @param   begin       The first element, must be multiple of 64
+// @param   end         One past the last element
+// @param   timeFrame   The last time frame
+// @param   changedMask The output mask
+void
+update(Type type,
+       const Arrays &arrays,
+       std::size_t begin,
+       std::size_t end,
+       float timeFrame,
+       std::uint64_t *changedMask);
+
+} /* namespace AnimationKernel */
+} /* namespace ui */
+#endif /* ANIMATIONKERNEL_H_ */
@@ -0,0 +1,403 @@
+/*
+ * AnimationLibrary.cpp
+ *
+ *  Created on: Mar 29, 2013
+ *      Author: agustin
+ */
+
+#include "AnimationLibrary.h"
+
+#include <fstream>
+#include <algorithm>
+#include <map>
+#include <set>
+#include <cstring>
+#include <cstdio>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <debug/DebugUtil.h>
+#include <memory/MemoryTracker.h>
+
+
+// auxiliar functions
+namespace {
+
+const char MAGIC[4] = {'F', 'A', 'N', 'M'};
+
+// The records are used in place, so the host must be little endian
+inline bool
+isLittleEndian(void)
+{
+    const std::uint32_t value = 1;
+    return *reinterpret_cast<const unsigned char *>(&value) == 1;
+}
+
+// Little endian writer
+class Writer {
+public:
+    void u32(std::uint32_t v)
+    {
+        for (unsigned int i = 0; i < 4; ++i) {
+            mData.push_back(static_cast<char>((v >> (i * 8)) & 0xFF));
+        }
+    }
+    void f32(float v)
+    {
+        std::uint32_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        u32(bits);
+    }
+    void raw(const char *data, std::size_t size)
+    {
+        mData.append(data, size);
+    }
+    std::string &data(void) {return mData;}
+private:
+    std::string mData;
+};
+
+// The string table of the file (each string stored only once)
+class StringTable {
+public:
+    std::uint32_t add(const std::string &str)
+    {
+        std::map<std::string, std::uint32_t>::iterator it = mOffsets.find(str);
+        if (it != mOffsets.end()) {
+            return it->second;
+        }
+        const std::uint32_t offset = mData.size();
+        mData.append(str);
+        mData.push_back('\0');
+        mOffsets[str] = offset;
+        return offset;
+    }
+    const std::string &data(void) const {return mData;}
+private:
+    std::map<std::string, std::uint32_t> mOffsets;
+    std::string mData;
+};
+
+// Returns the folder of a file name (with the last '/') or "" if none
+std::string
+folderOf(const std::string &fName)
+{
+    const std::size_t pos = fName.find_last_of("/\\");
+    return (pos == std::string::npos) ? "" : fName.substr(0, pos + 1);
+}
+
+// Order of the sheets in the file
+bool
+sheetLess(const ui::AnimationLibrary::SheetDef *a,
+          const ui::AnimationLibrary::SheetDef *b)
+{
+    return a->name < b->name;
+}
+
+}
+
+namespace ui {
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+AnimationLibrary::checkStructure(void) const
+{
+    static_assert(sizeof(Header) == 32 && sizeof(Sheet) == 24 &&
+                  sizeof(Anim) == 16, "The records must match the file");
+
+    const Header &h = *mHeader;
+    const std::size_t sheetsEnd = sizeof(Header) + h.numSheets * sizeof(Sheet);
+    const std::size_t animsEnd = sheetsEnd + h.numAnims * sizeof(Anim);
+    if (h.fileSize != mSize ||
+        sheetsEnd > mSize ||
+        animsEnd > h.stringsOffset ||
+        h.stringsOffset + std::size_t(h.stringsSize) > mSize ||
+        h.stringsSize == 0 ||
+        mStrings[h.stringsSize - 1] != '\0') {
+        return false;
+    }
+    for (std::uint32_t i = 0; i < h.numSheets; ++i) {
+        const Sheet &s = mSheets[i];
+        if (s.name >= h.stringsSize ||
+            s.texture >= h.stringsSize ||
+            std::size_t(s.firstAnim) + s.numAnims > h.numAnims ||
+            s.numColumns == 0 || s.numRows == 0) {
+            return false;
+        }
+        // the same ranges than validate(), the sprites use them directly
+        // to index the frames
+        const std::uint64_t numFrames = std::uint64_t(s.numColumns) * s.numRows;
+        for (std::uint32_t j = s.firstAnim; j < s.firstAnim + s.numAnims; ++j) {
+            const Anim &anim = mAnims[j];
+            if (anim.begin > anim.end || anim.end >= numFrames ||
+                !(anim.animTime > 0.f)) {
+                return false;
+            }
+        }
+    }
+    for (std::uint32_t i = 0; i < h.numAnims; ++i) {
+        if (mAnims[i].name >= h.stringsSize) {
+            return false;
+        }
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+AnimationLibrary::AnimationLibrary() :
+    mData(0)
+,   mSize(0)
+,   mHeader(0)
+,   mSheets(0)
+,   mAnims(0)
+,   mStrings(0)
+{
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+AnimationLibrary::~AnimationLibrary()
+{
+    if (mData != 0) {
+        munmap(mData, mSize);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+AnimationLibrary::Ptr
+AnimationLibrary::load(const std::string &fName)
+{
+    MEMORY_TAG_SCOPE(ANIMATION);
+    if (!isLittleEndian()) {
+        debugERROR("Animation libraries are only supported in little endian\n");
+        return Ptr();
+    }
+
+    const int fd = open(fName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        debugERROR("Error opening the animation library %s\n", fName.c_str());
+        return Ptr();
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || std::size_t(st.st_size) < sizeof(Header)) {
+        debugERROR("%s is not a valid animation library\n", fName.c_str());
+        close(fd);
+        return Ptr();
+    }
+    void *data = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        debugERROR("Error mapping the animation library %s\n", fName.c_str());
+        return Ptr();
+    }
+
+    // from here the library owns the mapping
+    AnimationLibrary *library = new AnimationLibrary;
+    Ptr result(library);
+    library->mFileName = fName;
+    library->mFolder = folderOf(fName);
+    library->mData = data;
+    library->mSize = st.st_size;
+
+    const char *bytes = static_cast<const char *>(data);
+    library->mHeader = reinterpret_cast<const Header *>(bytes);
+    const Header &h = *library->mHeader;
+    if (std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        h.version != VERSION) {
+        debugERROR("%s is not a valid animation library (version %u "
+                   "expected)\n", fName.c_str(), VERSION);
+        return Ptr();
+    }
+    library->mSheets = reinterpret_cast<const Sheet *>(bytes + sizeof(Header));
+    library->mAnims = reinterpret_cast<const Anim *>(
+        bytes + sizeof(Header) + h.numSheets * sizeof(Sheet));
+    library->mStrings = bytes + h.stringsOffset;
+    if (!library->checkStructure()) {
+        debugERROR("Corrupted animation library %s\n", fName.c_str());
+        return Ptr();
+    }
+
+    return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+AnimationLibrary::validate(const std::vector<SheetDef> &sheets)
+{
+    // print all the errors at once
+    bool valid = true;
+    std::set<std::string> sheetNames;
+    for (std::size_t i = 0; i < sheets.size(); ++i) {
+        const SheetDef &sheet = sheets[i];
+        const char *sName = sheet.name.c_str();
+        if (sheet.name.empty()) {
+            valid = false;
+            debugERROR("Sheet %zu has no name\n", i);
+        } else if (!sheetNames.insert(sheet.name).second) {
+            valid = false;
+            debugERROR("Sheet %s is duplicated\n", sName);
+        }
+        if (sheet.texture.empty()) {
+            valid = false;
+            debugERROR("Sheet %s has no texture\n", sName);
+        }
+        if (sheet.numColumns == 0 || sheet.numRows == 0) {
+            valid = false;
+            debugERROR("Sheet %s has an invalid number of columns (%zu) or "
+                       "rows (%zu)\n", sName, sheet.numColumns, sheet.numRows);
+        }
+
+        const std::size_t numFrames = sheet.numColumns * sheet.numRows;
+        std::set<std::string> animNames;
+        for (std::size_t j = 0; j < sheet.anims.size(); ++j) {
+            const AnimDef &anim = sheet.anims[j];
+            const char *aName = anim.name.c_str();
+            if (anim.name.empty()) {
+                valid = false;
+                debugERROR("Sheet %s: animation %zu has no name\n", sName, j);
+            } else if (!animNames.insert(anim.name).second) {
+                valid = false;
+                debugERROR("Sheet %s: animation %s is duplicated\n",
+                           sName, aName);
+            }
+            if (!(anim.animTime > 0.f)) {
+                valid = false;
+                debugERROR("Sheet %s: animation %s has invalid time\n",
+                           sName, aName);
+            }
+            if (anim.begin > anim.end || anim.end >= numFrames) {
+                valid = false;
+                debugERROR("Sheet %s: animation %s has invalid begin[%zu] or "
+                           "end[%zu] (%zu frames)\n", sName, aName, anim.begin,
+                           anim.end, numFrames);
+            }
+        }
+    }
+    return valid;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+AnimationLibrary::save(const std::string &fName,
+                       const std::vector<SheetDef> &sheets)
+{
+    if (!validate(sheets)) {
+        return false;
+    }
+
+    // the sheets are sorted by name to find them with a binary search
+    std::vector<const SheetDef *> sorted;
+    sorted.reserve(sheets.size());
+    std::size_t numAnims = 0;
+    for (std::size_t i = 0; i < sheets.size(); ++i) {
+        sorted.push_back(&sheets[i]);
+        numAnims += sheets[i].anims.size();
+    }
+    std::sort(sorted.begin(), sorted.end(), sheetLess);
+
+    StringTable strings;
+    Writer records;
+    std::size_t firstAnim = 0;
+    for (std::size_t i = 0; i < sorted.size(); ++i) {
+        const SheetDef &sheet = *sorted[i];
+        records.u32(strings.add(sheet.name));
+        records.u32(strings.add(sheet.texture));
+        records.u32(sheet.numColumns);
+        records.u32(sheet.numRows);
+        records.u32(firstAnim);
+        records.u32(sheet.anims.size());
+        firstAnim += sheet.anims.size();
+    }
+    for (std::size_t i = 0; i < sorted.size(); ++i) {
+        const std::vector<AnimDef> &anims = sorted[i]->anims;
+        for (std::size_t j = 0; j < anims.size(); ++j) {
+            records.u32(strings.add(anims[j].name));
+            records.u32(anims[j].begin);
+            records.u32(anims[j].end);
+            records.f32(anims[j].animTime);
+        }
+    }
+    ASSERT(firstAnim == numAnims);
+
+    // always have at least one string (the empty one)
+    strings.add("");
+
+    Writer writer;
+    const std::size_t stringsOffset = sizeof(Header) + records.data().size();
+    writer.raw(MAGIC, sizeof(MAGIC));
+    writer.u32(VERSION);
+    writer.u32(stringsOffset + strings.data().size());
+    writer.u32(sorted.size());
+    writer.u32(numAnims);
+    writer.u32(stringsOffset);
+    writer.u32(strings.data().size());
+    writer.u32(0);
+    ASSERT(writer.data().size() == sizeof(Header));
+    writer.raw(records.data().data(), records.data().size());
+    writer.raw(strings.data().data(), strings.data().size());
+
+    // written aside and renamed: the running games keep mapping the old
+    // file and see the new one complete (see HotReloader)
+    const std::string tmpName = fName + ".tmp";
+    std::ofstream os(tmpName.c_str(), std::ios::binary);
+    if (!os.good()) {
+        debugERROR("Error opening (to write) %s\n", tmpName.c_str());
+        return false;
+    }
+    os.write(writer.data().data(), writer.data().size());
+    os.close();
+    if (os.fail() || std::rename(tmpName.c_str(), fName.c_str()) != 0) {
+        debugERROR("Error writing %s\n", fName.c_str());
+        std::remove(tmpName.c_str());
+        return false;
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const AnimationLibrary::Sheet *
+AnimationLibrary::findSheet(const std::string &name) const
+{
+    std::size_t low = 0, high = mHeader->numSheets;
+    while (low < high) {
+        const std::size_t mid = (low + high) / 2;
+        const int cmp = std::strcmp(string(mSheets[mid].name), name.c_str());
+        if (cmp == 0) {
+            return &mSheets[mid];
+        }
+        if (cmp < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int
+AnimationLibrary::findAnim(const Sheet &sheet, const std::string &name) const
+{
+    const Anim *sheetAnims = anims(sheet);
+    for (std::uint32_t i = 0; i < sheet.numAnims; ++i) {
+        if (name == string(sheetAnims[i].name)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::string
+AnimationLibrary::textureOf(const Sheet &sheet) const
+{
+    return mFolder + string(sheet.texture);
+}
+
+} /* namespace ui */
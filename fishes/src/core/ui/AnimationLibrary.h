@@ -0,0 +1,184 @@
+/*
+ * AnimationLibrary.h
+ *
+ *  Created on: Mar 29, 2013
+ *      Author: agustin
+ */
+
+#ifndef ANIMATIONLIBRARY_H_
+#define ANIMATIONLIBRARY_H_
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <boost/shared_ptr.hpp>
+
+
+namespace ui {
+
+// @brief A compiled catalogue of animated sheets: the layout of each sheet
+// (texture, columns, rows) and its animation table. The file is generated
+// (and fully validated) by the AnimCompiler tool (extras/AnimCompiler) and
+// it is mapped in memory when loaded, the records are used in place so all
+// the sprites of a sheet reference the same table without parsing or copying
+// anything.
+//
+// Binary format (little endian, every field is 4 bytes aligned):
+//  header:     char[4] "FANM", u32 version, u32 fileSize, u32 numSheets,
+//              u32 numAnims, u32 stringsOffset, u32 stringsSize, u32 reserved
+//  sheets:     numSheets x Sheet, sorted by name
+//  anims:      numAnims x Anim, the ones of each sheet are contiguous
+//  strings:    '\0' terminated strings, the name / texture fields of the
+//              records are offsets into this block. The texture names are
+//              relative to the library file folder.
+//
+class AnimationLibrary
+{
+public:
+    typedef boost::shared_ptr<const AnimationLibrary> Ptr;
+
+    static const std::uint32_t VERSION = 1;
+
+    // The records as they are stored in the file
+    struct Sheet {
+        std::uint32_t name;
+        std::uint32_t texture;
+        std::uint32_t numColumns;
+        std::uint32_t numRows;
+        std::uint32_t firstAnim;
+        std::uint32_t numAnims;
+    };
+    struct Anim {
+        std::uint32_t name;
+        std::uint32_t begin;
+        std::uint32_t end;
+        float animTime;
+    };
+
+    // The description of the sheets used to create the file (by the
+    // AnimCompiler)
+    struct AnimDef {
+        std::string name;
+        std::size_t begin;
+        std::size_t end;
+        float animTime;
+    };
+    struct SheetDef {
+        std::string name;
+        std::string texture;
+        std::size_t numColumns;
+        std::size_t numRows;
+        std::vector<AnimDef> anims;
+    };
+
+public:
+    ~AnimationLibrary();
+
+    // @brief Map a library file in memory. The structure of the file and
+    // the frame ranges of the animations are checked (the names and the
+    // rest of the values were validated by the compiler).
+    // @param   fName   The library file name
+    // @returns the library, or an empty pointer on error
+    static Ptr load(const std::string &fName);
+
+    // @brief Check the definitions (printing all the errors found) and write
+    // the library file.
+    // @returns true on success, false otherwise
+    static bool validate(const std::vector<SheetDef> &sheets);
+    static bool save(const std::string &fName,
+                     const std::vector<SheetDef> &sheets);
+
+    // @brief Returns the sheets
+    inline std::size_t numSheets(void) const;
+    inline const Sheet &sheet(std::size_t index) const;
+
+    // @brief Find a sheet by name (O(log N))
+    // @returns the sheet or 0 if not found
+    const Sheet *findSheet(const std::string &name) const;
+
+    // @brief Returns the animations of a sheet (sheet.numAnims records)
+    inline const Anim *anims(const Sheet &sheet) const;
+
+    // @brief Find the index of an animation of a sheet by name (O(N))
+    // @returns the index or -1 if not found
+    int findAnim(const Sheet &sheet, const std::string &name) const;
+
+    // @brief Returns a string of the file (a name of a record)
+    inline const char *string(std::uint32_t offset) const;
+
+    // @brief Returns the texture file name of a sheet (relative to the
+    // current folder)
+    std::string textureOf(const Sheet &sheet) const;
+
+    // @brief Returns the file name of the library (as given to load())
+    inline const std::string &fileName(void) const;
+
+private:
+    struct Header {
+        char magic[4];
+        std::uint32_t version;
+        std::uint32_t fileSize;
+        std::uint32_t numSheets;
+        std::uint32_t numAnims;
+        std::uint32_t stringsOffset;
+        std::uint32_t stringsSize;
+        std::uint32_t reserved;
+    };
+
+    AnimationLibrary();
+    AnimationLibrary(const AnimationLibrary &);
+    AnimationLibrary &operator=(const AnimationLibrary &);
+
+    // @brief Check that all the offsets / counts of the mapped file are
+    // inside the file and the layouts / animation ranges are valid (a
+    // reloaded file could be anything)
+    bool checkStructure(void) const;
+
+private:
+    std::string mFileName;
+    std::string mFolder;
+    void *mData;
+    std::size_t mSize;
+    const Header *mHeader;
+    const Sheet *mSheets;
+    const Anim *mAnims;
+    const char *mStrings;
+};
+
+
+// Inline implementations
+//
+
+inline std::size_t
+AnimationLibrary::numSheets(void) const
+{
+    return mHeader->numSheets;
+}
+
+inline const AnimationLibrary::Sheet &
+AnimationLibrary::sheet(std::size_t index) const
+{
+    return mSheets[index];
+}
+
+inline const AnimationLibrary::Anim *
+AnimationLibrary::anims(const Sheet &sheet) const
+{
+    return mAnims + sheet.firstAnim;
+}
+
+inline const char *
+AnimationLibrary::string(std::uint32_t offset) const
+{
+    return mStrings + offset;
+}
+
+inline const std::string &
+AnimationLibrary::fileName(void) const
+{
+    return mFileName;
+}
+
+} /* namespace ui */
+#endif /* ANIMATIONLIBRARY_H_ */
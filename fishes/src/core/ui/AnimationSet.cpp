@@ -0,0 +1,414 @@
+/*
+ * AnimationSet.cpp
+ *
+ *  Created on: Apr 2, 2013
+ *      Author: agustin
+ */
+
+#include "AnimationSet.h"
+
+#include <debug/DebugUtil.h>
+#include <memory/MemoryTracker.h>
+
+
+namespace ui {
+
+AnimationSet::SetMap AnimationSet::sSets;
+AnimationSet *AnimationSet::sFirst = 0;
+std::size_t AnimationSet::sRevision = 0;
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+AnimationSet::Key::operator<(const Key &o) const
+{
+    if (source != o.source) return source < o.source;
+    if (sheet != o.sheet) return sheet < o.sheet;
+    if (numColumns != o.numColumns) return numColumns < o.numColumns;
+    return numRows < o.numRows;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+AnimationSet::Ptr
+AnimationSet::find(const Key &key)
+{
+    SetMap::iterator it = sSets.find(key);
+    if (it == sSets.end()) {
+        return Ptr();
+    }
+    Ptr set = it->second.lock();
+    if (set.get() == 0) {
+        // nobody is using it anymore
+        sSets.erase(it);
+    }
+    return set;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+AnimationSet::Ptr
+AnimationSet::add(const Key &key, AnimationSet *set)
+{
+    Ptr result(set);
+    sSets[key] = result;
+    return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+AnimationSet::link(void)
+{
+    mPrev = 0;
+    mNext = sFirst;
+    if (sFirst != 0) {
+        sFirst->mPrev = this;
+    }
+    sFirst = this;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+AnimationSet::unlink(void)
+{
+    if (mPrev != 0) {
+        mPrev->mNext = mNext;
+    } else {
+        sFirst = mNext;
+    }
+    if (mNext != 0) {
+        mNext->mPrev = mPrev;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+AnimationSet::moveToLibrary(const AnimationLibrary::Ptr &library,
+                            const std::string &sheetName,
+                            Key &key)
+{
+    const AnimationLibrary::Sheet *sheet = library->findSheet(sheetName);
+    if (sheet == 0) {
+        debugWARNING("Sheet %s removed from %s, keeping the old one\n",
+                     sheetName.c_str(), library->fileName().c_str());
+        return false;
+    }
+    // the sprites could be playing any of the current animations
+    if (sheet->numAnims < mNumAnims) {
+        debugWARNING("Sheet %s of %s has less animations than before (%u < "
+                     "%zu), keeping the old one\n", sheetName.c_str(),
+                     library->fileName().c_str(), sheet->numAnims, mNumAnims);
+        return false;
+    }
+
+    // the texture or the layout could change too
+    const std::string textFName = library->textureOf(*sheet);
+    TextureHandle texture = TextureCache::getInstance()->get(textFName);
+    Ptr layout = grid(texture, sheet->numColumns, sheet->numRows);
+    if (layout.get() == 0) {
+        debugWARNING("Error loading the texture %s, keeping the old sheet\n",
+                     textFName.c_str());
+        return false;
+    }
+
+    mTexture = layout->mTexture;
+    mFrameTable = layout->mFrameTable;
+    mFrameRects = layout->mFrameRects;
+    mNumColumns = layout->mNumColumns;
+    mNumRows = layout->mNumRows;
+    mLibrary = library;
+    mAnims = library->anims(*sheet);
+    mNumAnims = sheet->numAnims;
+
+    key.source = library.get();
+    key.sheet = sheet;
+    key.numColumns = sheet->numColumns;
+    key.numRows = sheet->numRows;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+AnimationSet::AnimationSet() :
+    mFrameRects(0)
+,   mNumColumns(0)
+,   mNumRows(0)
+,   mAnims(0)
+,   mNumAnims(0)
+{
+    link();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+AnimationSet::AnimationSet(const AnimationSet &other) :
+    mTexture(other.mTexture)
+,   mFrameTable(other.mFrameTable)
+,   mFrameRects(other.mFrameRects)
+,   mNumColumns(other.mNumColumns)
+,   mNumRows(other.mNumRows)
+,   mLibrary(other.mLibrary)
+,   mOwnAnims(other.mOwnAnims)
+,   mAnims(other.mOwnAnims.empty() ? other.mAnims : mOwnAnims.data())
+,   mNumAnims(other.mNumAnims)
+{
+    link();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+AnimationSet::~AnimationSet()
+{
+    unlink();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t
+AnimationSet::onTextureReloaded(const TextureHandle &texture)
+{
+    MEMORY_TAG_SCOPE(ANIMATION);
+    if (texture.get() == 0) {
+        return 0;
+    }
+    const sf::Vector2u textSize = texture->getSize();
+    std::size_t count = 0;
+    for (AnimationSet *set = sFirst; set != 0; set = set->mNext) {
+        // the atlas sets take the frames from the atlas index
+        if (set->mTexture.get() != texture.get() ||
+            set->mFrameTable.get() == 0) {
+            continue;
+        }
+        // the same size gives the same (cached) table
+        FrameTable::Ptr table = FrameTable::grid(set->mNumColumns,
+                                                 set->mNumRows,
+                                                 textSize.x / set->mNumColumns,
+                                                 textSize.y / set->mNumRows);
+        if (table != set->mFrameTable) {
+            set->mFrameTable = table;
+            set->mFrameRects = table->data();
+            ++count;
+        }
+    }
+    if (count > 0) {
+        ++sRevision;
+    }
+    return count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t
+AnimationSet::reloadLibrary(const std::string &fName)
+{
+    MEMORY_TAG_SCOPE(ANIMATION);
+    const std::string path = TextureCache::normalizePath(fName);
+
+    // all the sets built from a library are cached. The library is loaded
+    // only if some set uses it.
+    AnimationLibrary::Ptr library;
+    std::vector<std::pair<Key, Ptr> > moved;
+    for (SetMap::iterator it = sSets.begin(); it != sSets.end(); ) {
+        Ptr set = it->second.lock();
+        if (set.get() == 0) {
+            sSets.erase(it++);
+            continue;
+        }
+        const AnimationLibrary *current = set->mLibrary.get();
+        if (current == 0 ||
+            TextureCache::normalizePath(current->fileName()) != path) {
+            ++it;
+            continue;
+        }
+        if (library.get() == 0) {
+            library = AnimationLibrary::load(fName);
+            if (library.get() == 0) {
+                debugERROR("Error reloading %s, keeping the old one\n",
+                           fName.c_str());
+                return 0;
+            }
+        }
+
+        // the key has the sheet record of the current library
+        const AnimationLibrary::Sheet *sheet =
+            static_cast<const AnimationLibrary::Sheet *>(it->first.sheet);
+        const std::string sheetName = current->string(sheet->name);
+        Key key;
+        // the sets are only const for the users, they are created here
+        AnimationSet *target = const_cast<AnimationSet *>(set.get());
+        if (target->moveToLibrary(library, sheetName, key)) {
+            moved.push_back(std::make_pair(key, set));
+            sSets.erase(it++);
+        } else {
+            ++it;
+        }
+    }
+
+    for (std::size_t i = 0; i < moved.size(); ++i) {
+        sSets[moved[i].first] = moved[i].second;
+    }
+    if (!moved.empty()) {
+        ++sRevision;
+    }
+    return moved.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+AnimationSet::Ptr
+AnimationSet::grid(const TextureHandle &texture,
+                   std::size_t numColumns,
+                   std::size_t numRows)
+{
+    MEMORY_TAG_SCOPE(ANIMATION);
+    if (texture.get() == 0) {
+        debugERROR("Invalid texture\n");
+        return Ptr();
+    }
+    if (numColumns == 0 || numRows == 0) {
+        debugERROR("Invalid number of columns (%zu) or rows (%zu)\n",
+                   numColumns, numRows);
+        return Ptr();
+    }
+
+    const Key key = {texture.get(), 0, numColumns, numRows};
+    Ptr set = find(key);
+    if (set.get() != 0) {
+        return set;
+    }
+
+    // all the sets with the same layout share the frame table
+    const sf::Vector2u textSize = texture->getSize();
+    AnimationSet *result = new AnimationSet;
+    result->mTexture = texture;
+    result->mFrameTable = FrameTable::grid(numColumns,
+                                           numRows,
+                                           textSize.x / numColumns,
+                                           textSize.y / numRows);
+    result->mFrameRects = result->mFrameTable->data();
+    result->mNumColumns = numColumns;
+    result->mNumRows = numRows;
+    return add(key, result);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+AnimationSet::Ptr
+AnimationSet::fromAtlas(const AtlasIndex &atlas, const std::string &sheetName)
+{
+    MEMORY_TAG_SCOPE(ANIMATION);
+    const AtlasIndex::Sheet *sheet = atlas.findSheet(sheetName);
+    if (sheet == 0) {
+        debugERROR("Sheet %s not found in the atlas\n", sheetName.c_str());
+        return Ptr();
+    }
+    if (sheet->numFrames == 0 ||
+        sheet->numFrames != sheet->numColumns * sheet->numRows) {
+        debugERROR("Sheet %s has an invalid number of frames\n",
+                   sheetName.c_str());
+        return Ptr();
+    }
+
+    const std::string &pageName = atlas.pages()[sheet->page].fName;
+    TextureHandle texture = TextureCache::getInstance()->get(pageName);
+    if (texture.get() == 0) {
+        debugERROR("Error loading atlas page: %s\n", pageName.c_str());
+        return Ptr();
+    }
+
+    // the atlas index is already a frame table
+    AnimationSet *result = new AnimationSet;
+    result->mTexture = texture;
+    result->mFrameRects = atlas.frames(*sheet);
+    result->mNumColumns = sheet->numColumns;
+    result->mNumRows = sheet->numRows;
+    return Ptr(result);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+AnimationSet::Ptr
+AnimationSet::fromLibrary(const AnimationLibrary::Ptr &library,
+                          const std::string &sheetName)
+{
+    MEMORY_TAG_SCOPE(ANIMATION);
+    if (library.get() == 0) {
+        debugERROR("Invalid animation library\n");
+        return Ptr();
+    }
+    const AnimationLibrary::Sheet *sheet = library->findSheet(sheetName);
+    if (sheet == 0) {
+        debugERROR("Sheet %s not found in the library\n", sheetName.c_str());
+        return Ptr();
+    }
+
+    const Key key = {library.get(), sheet, sheet->numColumns, sheet->numRows};
+    Ptr set = find(key);
+    if (set.get() != 0) {
+        return set;
+    }
+
+    const std::string textFName = library->textureOf(*sheet);
+    TextureHandle texture = TextureCache::getInstance()->get(textFName);
+    Ptr layout = grid(texture, sheet->numColumns, sheet->numRows);
+    if (layout.get() == 0) {
+        debugERROR("Error loading the texture %s\n", textFName.c_str());
+        return Ptr();
+    }
+
+    // use the table of the library in place
+    AnimationSet *result = new AnimationSet(*layout);
+    result->mLibrary = library;
+    result->mAnims = library->anims(*sheet);
+    result->mNumAnims = sheet->numAnims;
+    return add(key, result);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+AnimationSet::Ptr
+AnimationSet::withAnims(const std::vector<AnimIndices> &animations) const
+{
+    MEMORY_TAG_SCOPE(ANIMATION);
+    // only check this in debug
+    ASSERT(checkAnims(animations));
+
+    AnimationSet *result = new AnimationSet(*this);
+    result->mLibrary.reset();
+    result->mOwnAnims.clear();
+    result->mOwnAnims.resize(animations.size());
+    for (std::size_t i = 0, size = animations.size(); i < size; ++i) {
+        Anim &anim = result->mOwnAnims[i];
+        anim.name = 0;
+        anim.begin = animations[i].begin;
+        anim.end = animations[i].end;
+        anim.animTime = animations[i].animTime;
+    }
+    result->mAnims = result->mOwnAnims.data();
+    result->mNumAnims = result->mOwnAnims.size();
+    return Ptr(result);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+AnimationSet::checkAnims(const std::vector<AnimIndices> &animations) const
+{
+    // this function is ultra verbose just to print almost all the possible
+    // errors at once
+    bool valid = true;
+    const std::size_t numSprites = numFrames();
+    for(std::size_t i = 0, size = animations.size(); i < size; ++i){
+        const AnimIndices &animI = animations[i];
+        if (animI.animTime < 0.f) {
+            valid = false;
+            debugERROR("Animation %zu has invalid time\n", i);
+        }
+        if (animI.begin >= numSprites) {
+            valid = false;
+            debugERROR("Animation %zu has invalid begin: %zu\n", i, animI.begin);
+        }
+        if (animI.end >= numSprites) {
+            valid = false;
+            debugERROR("Animation %zu has invalid end: %zu\n", i, animI.end);
+        }
+        if (animI.begin > animI.end) {
+            valid = false;
+            debugERROR("Animation %zu has invalid begin[%zu] or end[%zu]\n",
+                i, animI.begin, animI.end);
+        }
+    }
+    return valid;
+}
+
+} /* namespace ui */
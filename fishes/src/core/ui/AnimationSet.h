@@ -0,0 +1,251 @@
+/*
+ * AnimationSet.h
+ *
+ *  Created on: Apr 2, 2013
+ *      Author: agustin
+ */
+
+#ifndef ANIMATIONSET_H_
+#define ANIMATIONSET_H_
+
+#include <map>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+
+#include <SFML/Graphics/Rect.hpp>
+#include <debug/DebugUtil.h>
+
+#include "TextureCache.h"
+#include "AtlasIndex.h"
+#include "AnimationLibrary.h"
+#include "FrameTable.h"
+
+
+namespace ui {
+
+// @brief Immutable description of an animated sheet: the texture, the layout
+// (columns, rows and the rectangle of each frame) and the animation table.
+// All the sprites of the same kind (i.e. all the red fishes) share the same
+// set, each sprite only has its playback state.
+// The sets of a texture grid / library sheet are cached (while someone use
+// them) so building a lot of sprites from the same source creates only one.
+// This class is not thread safe, it should be used from the main thread.
+//
+class AnimationSet
+{
+public:
+    typedef boost::shared_ptr<const AnimationSet> Ptr;
+    typedef AnimationLibrary::Anim Anim;
+
+    // The animation description used to build tables in code
+    struct AnimIndices {
+        std::size_t begin;
+        std::size_t end;
+        float animTime;
+    };
+
+public:
+    // @brief Get the set of a texture with a uniform grid of frames (and
+    // without animations).
+    // @param   texture     The texture handle (from the TextureCache)
+    // @param   numColumns  The number of columns
+    // @param   numRows     The number of rows
+    // @returns the set or an empty pointer on error
+    static Ptr grid(const TextureHandle &texture,
+                    std::size_t numColumns,
+                    std::size_t numRows);
+
+    // @brief Get the set of a compile time grid
+    // @param   texture     The texture handle (from the TextureCache)
+    template<std::size_t COLUMNS, std::size_t ROWS>
+    static Ptr grid(const TextureHandle &texture);
+
+    // @brief Create the set of a sheet of a texture atlas (without
+    // animations). The atlas should live while the set is used.
+    // @param   atlas       The atlas index
+    // @param   sheetName   The name of the sheet in the atlas
+    // @returns the set or an empty pointer on error
+    static Ptr fromAtlas(const AtlasIndex &atlas, const std::string &sheetName);
+
+    // @brief Get the set of a sheet of an animation library (the animation
+    // table is used in place).
+    // @param   library     The animation library
+    // @param   sheetName   The name of the sheet in the library
+    // @returns the set or an empty pointer on error
+    static Ptr fromLibrary(const AnimationLibrary::Ptr &library,
+                           const std::string &sheetName);
+
+    // @brief Create a new set with the same texture and layout than this one
+    // and a copy of the given animation table (checked only in debug).
+    // @param   animations  The animations, animations[i] has the ID i.
+    Ptr withAnims(const std::vector<AnimIndices> &animations) const;
+
+    // @brief Check if an animation table is valid for this set (printing
+    // all the errors).
+    bool checkAnims(const std::vector<AnimIndices> &animations) const;
+
+    // @brief Hot reload (see HotReloader). The sets are updated in place, so
+    // the sprites keep their set and take the new frames / animations the
+    // next time they are updated (they compare revision() with the one they
+    // were configured with).
+
+    // @brief Update the layout of the grid sets of a texture that was
+    // reloaded (the frames depend on the texture size).
+    // @param   texture     The reloaded texture
+    // @returns the number of sets whose frames changed
+    static std::size_t onTextureReloaded(const TextureHandle &texture);
+
+    // @brief Reload an animation library file and move the sets of its
+    // sheets to the new one (texture, layout and animations). A sheet that
+    // was removed or has less animations than before keeps the old one.
+    // @param   fName   The library file name
+    // @returns the number of sets moved to the new library
+    static std::size_t reloadLibrary(const std::string &fName);
+
+    // @brief Returns the number of reloads that changed some set
+    static inline std::size_t revision(void);
+
+    ~AnimationSet();
+
+    // @brief Accessors
+    inline const TextureHandle &texture(void) const;
+    inline const sf::IntRect &frame(std::size_t index) const;
+    inline std::size_t numColumns(void) const;
+    inline std::size_t numRows(void) const;
+    inline std::size_t numFrames(void) const;
+    inline const Anim &anim(std::size_t id) const;
+    inline std::size_t numAnims(void) const;
+
+private:
+    // Key of the cached sets: the source (texture or library) and the
+    // layout / sheet
+    struct Key {
+        const void *source;
+        const void *sheet;
+        std::size_t numColumns;
+        std::size_t numRows;
+
+        bool operator<(const Key &o) const;
+    };
+    typedef std::map<Key, boost::weak_ptr<const AnimationSet> > SetMap;
+
+    AnimationSet();
+    AnimationSet(const AnimationSet &other);
+    AnimationSet &operator=(const AnimationSet &);
+
+    // @brief Find a set already created / register a new one
+    static Ptr find(const Key &key);
+    static Ptr add(const Key &key, AnimationSet *set);
+
+    // @brief Link / unlink the set in the list of all the live sets
+    void link(void);
+    void unlink(void);
+
+    // @brief Move a library set to a sheet of a reloaded library
+    // @param   key     The new key of the set
+    // @returns true on success, false if the sheet is not compatible
+    bool moveToLibrary(const AnimationLibrary::Ptr &library,
+                       const std::string &sheetName,
+                       Key &key);
+
+private:
+    static SetMap sSets;
+    // all the live sets (the cached ones and the copies), for the reloads
+    static AnimationSet *sFirst;
+    static std::size_t sRevision;
+    AnimationSet *mPrev;
+    AnimationSet *mNext;
+
+    TextureHandle mTexture;
+    FrameTable::Ptr mFrameTable;
+    const sf::IntRect *mFrameRects;
+    std::size_t mNumColumns;
+    std::size_t mNumRows;
+    AnimationLibrary::Ptr mLibrary;
+    std::vector<Anim> mOwnAnims;
+    const Anim *mAnims;
+    std::size_t mNumAnims;
+};
+
+
+// Inline implementations
+//
+
+template<std::size_t COLUMNS, std::size_t ROWS>
+AnimationSet::Ptr
+AnimationSet::grid(const TextureHandle &texture)
+{
+    if (texture.get() == 0) {
+        return Ptr();
+    }
+    const Key key = {texture.get(), 0, COLUMNS, ROWS};
+    Ptr set = find(key);
+    if (set.get() != 0) {
+        return set;
+    }
+
+    const sf::Vector2u textSize = texture->getSize();
+    AnimationSet *result = new AnimationSet;
+    result->mTexture = texture;
+    result->mFrameTable = FrameTable::grid<COLUMNS, ROWS>(textSize.x / COLUMNS,
+                                                          textSize.y / ROWS);
+    result->mFrameRects = result->mFrameTable->data();
+    result->mNumColumns = COLUMNS;
+    result->mNumRows = ROWS;
+    return add(key, result);
+}
+
+inline std::size_t
+AnimationSet::revision(void)
+{
+    return sRevision;
+}
+
+inline const TextureHandle &
+AnimationSet::texture(void) const
+{
+    return mTexture;
+}
+
+inline const sf::IntRect &
+AnimationSet::frame(std::size_t index) const
+{
+    ASSERT(index < numFrames());
+    return mFrameRects[index];
+}
+
+inline std::size_t
+AnimationSet::numColumns(void) const
+{
+    return mNumColumns;
+}
+
+inline std::size_t
+AnimationSet::numRows(void) const
+{
+    return mNumRows;
+}
+
+inline std::size_t
+AnimationSet::numFrames(void) const
+{
+    return mNumColumns * mNumRows;
+}
+
+inline const AnimationSet::Anim &
+AnimationSet::anim(std::size_t id) const
+{
+    return mAnims[id];
+}
+
+inline std::size_t
+AnimationSet::numAnims(void) const
+{
+    return mNumAnims;
+}
+
+} /* namespace ui */
+#endif /* ANIMATIONSET_H_ */
@@ -0,0 +1,290 @@
+/*
+ * AnimationSystem.cpp
+ *
+ *  Created on: Mar 2, 2013
+ *      Author: agustin
+ */
+
+#include "AnimationSystem.h"
+
+#include <debug/DebugUtil.h>
+#include <debug/Profiler.h>
+#include <memory/MemoryTracker.h>
+#include <jobs/JobSystem.h>
+
+#include "AnimatedSprite.h"
+
+
+// auxiliar functions
+namespace {
+
+// 512 bits of the changed mask = 1 cache line
+const std::size_t GRAIN_MULTIPLE = 512;
+const std::size_t DEFAULT_GRAIN_SIZE = 4096;
+
+}
+
+
+namespace ui {
+
+////////////////////////////////////////////////////////////////////////////////
+void
+AnimationSystem::setAnim(std::size_t id,
+                         unsigned int begin,
+                         unsigned int end,
+                         float animTime)
+{
+    ASSERT(id < size());
+    ASSERT(end >= begin);
+
+    mAccumTime[id] = 0.f;
+    mAnimTime[id] = animTime;
+    mTimeFactor[id] = 1.f / animTime;
+    mBegin[id] = begin;
+    mEnd[id] = end;
+    mFrameIndex[id] = begin;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+AnimationSystem::loadState(std::size_t id, AnimatedSprite &sprite) const
+{
+    ASSERT(id < size());
+
+    sprite.mFlags = mFlags[id];
+    sprite.mAccumTime = mAccumTime[id];
+    sprite.mAnimTime = mAnimTime[id];
+    sprite.mTimeFactor = mTimeFactor[id];
+    sprite.mFrameIndex = mFrameIndex[id];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+AnimationKernel::Arrays
+AnimationSystem::arrays(void)
+{
+    AnimationKernel::Arrays result;
+    result.accumTime = mAccumTime.data();
+    result.flags = mFlags.data();
+    result.frameIndex = mFrameIndex.data();
+    result.animTime = mAnimTime.data();
+    result.timeFactor = mTimeFactor.data();
+    result.begin = mBegin.data();
+    result.end = mEnd.data();
+    return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+AnimationSystem::updateRange(std::size_t begin,
+                             std::size_t end,
+                             float timeFrame)
+{
+    PROFILE_FUNCTION();
+
+    // first pass: advance all the timers and compute the new frames.
+    // This only touches the contiguous arrays.
+    AnimationKernel::update(mKernel,
+                            arrays(),
+                            begin,
+                            end,
+                            timeFrame,
+                            mChangedMask.data());
+
+    // second pass: only the sprites that changed its frame are touched, the
+    // rectangle is taken from its frame table
+    for (std::size_t w = begin / 64, last = (end + 63) / 64; w < last; ++w) {
+        std::uint64_t bits = mChangedMask[w];
+        while (bits != 0) {
+            const std::size_t id = (w << 6) + __builtin_ctzll(bits);
+            mSprites[id]->configureRect(mFrameIndex[id]);
+            bits &= bits - 1;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+AnimationSystem::AnimationSystem() :
+    mKernel(AnimationKernel::bestAvailable())
+,   mGrainSize(DEFAULT_GRAIN_SIZE)
+,   mRevision(AnimationSet::revision())
+{
+    // the kernel flags must be the same than the AnimatedSprite ones
+    static_assert(
+        int(AnimationKernel::STOPPED) == int(AnimatedSprite::Flag::STOPPED) &&
+        int(AnimationKernel::LOOP) == int(AnimatedSprite::Flag::LOOP) &&
+        int(AnimationKernel::PLAYING) == int(AnimatedSprite::Flag::PLAYING),
+        "AnimationKernel flags differ from the AnimatedSprite ones");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+AnimationSystem::~AnimationSystem()
+{
+    clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+AnimationSystem::reserve(std::size_t count)
+{
+    MEMORY_TAG_SCOPE(UI);
+    mAccumTime.reserve(count);
+    mAnimTime.reserve(count);
+    mTimeFactor.reserve(count);
+    mBegin.reserve(count);
+    mEnd.reserve(count);
+    mFrameIndex.reserve(count);
+    mFlags.reserve(count);
+    mSprites.reserve(count);
+    mChangedMask.reserve((count + 63) / 64);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+AnimationSystem::add(AnimatedSprite &sprite)
+{
+    MEMORY_TAG_SCOPE(UI);
+    if (sprite.mSystem == this) {
+        debugWARNING("Sprite already in the system\n");
+        return;
+    }
+    ASSERT(sprite.mSystem == 0);
+    if (sprite.isLazy()) {
+        debugWARNING("Lazy sprites can't be added to the system\n");
+        return;
+    }
+
+    if (sprite.mRevision != AnimationSet::revision()) {
+        sprite.retarget();
+    }
+
+    // move the playback state into the arrays
+    unsigned int begin = 0, end = 0;
+    if (sprite.mSet.get() != 0 &&
+        sprite.mAnimIndex < sprite.mSet->numAnims()) {
+        begin = sprite.mSet->anim(sprite.mAnimIndex).begin;
+        end = sprite.mSet->anim(sprite.mAnimIndex).end;
+    }
+    mAccumTime.push_back(sprite.mAccumTime);
+    mAnimTime.push_back(sprite.mAnimTime);
+    mTimeFactor.push_back(sprite.mTimeFactor);
+    mBegin.push_back(begin);
+    mEnd.push_back(end);
+    mFrameIndex.push_back(sprite.mFrameIndex);
+    mFlags.push_back(sprite.mFlags);
+    mSprites.push_back(&sprite);
+
+    sprite.mSystem = this;
+    sprite.mSystemID = mSprites.size() - 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+AnimationSystem::remove(AnimatedSprite &sprite)
+{
+    if (sprite.mSystem != this) {
+        debugWARNING("Trying to remove a sprite that is not in the system\n");
+        return;
+    }
+    const std::size_t id = sprite.mSystemID;
+    ASSERT(id < size());
+    ASSERT(mSprites[id] == &sprite);
+
+    // give the state back to the sprite
+    loadState(id, sprite);
+    sprite.mSystem = 0;
+    sprite.mSystemID = 0;
+
+    // swap with the last one to keep the arrays packed
+    const std::size_t last = size() - 1;
+    if (id != last) {
+        mAccumTime[id] = mAccumTime[last];
+        mAnimTime[id] = mAnimTime[last];
+        mTimeFactor[id] = mTimeFactor[last];
+        mBegin[id] = mBegin[last];
+        mEnd[id] = mEnd[last];
+        mFrameIndex[id] = mFrameIndex[last];
+        mFlags[id] = mFlags[last];
+        mSprites[id] = mSprites[last];
+        mSprites[id]->mSystemID = id;
+    }
+    mAccumTime.pop_back();
+    mAnimTime.pop_back();
+    mTimeFactor.pop_back();
+    mBegin.pop_back();
+    mEnd.pop_back();
+    mFrameIndex.pop_back();
+    mFlags.pop_back();
+    mSprites.pop_back();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+AnimationSystem::clear(void)
+{
+    while (!mSprites.empty()) {
+        remove(*mSprites.back());
+    }
+    mChangedMask.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+AnimationSystem::update(float timeFrame, jobs::JobSystem *jobs)
+{
+    PROFILE_FUNCTION();
+
+    const std::size_t count = size();
+    if (count == 0) {
+        return;
+    }
+    if (mRevision != AnimationSet::revision()) {
+        // some sets were reloaded (between frames)
+        mRevision = AnimationSet::revision();
+        for (std::size_t i = 0; i < count; ++i) {
+            mSprites[i]->retarget();
+        }
+    }
+    mChangedMask.resize((count + 63) / 64);
+
+    if (jobs == 0 || jobs->numThreads() == 1 || count <= mGrainSize) {
+        updateRange(0, count, timeFrame);
+        return;
+    }
+
+    // each chunk touches only its own cache lines
+    jobs::JobSystem::Job *job =
+        jobs->parallelFor(0, count, mGrainSize,
+                          [this, timeFrame](std::size_t begin, std::size_t end) {
+                              updateRange(begin, end, timeFrame);
+                          });
+    jobs->wait(job);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+AnimationSystem::setGrainSize(std::size_t grainSize)
+{
+    if (grainSize == 0) {
+        grainSize = DEFAULT_GRAIN_SIZE;
+    }
+    mGrainSize = ((grainSize + GRAIN_MULTIPLE - 1) / GRAIN_MULTIPLE) *
+        GRAIN_MULTIPLE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+AnimationSystem::setKernel(AnimationKernel::Type type)
+{
+    if (!AnimationKernel::isAvailable(type)) {
+        debugERROR("Kernel %s is not supported by this cpu\n",
+                   AnimationKernel::name(type));
+        return false;
+    }
+    mKernel = type;
+    return true;
+}
+
+} /* namespace ui */
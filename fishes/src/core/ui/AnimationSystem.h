@@ -0,0 +1,160 @@
+/*
+ * AnimationSystem.h
+ *
+ *  Created on: Mar 2, 2013
+ *      Author: agustin
+ */
+
+#ifndef ANIMATIONSYSTEM_H_
+#define ANIMATIONSYSTEM_H_
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include <memory/AlignedAllocator.h>
+
+#include "AnimationKernel.h"
+
+
+// forward
+//
+namespace jobs {
+class JobSystem;
+}
+
+namespace ui {
+
+// forward
+//
+class AnimatedSprite;
+
+// @brief The AnimationSystem holds the playback state of a lot of
+// AnimatedSprites in contiguous arrays (structure of arrays) and advance all
+// of them in one pass. Once a sprite is added to the system it becomes a
+// handle into it: all the playback calls (setAnim / play / stop / setLoop) are
+// forwarded here and AnimatedSprite::update() does nothing.
+// The update is done by the AnimationKernel (using SIMD if possible) and only
+// the sprites whose frame changed get their texture rectangle updated (from
+// their FrameTable).
+//
+class AnimationSystem
+{
+public:
+    AnimationSystem();
+    ~AnimationSystem();
+
+    // @brief Reserve memory for a given number of sprites
+    // @param   count   The number of sprites we expect to handle
+    void reserve(std::size_t count);
+
+    // @brief Add / remove a sprite to the system. The sprite playback state
+    // (time, animation, flags) is moved into / out of the system.
+    // The sprite should not be already in other system, and can't be lazy
+    // (see AnimatedSprite::setLazy()).
+    // @param   sprite  The sprite to add / remove
+    void add(AnimatedSprite &sprite);
+    void remove(AnimatedSprite &sprite);
+
+    // @brief Remove all the sprites from the system
+    void clear(void);
+
+    // @brief Returns the number of sprites handled by the system
+    inline std::size_t size(void) const;
+
+    // @brief Update all the sprites of the system. This is the batched version
+    // of AnimatedSprite::update()
+    // If a JobSystem is given the sprites are split in chunks of grainSize()
+    // elements updated in parallel (this function returns when all of them
+    // finished).
+    // @param timeFrame     The last time frame.
+    // @param jobs          The JobSystem to use (if any)
+    void update(float timeFrame, jobs::JobSystem *jobs = 0);
+
+    // @brief Set / get the number of sprites of each parallel chunk. It is
+    // rounded up to a multiple of 512 so each chunk starts at the beginning
+    // of a cache line in all the arrays (including the changed mask) and the
+    // threads never write the same cache line.
+    void setGrainSize(std::size_t grainSize);
+    inline std::size_t grainSize(void) const;
+
+    // @brief Set / get the kernel implementation used to update the sprites.
+    // By default the best one supported by the cpu is used.
+    // @param   type    The kernel type, must be available in this cpu
+    // @returns true on success, false if the kernel cannot run in this cpu
+    bool setKernel(AnimationKernel::Type type);
+    inline AnimationKernel::Type kernel(void) const;
+
+private:
+    // avoid copying
+    AnimationSystem(const AnimationSystem &);
+    AnimationSystem &operator=(const AnimationSystem &);
+
+    // AnimatedSprite is a handle into the system, it access to the state
+    // directly
+    friend class AnimatedSprite;
+
+    // @brief Configure a new animation for the element id
+    void setAnim(std::size_t id,
+                 unsigned int begin,
+                 unsigned int end,
+                 float animTime);
+
+    // @brief Copy the playback state of the element id into the sprite
+    void loadState(std::size_t id, AnimatedSprite &sprite) const;
+
+    // @brief Returns the arrays used by the kernel
+    AnimationKernel::Arrays arrays(void);
+
+    // @brief Update the elements [begin, end), begin must be multiple of 64
+    void updateRange(std::size_t begin, std::size_t end, float timeFrame);
+
+private:
+    template<typename T>
+    struct Array {
+        typedef std::vector<T, memory::AlignedAllocator<T> > Type;
+    };
+
+    // the structure of arrays (cache line aligned), all of them have the
+    // same size
+    Array<float>::Type mAccumTime;
+    Array<float>::Type mAnimTime;
+    Array<float>::Type mTimeFactor;
+    Array<unsigned int>::Type mBegin;
+    Array<unsigned int>::Type mEnd;
+    Array<unsigned int>::Type mFrameIndex;
+    Array<int>::Type mFlags;
+    std::vector<AnimatedSprite *> mSprites;
+
+    // one bit per sprite, set if the frame changed in the last update
+    Array<std::uint64_t>::Type mChangedMask;
+    AnimationKernel::Type mKernel;
+    std::size_t mGrainSize;
+    // the AnimationSet::revision() of the sprites
+    std::size_t mRevision;
+};
+
+
+// Inline implementations
+//
+
+inline std::size_t
+AnimationSystem::size(void) const
+{
+    return mSprites.size();
+}
+
+inline std::size_t
+AnimationSystem::grainSize(void) const
+{
+    return mGrainSize;
+}
+
+inline AnimationKernel::Type
+AnimationSystem::kernel(void) const
+{
+    return mKernel;
+}
+
+} /* namespace ui */
+#endif /* ANIMATIONSYSTEM_H_ */
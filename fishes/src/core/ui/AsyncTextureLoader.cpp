@@ -0,0 +1,210 @@
+/*
+ * AsyncTextureLoader.cpp
+ *
+ *  Created on: Mar 26, 2013
+ *      Author: agustin
+ */
+
+#include "AsyncTextureLoader.h"
+#include "TextureDiskCache.h"
+
+#include <SFML/System/Clock.hpp>
+#include <FileManager.h>
+
+#include <debug/DebugUtil.h>
+#include <debug/FlightRecorder.h>
+#include <memory/MemoryTracker.h>
+
+
+namespace ui {
+
+////////////////////////////////////////////////////////////////////////////////
+void
+AsyncTextureLoader::workerLoop(void)
+{
+    MEMORY_TAG_SCOPE(TEXTURES);
+    while (true) {
+        Job *job = 0;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            while (!mExit && mToDecode.empty()) {
+                mCondition.wait(lock);
+            }
+            if (mExit) {
+                return;
+            }
+            job = mToDecode.front();
+            mToDecode.pop_front();
+        }
+
+        // read + decode without holding the lock
+        sf::Clock clock;
+        TextureDiskCache *diskCache = TextureDiskCache::getInstance();
+        if (FileManager::isPackPath(job->key)) {
+            FileView view;
+            job->loaded = FileManager::getInstance()->readFileView(job->key, view) &&
+                job->image.loadFromMemory(view.data(), view.size());
+        } else if (diskCache->load(job->key, job->image)) {
+            job->loaded = true;
+        } else {
+            TextureDiskCache::Source source;
+            job->loaded = TextureDiskCache::source(job->key, source) &&
+                job->image.loadFromFile(job->key);
+            if (job->loaded) {
+                diskCache->store(job->key, source, job->image);
+            }
+        }
+        job->decodeTime = clock.getElapsedTime().asSeconds();
+        FLIGHT_RECORD_LOAD(job->key.c_str(), job->decodeTime, job->loaded);
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        mToUpload.push_back(job);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+AsyncTextureLoader::notify(const std::string &key, const TextureHandle &handle)
+{
+    CallbackMap::iterator it = mCallbacks.find(key);
+    ASSERT(it != mCallbacks.end());
+
+    // the callbacks could request new textures, remove them first
+    std::vector<Callback> callbacks;
+    callbacks.swap(it->second);
+    mCallbacks.erase(it);
+
+    for (std::size_t i = 0, size = callbacks.size(); i < size; ++i) {
+        callbacks[i](handle);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+AsyncTextureLoader::AsyncTextureLoader(std::size_t numThreads,
+                                       std::size_t maxUploads) :
+    mExit(false)
+,   mMaxUploads(maxUploads)
+{
+    if (numThreads == 0) {
+        numThreads = 1;
+    }
+    mWorkers.reserve(numThreads);
+    for (std::size_t i = 0; i < numThreads; ++i) {
+        mWorkers.push_back(std::thread(&AsyncTextureLoader::workerLoop, this));
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+AsyncTextureLoader::~AsyncTextureLoader()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mExit = true;
+    }
+    mCondition.notify_all();
+    for (std::size_t i = 0; i < mWorkers.size(); ++i) {
+        mWorkers[i].join();
+    }
+
+    // the pending requests are dropped (without calling the callbacks)
+    for (std::size_t i = 0; i < mToDecode.size(); ++i) {
+        delete mToDecode[i];
+    }
+    for (std::size_t i = 0; i < mToUpload.size(); ++i) {
+        delete mToUpload[i];
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+AsyncTextureLoader::request(const std::string &fName, const Callback &callback)
+{
+    MEMORY_TAG_SCOPE(TEXTURES);
+    ASSERT(callback);
+    if (fName.empty()) {
+        debugERROR("fName is empty\n");
+        callback(TextureHandle());
+        return;
+    }
+
+    const std::string key = TextureCache::normalizePath(fName);
+    CallbackMap::iterator it = mCallbacks.find(key);
+    if (it != mCallbacks.end()) {
+        // already being loaded
+        it->second.push_back(callback);
+        return;
+    }
+    mCallbacks[key].push_back(callback);
+
+    TextureCache *cache = TextureCache::getInstance();
+    if (cache->contains(key)) {
+        mReady.push_back(std::make_pair(key, cache->get(key)));
+        return;
+    }
+
+    Job *job = new Job;
+    job->key = key;
+    job->decodeTime = 0.f;
+    job->loaded = false;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mToDecode.push_back(job);
+    }
+    mCondition.notify_one();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t
+AsyncTextureLoader::update(void)
+{
+    // the ones that were already in the cache
+    if (!mReady.empty()) {
+        std::vector<std::pair<std::string, TextureHandle> > ready;
+        ready.swap(mReady);
+        for (std::size_t i = 0, size = ready.size(); i < size; ++i) {
+            notify(ready[i].first, ready[i].second);
+        }
+    }
+
+    std::size_t uploaded = 0;
+    while (mMaxUploads == 0 || uploaded < mMaxUploads) {
+        Job *job = 0;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (mToUpload.empty()) {
+                break;
+            }
+            job = mToUpload.front();
+            mToUpload.pop_front();
+        }
+
+        Timing timing;
+        timing.fName = job->key;
+        timing.decodeTime = job->decodeTime;
+        timing.uploadTime = 0.f;
+        timing.loaded = false;
+
+        TextureHandle handle;
+        if (job->loaded) {
+            sf::Clock clock;
+            handle = TextureCache::getInstance()->add(job->key, job->image);
+            timing.uploadTime = clock.getElapsedTime().asSeconds();
+            timing.loaded = handle.get() != 0;
+            ++uploaded;
+        } else {
+            debugCAT(IO, debugERROR, "Error decoding texture: %s\n",
+                     job->key.c_str());
+        }
+        mTimings.push_back(timing);
+        delete job;
+
+        notify(timing.fName, handle);
+    }
+
+    return uploaded;
+}
+
+} /* namespace ui */
@@ -0,0 +1,146 @@
+/*
+ * AsyncTextureLoader.h
+ *
+ *  Created on: Mar 26, 2013
+ *      Author: agustin
+ */
+
+#ifndef ASYNCTEXTURELOADER_H_
+#define ASYNCTEXTURELOADER_H_
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <utility>
+#include <cstddef>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <boost/function.hpp>
+
+#include <SFML/Graphics/Image.hpp>
+
+#include "TextureCache.h"
+
+
+namespace ui {
+
+// @brief Load textures without blocking the main loop. The files are read and
+// decoded (into sf::Image) by worker threads, and the main thread uploads a
+// bounded number of them to the gpu each frame (calling update()), so a big
+// level load never produces a long frame.
+// The uploaded textures are registered in the TextureCache, so the rest of
+// the sprites can get them as usual.
+// Except the workers, this class should be used only from the main thread
+// (the callbacks are called from update()).
+//
+class AsyncTextureLoader
+{
+public:
+    // The callback called when a texture is ready (the handle is empty if
+    // the texture couldn't be loaded)
+    typedef boost::function<void (const TextureHandle &)> Callback;
+
+    // The timings of each loaded file (in seconds)
+    struct Timing {
+        std::string fName;
+        float decodeTime;
+        float uploadTime;
+        bool loaded;
+    };
+
+public:
+    // @param   numThreads      The number of decoding threads
+    // @param   maxUploads      The max number of textures uploaded per frame
+    //                          (0 = no limit)
+    AsyncTextureLoader(std::size_t numThreads = 2, std::size_t maxUploads = 2);
+    ~AsyncTextureLoader();
+
+    // @brief Request a texture. If it is already in the TextureCache the
+    // callback is called on the next update() without decoding anything.
+    // Requesting the same file more than once (while it is being loaded) only
+    // loads it once.
+    // @param   fName       The texture file name
+    // @param   callback    The function called when the texture is ready
+    void request(const std::string &fName, const Callback &callback);
+
+    // @brief Upload (at most maxUploads) decoded textures and call the
+    // callbacks of the finished requests. Must be called every frame from
+    // the main thread.
+    // @returns the number of textures uploaded
+    std::size_t update(void);
+
+    // @brief Returns the number of files requested and not finished yet
+    inline std::size_t pending(void) const;
+
+    // @brief Change the max number of uploads per frame (0 = no limit)
+    inline void setMaxUploads(std::size_t maxUploads);
+
+    // @brief Returns the timings of all the files loaded so far / clear them
+    inline const std::vector<Timing> &timings(void) const;
+    inline void clearTimings(void);
+
+private:
+    // The work of the workers
+    struct Job {
+        std::string key;
+        sf::Image image;
+        float decodeTime;
+        bool loaded;
+    };
+    typedef std::map<std::string, std::vector<Callback> > CallbackMap;
+
+    // @brief The worker threads function
+    void workerLoop(void);
+
+    // @brief Call all the callbacks of a file
+    void notify(const std::string &key, const TextureHandle &handle);
+
+private:
+    std::vector<std::thread> mWorkers;
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    bool mExit;
+
+    // shared with the workers (protected by mMutex)
+    std::deque<Job *> mToDecode;
+    std::deque<Job *> mToUpload;
+
+    // main thread only
+    CallbackMap mCallbacks;
+    std::vector<std::pair<std::string, TextureHandle> > mReady;
+    std::size_t mMaxUploads;
+    std::vector<Timing> mTimings;
+};
+
+
+// Inline implementations
+//
+
+inline std::size_t
+AsyncTextureLoader::pending(void) const
+{
+    return mCallbacks.size();
+}
+
+inline void
+AsyncTextureLoader::setMaxUploads(std::size_t maxUploads)
+{
+    mMaxUploads = maxUploads;
+}
+
+inline const std::vector<AsyncTextureLoader::Timing> &
+AsyncTextureLoader::timings(void) const
+{
+    return mTimings;
+}
+
+inline void
+AsyncTextureLoader::clearTimings(void)
+{
+    mTimings.clear();
+}
+
+} /* namespace ui */
+#endif /* ASYNCTEXTURELOADER_H_ */
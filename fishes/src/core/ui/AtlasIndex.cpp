@@ -0,0 +1,305 @@
+/*
+ * AtlasIndex.cpp
+ *
+ *  Created on: Mar 16, 2013
+ *      Author: agustin
+ */
+
+#include "AtlasIndex.h"
+
+#include <fstream>
+#include <iterator>
+#include <cstring>
+
+#include <debug/DebugUtil.h>
+#include <memory/MemoryTracker.h>
+
+
+// auxiliar functions
+namespace {
+
+const char MAGIC[4] = {'F', 'A', 'T', 'L'};
+// the size of the records in the file (without the names)
+const std::size_t PAGE_MIN_SIZE = 6;
+const std::size_t SHEET_MIN_SIZE = 16;
+const std::size_t FRAME_SIZE = 8;
+
+// Little endian writer, ok() returns false if some value didn't fit
+class Writer {
+public:
+    Writer() : mOk(true) {}
+    void u16(std::size_t v)
+    {
+        if (v > 0xFFFF) {
+            mOk = false;
+            v = 0;
+        }
+        mData.push_back(static_cast<char>(v & 0xFF));
+        mData.push_back(static_cast<char>((v >> 8) & 0xFF));
+    }
+    void u32(std::uint32_t v)
+    {
+        u16(v & 0xFFFF);
+        u16(v >> 16);
+    }
+    void str(const std::string &s)
+    {
+        u16(s.size());
+        mData.append(s);
+    }
+    void raw(const char *data, std::size_t size)
+    {
+        mData.append(data, size);
+    }
+    const std::string &data(void) const {return mData;}
+    bool ok(void) const {return mOk;}
+private:
+    std::string mData;
+    bool mOk;
+};
+
+// Little endian reader, all the functions return false if there is no more
+// data
+class Reader {
+public:
+    Reader(const std::string &data) : mData(data), mPos(0) {}
+    bool u16(unsigned int &v)
+    {
+        if (mPos + 2 > mData.size()) return false;
+        const unsigned char *p =
+            reinterpret_cast<const unsigned char *>(mData.data() + mPos);
+        v = p[0] | (p[1] << 8);
+        mPos += 2;
+        return true;
+    }
+    bool u32(std::uint32_t &v)
+    {
+        unsigned int low, high;
+        if (!u16(low) || !u16(high)) return false;
+        v = low | (high << 16);
+        return true;
+    }
+    bool str(std::string &s)
+    {
+        unsigned int size;
+        if (!u16(size) || mPos + size > mData.size()) return false;
+        s.assign(mData, mPos, size);
+        mPos += size;
+        return true;
+    }
+    bool raw(char *data, std::size_t size)
+    {
+        if (mPos + size > mData.size()) return false;
+        std::memcpy(data, mData.data() + mPos, size);
+        mPos += size;
+        return true;
+    }
+    std::size_t remaining(void) const {return mData.size() - mPos;}
+private:
+    const std::string &mData;
+    std::size_t mPos;
+};
+
+// Returns the folder of a file name (with the last '/') or "" if none
+std::string
+folderOf(const std::string &fName)
+{
+    const std::size_t pos = fName.find_last_of("/\\");
+    return (pos == std::string::npos) ? "" : fName.substr(0, pos + 1);
+}
+
+}
+
+namespace ui {
+
+////////////////////////////////////////////////////////////////////////////////
+AtlasIndex::AtlasIndex()
+{
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+AtlasIndex::~AtlasIndex()
+{
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+AtlasIndex::load(const std::string &fName)
+{
+    MEMORY_TAG_SCOPE(ANIMATION);
+    clear();
+
+    std::ifstream is(fName.c_str(), std::ios::binary);
+    if (!is.good()) {
+        debugERROR("Error opening the atlas index %s\n", fName.c_str());
+        return false;
+    }
+    const std::string data((std::istreambuf_iterator<char>(is)),
+                           std::istreambuf_iterator<char>());
+    Reader reader(data);
+
+    char magic[4];
+    std::uint32_t version, numPages, numSheets, numFrames;
+    if (!reader.raw(magic, sizeof(magic)) ||
+        std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        !reader.u32(version) || version != VERSION) {
+        debugERROR("%s is not a valid atlas index (version %u expected)\n",
+                   fName.c_str(), VERSION);
+        return false;
+    }
+    // the counts are checked against the smallest records (empty names)
+    // before allocating anything
+    if (!reader.u32(numPages) || !reader.u32(numSheets) ||
+        !reader.u32(numFrames) ||
+        std::uint64_t(numPages) * PAGE_MIN_SIZE +
+        std::uint64_t(numSheets) * SHEET_MIN_SIZE +
+        std::uint64_t(numFrames) * FRAME_SIZE > reader.remaining()) {
+        debugERROR("Corrupted atlas index %s\n", fName.c_str());
+        return false;
+    }
+
+    bool ok = true;
+    const std::string folder = folderOf(fName);
+    mPages.resize(numPages);
+    for (std::uint32_t i = 0; ok && i < numPages; ++i) {
+        Page &page = mPages[i];
+        ok = reader.u16(page.width) && reader.u16(page.height) &&
+             reader.str(page.fName);
+        page.fName = folder + page.fName;
+    }
+    mSheets.resize(numSheets);
+    for (std::uint32_t i = 0; ok && i < numSheets; ++i) {
+        Sheet &sheet = mSheets[i];
+        ok = reader.u16(sheet.page) && reader.u16(sheet.numColumns) &&
+             reader.u16(sheet.numRows) && reader.u32(sheet.firstFrame) &&
+             reader.u32(sheet.numFrames) && reader.str(sheet.name) &&
+             sheet.page < numPages &&
+             std::uint64_t(sheet.firstFrame) + sheet.numFrames <= numFrames;
+    }
+    mFrames.resize(numFrames);
+    for (std::uint32_t i = 0; ok && i < numFrames; ++i) {
+        unsigned int left = 0, top = 0, width = 0, height = 0;
+        ok = reader.u16(left) && reader.u16(top) &&
+             reader.u16(width) && reader.u16(height);
+        mFrames[i] = sf::IntRect(left, top, width, height);
+    }
+
+    if (!ok) {
+        debugERROR("Corrupted atlas index %s\n", fName.c_str());
+        clear();
+        return false;
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+AtlasIndex::save(const std::string &fName) const
+{
+    Writer writer;
+    writer.raw(MAGIC, sizeof(MAGIC));
+    writer.u32(VERSION);
+    writer.u32(mPages.size());
+    writer.u32(mSheets.size());
+    writer.u32(mFrames.size());
+    for (std::size_t i = 0; i < mPages.size(); ++i) {
+        writer.u16(mPages[i].width);
+        writer.u16(mPages[i].height);
+        writer.str(mPages[i].fName);
+    }
+    for (std::size_t i = 0; i < mSheets.size(); ++i) {
+        const Sheet &sheet = mSheets[i];
+        writer.u16(sheet.page);
+        writer.u16(sheet.numColumns);
+        writer.u16(sheet.numRows);
+        writer.u32(sheet.firstFrame);
+        writer.u32(sheet.numFrames);
+        writer.str(sheet.name);
+    }
+    for (std::size_t i = 0; i < mFrames.size(); ++i) {
+        writer.u16(mFrames[i].left);
+        writer.u16(mFrames[i].top);
+        writer.u16(mFrames[i].width);
+        writer.u16(mFrames[i].height);
+    }
+    if (!writer.ok()) {
+        debugERROR("The atlas %s has values too big for the format (pages, "
+                   "rectangles or names over %u)\n", fName.c_str(), MAX_U16);
+        return false;
+    }
+
+    std::ofstream os(fName.c_str(), std::ios::binary);
+    if (!os.good()) {
+        debugERROR("Error opening (to write) %s\n", fName.c_str());
+        return false;
+    }
+    os.write(writer.data().data(), writer.data().size());
+    return !os.fail();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+AtlasIndex::clear(void)
+{
+    mPages.clear();
+    mSheets.clear();
+    mFrames.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t
+AtlasIndex::addPage(const std::string &fName,
+                    unsigned int width,
+                    unsigned int height)
+{
+    Page page;
+    page.fName = fName;
+    page.width = width;
+    page.height = height;
+    mPages.push_back(page);
+    return mPages.size() - 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t
+AtlasIndex::addSheet(const std::string &name,
+                     unsigned int page,
+                     unsigned int numColumns,
+                     unsigned int numRows)
+{
+    ASSERT(page < mPages.size());
+    Sheet sheet;
+    sheet.name = name;
+    sheet.page = page;
+    sheet.numColumns = numColumns;
+    sheet.numRows = numRows;
+    sheet.firstFrame = mFrames.size();
+    sheet.numFrames = 0;
+    mSheets.push_back(sheet);
+    return mSheets.size() - 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+AtlasIndex::addFrame(const sf::IntRect &rect)
+{
+    ASSERT(!mSheets.empty());
+    mFrames.push_back(rect);
+    ++mSheets.back().numFrames;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const AtlasIndex::Sheet *
+AtlasIndex::findSheet(const std::string &name) const
+{
+    for (std::size_t i = 0; i < mSheets.size(); ++i) {
+        if (mSheets[i].name == name) {
+            return &mSheets[i];
+        }
+    }
+    return 0;
+}
+
+} /* namespace ui */
@@ -0,0 +1,128 @@
+/*
+ * AtlasIndex.h
+ *
+ *  Created on: Mar 16, 2013
+ *      Author: agustin
+ */
+
+#ifndef ATLASINDEX_H_
+#define ATLASINDEX_H_
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include <SFML/Graphics/Rect.hpp>
+
+
+namespace ui {
+
+// @brief The index of a texture atlas generated by the AtlasPacker tool
+// (extras/AtlasPacker). The atlas is composed by one or more pages (textures)
+// and a list of sheets, each sheet is a list of frames (sub-rectangles of
+// one page), frame i of the sheet is the i-th cell of the original grid:
+// 0    1   2   3
+// 4    5   6   7 ...
+//
+// Binary format (little endian):
+//  header:     char[4] "FATL", u32 version, u32 numPages, u32 numSheets,
+//              u32 numFrames
+//  pages:      numPages x {u16 width, u16 height, u16 nameLen, char[nameLen]}
+//              (the name is relative to the index file folder)
+//  sheets:     numSheets x {u16 page, u16 numColumns, u16 numRows,
+//              u32 firstFrame, u32 numFrames, u16 nameLen, char[nameLen]}
+//  frames:     numFrames x {u16 left, u16 top, u16 width, u16 height}
+//
+class AtlasIndex
+{
+public:
+    static const std::uint32_t VERSION = 1;
+    // The max value of the u16 fields (page sizes, pages, columns, rows,
+    // rectangles and name lengths), save() fails if something is bigger
+    static const unsigned int MAX_U16 = 0xFFFF;
+
+    struct Page {
+        std::string fName;
+        unsigned int width;
+        unsigned int height;
+    };
+
+    struct Sheet {
+        std::string name;
+        unsigned int page;
+        unsigned int numColumns;
+        unsigned int numRows;
+        unsigned int firstFrame;
+        unsigned int numFrames;
+    };
+
+public:
+    AtlasIndex();
+    ~AtlasIndex();
+
+    // @brief Load / save the index from / to a file.
+    // When loading, the page file names are converted to paths relative to
+    // the current folder (the folder of the index is prepended).
+    // Saving fails (writing nothing) if some value doesn't fit in its field
+    // (see MAX_U16).
+    // @returns true on success, false otherwise
+    bool load(const std::string &fName);
+    bool save(const std::string &fName) const;
+
+    // @brief Remove everything
+    void clear(void);
+
+    // @brief Functions used to build the index (by the packer).
+    // The frames are added to the last sheet added.
+    // @returns the index of the new page / sheet
+    std::size_t addPage(const std::string &fName,
+                        unsigned int width,
+                        unsigned int height);
+    std::size_t addSheet(const std::string &name,
+                         unsigned int page,
+                         unsigned int numColumns,
+                         unsigned int numRows);
+    void addFrame(const sf::IntRect &rect);
+
+    // @brief Returns the pages / sheets
+    inline const std::vector<Page> &pages(void) const;
+    inline const std::vector<Sheet> &sheets(void) const;
+
+    // @brief Find a sheet by name (O(N))
+    // @returns the sheet or 0 if not found
+    const Sheet *findSheet(const std::string &name) const;
+
+    // @brief Returns the frames of a sheet (sheet.numFrames rectangles)
+    inline const sf::IntRect *frames(const Sheet &sheet) const;
+
+private:
+    std::vector<Page> mPages;
+    std::vector<Sheet> mSheets;
+    std::vector<sf::IntRect> mFrames;
+};
+
+
+// Inline implementations
+//
+
+inline const std::vector<AtlasIndex::Page> &
+AtlasIndex::pages(void) const
+{
+    return mPages;
+}
+
+inline const std::vector<AtlasIndex::Sheet> &
+AtlasIndex::sheets(void) const
+{
+    return mSheets;
+}
+
+inline const sf::IntRect *
+AtlasIndex::frames(const Sheet &sheet) const
+{
+    return mFrames.data() + sheet.firstFrame;
+}
+
+} /* namespace ui */
+#endif /* ATLASINDEX_H_ */
@@ -7,11 +7,39 @@ set(CP /core/ui)
 set(SRCS
 	${SRCS}
 	${DEV_ROOT_PATH}/core/ui/AnimatedSprite.cpp
+	${DEV_ROOT_PATH}/core/ui/AsyncTextureLoader.cpp
+	${DEV_ROOT_PATH}/core/ui/AtlasIndex.cpp
+	${DEV_ROOT_PATH}/core/ui/FrameTable.cpp
+	${DEV_ROOT_PATH}/core/ui/HotReloader.cpp
+	${DEV_ROOT_PATH}/core/ui/AnimationLibrary.cpp
+	${DEV_ROOT_PATH}/core/ui/AnimationSet.cpp
+	${DEV_ROOT_PATH}/core/ui/AnimationClock.cpp
+	${DEV_ROOT_PATH}/core/ui/AnimationKernel.cpp
+	${DEV_ROOT_PATH}/core/ui/AnimationSystem.cpp
+	${DEV_ROOT_PATH}/core/ui/SpriteBatch.cpp
+	${DEV_ROOT_PATH}/core/ui/SpritePool.cpp
+	${DEV_ROOT_PATH}/core/ui/SpatialGrid.cpp
+	${DEV_ROOT_PATH}/core/ui/TextureCache.cpp
+	${DEV_ROOT_PATH}/core/ui/TextureDiskCache.cpp
 )
 
 set(HDRS
 	${HDRS}
 	${DEV_ROOT_PATH}/core/ui/AnimatedSprite.h
+	${DEV_ROOT_PATH}/core/ui/AsyncTextureLoader.h
+	${DEV_ROOT_PATH}/core/ui/AtlasIndex.h
+	${DEV_ROOT_PATH}/core/ui/FrameTable.h
+	${DEV_ROOT_PATH}/core/ui/HotReloader.h
+	${DEV_ROOT_PATH}/core/ui/AnimationLibrary.h
+	${DEV_ROOT_PATH}/core/ui/AnimationSet.h
+	${DEV_ROOT_PATH}/core/ui/AnimationClock.h
+	${DEV_ROOT_PATH}/core/ui/AnimationKernel.h
+	${DEV_ROOT_PATH}/core/ui/AnimationSystem.h
+	${DEV_ROOT_PATH}/core/ui/SpriteBatch.h
+	${DEV_ROOT_PATH}/core/ui/SpritePool.h
+	${DEV_ROOT_PATH}/core/ui/SpatialGrid.h
+	${DEV_ROOT_PATH}/core/ui/TextureCache.h
+	${DEV_ROOT_PATH}/core/ui/TextureDiskCache.h
 )
 
 set(ACTUAL_DIRS
@@ -0,0 +1,82 @@
+/*
+ * FrameTable.cpp
+ *
+ *  Created on: Mar 19, 2013
+ *      Author: agustin
+ */
+
+#include "FrameTable.h"
+
+#include <debug/DebugUtil.h>
+#include <memory/MemoryTracker.h>
+
+
+namespace ui {
+
+FrameTable::TableMap FrameTable::sTables;
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+FrameTable::Key::operator<(const Key &o) const
+{
+    if (numColumns != o.numColumns) return numColumns < o.numColumns;
+    if (numRows != o.numRows) return numRows < o.numRows;
+    if (cellWidth != o.cellWidth) return cellWidth < o.cellWidth;
+    return cellHeight < o.cellHeight;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+FrameTable::Ptr
+FrameTable::find(const Key &key)
+{
+    TableMap::iterator it = sTables.find(key);
+    if (it == sTables.end()) {
+        return Ptr();
+    }
+    Ptr table = it->second.lock();
+    if (table.get() == 0) {
+        // nobody is using it anymore
+        sTables.erase(it);
+    }
+    return table;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+FrameTable::Ptr
+FrameTable::add(const Key &key, FrameTable *table)
+{
+    Ptr result(table);
+    sTables[key] = result;
+    return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+FrameTable::Ptr
+FrameTable::grid(std::size_t numColumns,
+                 std::size_t numRows,
+                 int cellWidth,
+                 int cellHeight)
+{
+    MEMORY_TAG_SCOPE(ANIMATION);
+    ASSERT(numColumns > 0 && numRows > 0);
+
+    const Key key = {numColumns, numRows, cellWidth, cellHeight};
+    Ptr table = find(key);
+    if (table.get() != 0) {
+        return table;
+    }
+
+    FrameTable *result = new FrameTable;
+    result->mRects.reserve(numColumns * numRows);
+    for (std::size_t row = 0; row < numRows; ++row) {
+        for (std::size_t col = 0; col < numColumns; ++col) {
+            result->mRects.push_back(sf::IntRect(col * cellWidth,
+                                                 row * cellHeight,
+                                                 cellWidth,
+                                                 cellHeight));
+        }
+    }
+    return add(key, result);
+}
+
+} /* namespace ui */
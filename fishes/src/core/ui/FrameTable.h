@@ -0,0 +1,148 @@
+/*
+ * FrameTable.h
+ *
+ *  Created on: Mar 19, 2013
+ *      Author: agustin
+ */
+
+#ifndef FRAMETABLE_H_
+#define FRAMETABLE_H_
+
+#include <map>
+#include <vector>
+#include <cstddef>
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+
+#include <SFML/Graphics/Rect.hpp>
+
+
+namespace ui {
+
+// @brief Compile time layout of a sheet with a fixed number of columns and
+// rows. The divisions are by constants so they are resolved by the compiler
+// (constexpr) or turned into multiplications.
+//
+template<std::size_t COLUMNS, std::size_t ROWS>
+struct GridLayout {
+    static_assert(COLUMNS > 0 && ROWS > 0, "Invalid number of columns / rows");
+
+    static constexpr std::size_t NUM_FRAMES = COLUMNS * ROWS;
+
+    static constexpr std::size_t column(std::size_t index)
+    {
+        return index % COLUMNS;
+    }
+    static constexpr std::size_t row(std::size_t index)
+    {
+        return index / COLUMNS;
+    }
+};
+
+// @brief Immutable table with the texture rectangle of every frame of a
+// sheet, computed once and shared by all the sprites using a sheet with the
+// same layout (a frame change is then only one indexed load).
+// The frames are ordered like this:
+// 0    1   2   3
+// 4    5   6   7 ...
+// The tables are cached (while someone use them) by layout.
+// This class is not thread safe, it should be used from the main thread.
+//
+class FrameTable
+{
+public:
+    typedef boost::shared_ptr<const FrameTable> Ptr;
+
+public:
+    // @brief Get the table of a uniform grid.
+    // @param   numColumns  The number of columns
+    // @param   numRows     The number of rows
+    // @param   cellWidth   The width of each frame
+    // @param   cellHeight  The height of each frame
+    static Ptr grid(std::size_t numColumns,
+                    std::size_t numRows,
+                    int cellWidth,
+                    int cellHeight);
+
+    // @brief Same as above for a number of columns and rows fixed at compile
+    // time.
+    template<std::size_t COLUMNS, std::size_t ROWS>
+    static Ptr grid(int cellWidth, int cellHeight);
+
+    // @brief Returns the rectangle of a frame / all the rectangles
+    inline const sf::IntRect &operator[](std::size_t index) const;
+    inline const sf::IntRect *data(void) const;
+
+    // @brief Returns the number of frames
+    inline std::size_t size(void) const;
+
+private:
+    struct Key {
+        std::size_t numColumns;
+        std::size_t numRows;
+        int cellWidth;
+        int cellHeight;
+
+        bool operator<(const Key &o) const;
+    };
+    typedef std::map<Key, boost::weak_ptr<const FrameTable> > TableMap;
+
+    FrameTable() {};
+
+    // @brief Find a table already created / register a new one
+    static Ptr find(const Key &key);
+    static Ptr add(const Key &key, FrameTable *table);
+
+private:
+    static TableMap sTables;
+
+    std::vector<sf::IntRect> mRects;
+};
+
+
+// Inline implementations
+//
+
+template<std::size_t COLUMNS, std::size_t ROWS>
+FrameTable::Ptr
+FrameTable::grid(int cellWidth, int cellHeight)
+{
+    typedef GridLayout<COLUMNS, ROWS> Layout;
+
+    const Key key = {COLUMNS, ROWS, cellWidth, cellHeight};
+    Ptr table = find(key);
+    if (table.get() != 0) {
+        return table;
+    }
+
+    FrameTable *result = new FrameTable;
+    result->mRects.resize(Layout::NUM_FRAMES);
+    for (std::size_t i = 0; i < Layout::NUM_FRAMES; ++i) {
+        result->mRects[i] = sf::IntRect(Layout::column(i) * cellWidth,
+                                        Layout::row(i) * cellHeight,
+                                        cellWidth,
+                                        cellHeight);
+    }
+    return add(key, result);
+}
+
+inline const sf::IntRect &
+FrameTable::operator[](std::size_t index) const
+{
+    return mRects[index];
+}
+
+inline const sf::IntRect *
+FrameTable::data(void) const
+{
+    return mRects.data();
+}
+
+inline std::size_t
+FrameTable::size(void) const
+{
+    return mRects.size();
+}
+
+} /* namespace ui */
+#endif /* FRAMETABLE_H_ */
@@ -0,0 +1,78 @@
+/*
+ * HotReloader.cpp
+ *
+ *  Created on: Apr 21, 2013
+ *      Author: agustin
+ */
+
+#include "HotReloader.h"
+
+#include <FileManager.h>
+#include <debug/DebugUtil.h>
+#include <debug/Profiler.h>
+
+#include "TextureCache.h"
+#include "AnimationSet.h"
+
+
+namespace ui {
+
+////////////////////////////////////////////////////////////////////////////////
+HotReloader::HotReloader()
+{
+    mStats.batches = 0;
+    mStats.textures = 0;
+    mStats.libraries = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+HotReloader::~HotReloader()
+{
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+HotReloader::watch(const std::string &folder)
+{
+    if (!FileManager::getInstance()->watchFolder(folder)) {
+        debugWARNING("The assets of %s will not be reloaded\n", folder.c_str());
+        return false;
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t
+HotReloader::update(void)
+{
+    if (!FileManager::getInstance()->pollChanges(mChanged)) {
+        return 0;
+    }
+    PROFILE_FUNCTION();
+    ++mStats.batches;
+
+    // the textures first, a reloaded library could use them
+    std::size_t count = 0;
+    TextureCache *cache = TextureCache::getInstance();
+    for (std::size_t i = 0; i < mChanged.size(); ++i) {
+        TextureHandle texture = cache->reload(mChanged[i]);
+        if (texture.get() != 0) {
+            AnimationSet::onTextureReloaded(texture);
+            debugCAT(UI, debug, "Texture reloaded: %s\n", mChanged[i].c_str());
+            ++mStats.textures;
+            ++count;
+        }
+    }
+    for (std::size_t i = 0; i < mChanged.size(); ++i) {
+        if (AnimationSet::reloadLibrary(mChanged[i]) > 0) {
+            debugCAT(UI, debug, "Animation library reloaded: %s\n",
+                     mChanged[i].c_str());
+            ++mStats.libraries;
+            ++count;
+        }
+    }
+    return count;
+}
+
+} /* namespace ui */
@@ -0,0 +1,72 @@
+/*
+ * HotReloader.h
+ *
+ *  Created on: Apr 21, 2013
+ *      Author: agustin
+ */
+
+#ifndef HOTRELOADER_H_
+#define HOTRELOADER_H_
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+
+namespace ui {
+
+// @brief Reloads the assets edited while the game is running. The asset
+// folders are watched with the FileManager (inotify, debounced) and each
+// batch of changed files is applied at once from update(), that should be
+// called between frames (before updating the sprites):
+//  - the loaded textures are uploaded again into the same sf::Texture (see
+//    TextureCache::reload()) and the grid layouts of them are updated.
+//  - the sets of the loaded animation libraries are moved to the new tables.
+// The sprites and AnimationSystems using them are not rebuilt, they take the
+// new frames in their next update (see AnimationSet::revision()).
+// The files that are not loaded are ignored. This class is not thread safe,
+// it should be used from the main thread.
+//
+class HotReloader
+{
+public:
+    struct Stats {
+        std::size_t batches;
+        std::size_t textures;
+        std::size_t libraries;
+    };
+
+public:
+    HotReloader();
+    ~HotReloader();
+
+    // @brief Watch a folder tree of assets
+    // @param   folder  The folder (loose files, the archives are not watched)
+    // @returns true on success, false otherwise
+    bool watch(const std::string &folder);
+
+    // @brief Apply the last batch of changes (if any)
+    // @returns the number of textures and libraries reloaded
+    std::size_t update(void);
+
+    // @brief Stats functions
+    inline const Stats &stats(void) const;
+
+private:
+    // the files of the last batch
+    std::vector<std::string> mChanged;
+    Stats mStats;
+};
+
+
+// Inline implementations
+//
+
+inline const HotReloader::Stats &
+HotReloader::stats(void) const
+{
+    return mStats;
+}
+
+} /* namespace ui */
+#endif /* HOTRELOADER_H_ */
@@ -0,0 +1,257 @@
+/*
+ * SpatialGrid.cpp
+ *
+ *  Created on: Apr 11, 2013
+ *      Author: agustin
+ */
+
+#include "SpatialGrid.h"
+
+#include <cmath>
+#include <algorithm>
+
+#include <debug/DebugUtil.h>
+#include <memory/MemoryTracker.h>
+
+
+// auxiliar functions
+namespace {
+// Check if two rectangles overlap (touching borders is not overlapping, same
+// than sf::Rect::intersects())
+inline bool
+overlap(const sf::FloatRect &a, const sf::FloatRect &b)
+{
+    return a.left < b.left + b.width && b.left < a.left + a.width &&
+        a.top < b.top + b.height && b.top < a.top + a.height;
+}
+}
+
+namespace ui {
+
+////////////////////////////////////////////////////////////////////////////////
+SpatialGrid::CellRange
+SpatialGrid::cellsOf(const sf::FloatRect &rect) const
+{
+    CellRange cells;
+    cells.x0 = static_cast<int>(std::floor(rect.left * mInvCellSize));
+    cells.y0 = static_cast<int>(std::floor(rect.top * mInvCellSize));
+    cells.x1 = static_cast<int>(std::floor((rect.left + rect.width) *
+                                           mInvCellSize));
+    cells.y1 = static_cast<int>(std::floor((rect.top + rect.height) *
+                                           mInvCellSize));
+    return cells;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+SpatialGrid::link(std::uint32_t id, const CellRange &cells)
+{
+    for (int y = cells.y0; y <= cells.y1; ++y) {
+        for (int x = cells.x0; x <= cells.x1; ++x) {
+            mCells[cellKey(x, y)].push_back(id);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+SpatialGrid::unlink(std::uint32_t id, const CellRange &cells)
+{
+    for (int y = cells.y0; y <= cells.y1; ++y) {
+        for (int x = cells.x0; x <= cells.x1; ++x) {
+            CellMap::iterator it = mCells.find(cellKey(x, y));
+            ASSERT(it != mCells.end());
+            Cell &cell = it->second;
+            Cell::iterator pos = std::find(cell.begin(), cell.end(), id);
+            ASSERT(pos != cell.end());
+            // the order of the cell doesn't matter
+            *pos = cell.back();
+            cell.pop_back();
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+SpatialGrid::refresh(std::uint32_t id)
+{
+    Entry &entry = mEntries[id];
+    entry.bounds = entry.sprite->getGlobalBounds();
+    const CellRange cells = cellsOf(entry.bounds);
+    if (cells == entry.cells) {
+        return;
+    }
+    unlink(id, entry.cells);
+    link(id, cells);
+    entry.cells = cells;
+    ++mStats.cellChanges;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+SpatialGrid::SpatialGrid(float cellSize) :
+    mCellSize(cellSize)
+,   mInvCellSize(1.f / cellSize)
+,   mQueryMark(0)
+{
+    ASSERT(cellSize > 0.f);
+    resetStats();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+SpatialGrid::~SpatialGrid()
+{
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+SpatialGrid::add(sf::Sprite &sprite)
+{
+    MEMORY_TAG_SCOPE(UI);
+    if (mIndex.find(&sprite) != mIndex.end()) {
+        debugCAT(UI, debugWARNING, "Sprite already in the grid\n");
+        return false;
+    }
+
+    std::uint32_t id;
+    if (!mFreeEntries.empty()) {
+        id = mFreeEntries.back();
+        mFreeEntries.pop_back();
+    } else {
+        id = mEntries.size();
+        mEntries.push_back(Entry());
+    }
+
+    Entry &entry = mEntries[id];
+    entry.sprite = &sprite;
+    entry.bounds = sprite.getGlobalBounds();
+    entry.cells = cellsOf(entry.bounds);
+    entry.mark = mQueryMark;
+    link(id, entry.cells);
+    mIndex[&sprite] = id;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+SpatialGrid::remove(const sf::Sprite &sprite)
+{
+    IndexMap::iterator it = mIndex.find(&sprite);
+    if (it == mIndex.end()) {
+        debugCAT(UI, debugWARNING,
+                 "Trying to remove a sprite that is not in the grid\n");
+        return;
+    }
+    const std::uint32_t id = it->second;
+    unlink(id, mEntries[id].cells);
+    mEntries[id].sprite = 0;
+    mFreeEntries.push_back(id);
+    mIndex.erase(it);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+SpatialGrid::clear(void)
+{
+    mEntries.clear();
+    mFreeEntries.clear();
+    mIndex.clear();
+    mCells.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+SpatialGrid::update(const sf::Sprite &sprite)
+{
+    MEMORY_TAG_SCOPE(UI);
+    IndexMap::const_iterator it = mIndex.find(&sprite);
+    if (it == mIndex.end()) {
+        debugCAT(UI, debugWARNING,
+                 "Trying to update a sprite that is not in the grid\n");
+        return;
+    }
+    refresh(it->second);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+SpatialGrid::updateAll(void)
+{
+    for (std::size_t i = 0, size = mEntries.size(); i < size; ++i) {
+        if (mEntries[i].sprite != 0) {
+            refresh(i);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t
+SpatialGrid::query(const sf::FloatRect &rect,
+                   std::vector<sf::Sprite *> &result) const
+{
+    result.clear();
+    ++mStats.queries;
+
+    // a new mark for this query, when it wraps reset all the entries so an
+    // old mark is not taken as the current one
+    if (++mQueryMark == 0) {
+        for (std::size_t i = 0; i < mEntries.size(); ++i) {
+            mEntries[i].mark = 0;
+        }
+        mQueryMark = 1;
+    }
+
+    const CellRange cells = cellsOf(rect);
+    for (int y = cells.y0; y <= cells.y1; ++y) {
+        for (int x = cells.x0; x <= cells.x1; ++x) {
+            CellMap::const_iterator it = mCells.find(cellKey(x, y));
+            if (it == mCells.end()) {
+                continue;
+            }
+            const Cell &cell = it->second;
+            for (std::size_t i = 0, size = cell.size(); i < size; ++i) {
+                const Entry &entry = mEntries[cell[i]];
+                if (entry.mark == mQueryMark) {
+                    continue;
+                }
+                entry.mark = mQueryMark;
+                ++mStats.tested;
+                if (overlap(entry.bounds, rect)) {
+                    result.push_back(entry.sprite);
+                } else {
+                    ++mStats.culled;
+                }
+            }
+        }
+    }
+    mStats.drawn += result.size();
+    return result.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+sf::FloatRect
+SpatialGrid::viewRect(const sf::View &view)
+{
+    const sf::Vector2f &center = view.getCenter();
+    const sf::Vector2f &size = view.getSize();
+    return sf::FloatRect(center.x - size.x * 0.5f,
+                         center.y - size.y * 0.5f,
+                         size.x,
+                         size.y);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+SpatialGrid::resetStats(void)
+{
+    mStats.queries = 0;
+    mStats.tested = 0;
+    mStats.culled = 0;
+    mStats.drawn = 0;
+    mStats.cellChanges = 0;
+}
+
+} /* namespace ui */
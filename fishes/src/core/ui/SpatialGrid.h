@@ -0,0 +1,181 @@
+/*
+ * SpatialGrid.h
+ *
+ *  Created on: Apr 11, 2013
+ *      Author: agustin
+ */
+
+#ifndef SPATIALGRID_H_
+#define SPATIALGRID_H_
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+#include <SFML/Graphics/Sprite.hpp>
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/Graphics/View.hpp>
+
+
+namespace ui {
+
+// @brief Uniform grid of square cells indexing the sprites by its global
+// bounds, used to know which sprites are inside the view (culling) without
+// testing all of them: a query only visits the cells that overlap the
+// rectangle, so it costs O(visible sprites).
+// The grid is not bounded (the cells are hashed) so the tank can be of any
+// size. A sprite that overlaps several cells is in all of them.
+// sf::Sprite::setPosition() can't notify us, so update() must be called after
+// moving (rotating, scaling) a sprite; it only touches the cells if the
+// sprite changed of cells.
+// The sprites are not owned by the grid, they should live (and not be moved
+// in memory) while they are in.
+//
+class SpatialGrid
+{
+public:
+    // the counters of the grid
+    struct Stats {
+        std::size_t queries;
+        // sprites of the cells visited whose bounds were checked
+        std::size_t tested;
+        // tested but outside the rectangle
+        std::size_t culled;
+        // inside the rectangle (returned)
+        std::size_t drawn;
+        // updates that changed the cells of a sprite
+        std::size_t cellChanges;
+    };
+
+public:
+    // @param   cellSize    The size of the cells (in world units), something
+    //                      like 2-4 times the size of the common sprites
+    SpatialGrid(float cellSize = 256.f);
+    ~SpatialGrid();
+
+    // @brief Add / remove a sprite to the grid
+    // @param   sprite  The sprite
+    // @returns false if the sprite was already in the grid (add)
+    bool add(sf::Sprite &sprite);
+    void remove(const sf::Sprite &sprite);
+
+    // @brief Remove all the sprites
+    void clear(void);
+
+    // @brief Update the cells of a sprite (after moving it)
+    // @param   sprite  The sprite (already in the grid)
+    void update(const sf::Sprite &sprite);
+
+    // @brief Update all the sprites of the grid, for when most of them
+    // moved (O(N), only the ones that changed of cells are reinserted)
+    void updateAll(void);
+
+    // @brief Get the sprites whose bounds intersect a rectangle. Each sprite
+    // is returned once (even if it is in many of the visited cells), in no
+    // particular order.
+    // @param   rect    The rectangle (i.e. viewRect(window.getView()))
+    // @param   result  Where the sprites are put (cleared first)
+    // @returns the number of sprites found
+    std::size_t query(const sf::FloatRect &rect,
+                      std::vector<sf::Sprite *> &result) const;
+
+    // @brief Returns the rectangle of the world seen through a view (the
+    // rotation of the view is not taken into account)
+    static sf::FloatRect viewRect(const sf::View &view);
+
+    // @brief Returns the number of sprites / the size of the cells
+    inline std::size_t size(void) const;
+    inline float cellSize(void) const;
+
+    // @brief Stats functions
+    inline const Stats &stats(void) const;
+    void resetStats(void);
+
+private:
+    // avoid copying
+    SpatialGrid(const SpatialGrid &);
+    SpatialGrid &operator=(const SpatialGrid &);
+
+    // The cells covered by a rectangle [x0, x1] x [y0, y1]
+    struct CellRange {
+        int x0, y0, x1, y1;
+
+        inline bool operator==(const CellRange &o) const;
+    };
+
+    struct Entry {
+        sf::Sprite *sprite;
+        sf::FloatRect bounds;
+        CellRange cells;
+        // the last query that visited the entry (to return it only once)
+        mutable std::uint32_t mark;
+    };
+
+    typedef std::vector<std::uint32_t> Cell;
+    typedef std::unordered_map<std::uint64_t, Cell> CellMap;
+    typedef std::unordered_map<const sf::Sprite *, std::uint32_t> IndexMap;
+
+    // @brief Returns the cells covered by a rectangle
+    CellRange cellsOf(const sf::FloatRect &rect) const;
+
+    // @brief Returns the key of the cell (x, y)
+    static inline std::uint64_t cellKey(int x, int y);
+
+    // @brief Put / take an entry into / out of the cells of a range
+    void link(std::uint32_t id, const CellRange &cells);
+    void unlink(std::uint32_t id, const CellRange &cells);
+
+    // @brief Update the bounds of the entry and its cells if needed
+    void refresh(std::uint32_t id);
+
+private:
+    float mCellSize;
+    float mInvCellSize;
+    std::vector<Entry> mEntries;
+    std::vector<std::uint32_t> mFreeEntries;
+    IndexMap mIndex;
+    // the cells are never erased (only emptied) to avoid reallocating them
+    // when the sprites go back and forth
+    CellMap mCells;
+    mutable std::uint32_t mQueryMark;
+    mutable Stats mStats;
+};
+
+
+// Inline implementations
+//
+
+inline bool
+SpatialGrid::CellRange::operator==(const CellRange &o) const
+{
+    return x0 == o.x0 && y0 == o.y0 && x1 == o.x1 && y1 == o.y1;
+}
+
+inline std::uint64_t
+SpatialGrid::cellKey(int x, int y)
+{
+    return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(x)) << 32) |
+        static_cast<std::uint32_t>(y);
+}
+
+inline std::size_t
+SpatialGrid::size(void) const
+{
+    return mIndex.size();
+}
+
+inline float
+SpatialGrid::cellSize(void) const
+{
+    return mCellSize;
+}
+
+inline const SpatialGrid::Stats &
+SpatialGrid::stats(void) const
+{
+    return mStats;
+}
+
+} /* namespace ui */
+#endif /* SPATIALGRID_H_ */
@@ -0,0 +1,189 @@
+/*
+ * SpriteBatch.cpp
+ *
+ *  Created on: Mar 9, 2013
+ *      Author: agustin
+ */
+
+#include "SpriteBatch.h"
+
+#include <cmath>
+#include <cstring>
+
+#include <SFML/Graphics/RenderTarget.hpp>
+#include <SFML/Graphics/Transform.hpp>
+
+#include <debug/DebugUtil.h>
+
+
+// auxiliar functions
+namespace {
+// The indices of the 2D affine part of the sf::Transform 4x4 matrix
+const std::size_t MATRIX_INDICES[6] = {0, 1, 4, 5, 12, 13};
+}
+
+namespace ui {
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+SpriteBatch::refreshEntry(Entry &entry) const
+{
+    const sf::Sprite &sprite = *entry.sprite;
+    const float *matrix = sprite.getTransform().getMatrix();
+    float current[6];
+    for (std::size_t i = 0; i < 6; ++i) {
+        current[i] = matrix[MATRIX_INDICES[i]];
+    }
+
+    if (std::memcmp(current, entry.matrix, sizeof(current)) == 0 &&
+        sprite.getTextureRect() == entry.rect &&
+        sprite.getColor() == entry.color) {
+        return false;
+    }
+
+    std::memcpy(entry.matrix, current, sizeof(current));
+    entry.rect = sprite.getTextureRect();
+    entry.color = sprite.getColor();
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+SpriteBatch::writeVertices(std::size_t i) const
+{
+    ASSERT(i < mEntries.size());
+    const Entry &entry = mEntries[i];
+    const sf::Transform &transform = entry.sprite->getTransform();
+
+    // same geometry than the sf::Sprite
+    const float width = static_cast<float>(std::abs(entry.rect.width));
+    const float height = static_cast<float>(std::abs(entry.rect.height));
+    const float left = static_cast<float>(entry.rect.left);
+    const float right = left + entry.rect.width;
+    const float top = static_cast<float>(entry.rect.top);
+    const float bottom = top + entry.rect.height;
+
+    sf::Vertex *quad = &mVertices[i * 4];
+    quad[0].position = transform.transformPoint(0.f, 0.f);
+    quad[1].position = transform.transformPoint(0.f, height);
+    quad[2].position = transform.transformPoint(width, height);
+    quad[3].position = transform.transformPoint(width, 0.f);
+    quad[0].texCoords = sf::Vector2f(left, top);
+    quad[1].texCoords = sf::Vector2f(left, bottom);
+    quad[2].texCoords = sf::Vector2f(right, bottom);
+    quad[3].texCoords = sf::Vector2f(right, top);
+    quad[0].color = entry.color;
+    quad[1].color = entry.color;
+    quad[2].color = entry.color;
+    quad[3].color = entry.color;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+SpriteBatch::draw(sf::RenderTarget &target, sf::RenderStates states) const
+{
+    if (mEntries.empty()) {
+        return;
+    }
+    updateVertices();
+
+    states.texture = mTexture;
+    target.draw(mVertices, states);
+    ++mStats.drawCalls;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+SpriteBatch::SpriteBatch() :
+    mTexture(0)
+,   mVertices(sf::Quads)
+{
+    resetStats();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+SpriteBatch::~SpriteBatch()
+{
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+SpriteBatch::add(const sf::Sprite &sprite)
+{
+    if (mTexture == 0) {
+        mTexture = sprite.getTexture();
+    } else if (sprite.getTexture() != mTexture) {
+        debugERROR("The sprite has a different texture than the batch\n");
+        return false;
+    }
+
+    Entry entry;
+    entry.sprite = &sprite;
+    refreshEntry(entry);
+    mEntries.push_back(entry);
+    mVertices.resize(mEntries.size() * 4);
+    writeVertices(mEntries.size() - 1);
+    mStats.verticesWritten += 4;
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+SpriteBatch::remove(const sf::Sprite &sprite)
+{
+    for (std::size_t i = 0, size = mEntries.size(); i < size; ++i) {
+        if (mEntries[i].sprite != &sprite) {
+            continue;
+        }
+        // put the last one here
+        const std::size_t last = size - 1;
+        if (i != last) {
+            mEntries[i] = mEntries[last];
+            for (std::size_t v = 0; v < 4; ++v) {
+                mVertices[i * 4 + v] = mVertices[last * 4 + v];
+            }
+        }
+        mEntries.pop_back();
+        mVertices.resize(mEntries.size() * 4);
+        return;
+    }
+    debugWARNING("Trying to remove a sprite that is not in the batch\n");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+SpriteBatch::clear(void)
+{
+    mTexture = 0;
+    mEntries.clear();
+    mVertices.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+SpriteBatch::updateVertices(void) const
+{
+    for (std::size_t i = 0, size = mEntries.size(); i < size; ++i) {
+        if (refreshEntry(mEntries[i])) {
+            writeVertices(i);
+            mStats.verticesWritten += 4;
+        } else {
+            mStats.verticesReused += 4;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+SpriteBatch::resetStats(void)
+{
+    mStats.drawCalls = 0;
+    mStats.verticesWritten = 0;
+    mStats.verticesReused = 0;
+}
+
+} /* namespace ui */
@@ -0,0 +1,135 @@
+/*
+ * SpriteBatch.h
+ *
+ *  Created on: Mar 9, 2013
+ *      Author: agustin
+ */
+
+#ifndef SPRITEBATCH_H_
+#define SPRITEBATCH_H_
+
+#include <vector>
+#include <cstddef>
+
+#include <SFML/Graphics/Drawable.hpp>
+#include <SFML/Graphics/VertexArray.hpp>
+#include <SFML/Graphics/Sprite.hpp>
+#include <SFML/Graphics/Texture.hpp>
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/Graphics/Color.hpp>
+
+
+namespace ui {
+
+// @brief The SpriteBatch collects a lot of sprites sharing the same texture
+// and draw all of them with only one draw call (one sf::VertexArray of quads).
+// Only the vertices of the sprites that changed (moved, changed its frame or
+// color) since the last update are rewritten.
+// The vertices are generated in the cpu so updateVertices() can be used
+// without a window (for benchmarks and checks).
+// The sprites are not owned by the batch, they should live while they are in.
+//
+class SpriteBatch : public sf::Drawable
+{
+public:
+    // the counters of the batch
+    struct Stats {
+        std::size_t drawCalls;
+        std::size_t verticesWritten;
+        std::size_t verticesReused;
+    };
+
+public:
+    SpriteBatch();
+    ~SpriteBatch();
+
+    // @brief Add a sprite to the batch. All the sprites of the batch must have
+    // the same texture (the first one added set the texture of the batch).
+    // The sprites are drawn in the same order they were added.
+    // @param   sprite  The sprite to add
+    // @returns true on success, false if the sprite has other texture.
+    bool add(const sf::Sprite &sprite);
+
+    // @brief Remove a sprite from the batch (O(N)), the last sprite added
+    // takes its place in the draw order.
+    // @param   sprite  The sprite to remove
+    void remove(const sf::Sprite &sprite);
+
+    // @brief Remove all the sprites (and the texture) of the batch
+    void clear(void);
+
+    // @brief Returns the number of sprites / texture of the batch
+    inline std::size_t size(void) const;
+    inline const sf::Texture *texture(void) const;
+
+    // @brief Rewrite the vertices of the sprites that changed since the last
+    // call. This is called automatically when the batch is drawn.
+    // The vertices are a cache of the sprites, that's why this is const.
+    void updateVertices(void) const;
+
+    // @brief Returns the vertices (4 per sprite, quads)
+    inline const sf::VertexArray &vertices(void) const;
+
+    // @brief Stats functions
+    inline const Stats &stats(void) const;
+    void resetStats(void);
+
+protected:
+    // @brief Inherited from sf::Drawable, draw all the sprites at once
+    virtual void draw(sf::RenderTarget &target, sf::RenderStates states) const;
+
+private:
+    // the state used to generate the vertices of a sprite the last time, used
+    // to check if we have to rewrite them
+    struct Entry {
+        const sf::Sprite *sprite;
+        float matrix[6];
+        sf::IntRect rect;
+        sf::Color color;
+    };
+
+    // @brief Check if the entry is up to date with its sprite, if not the
+    // entry is updated
+    // @returns true if the entry changed
+    bool refreshEntry(Entry &entry) const;
+
+    // @brief Write the 4 vertices of the entry i
+    void writeVertices(std::size_t i) const;
+
+private:
+    const sf::Texture *mTexture;
+    mutable std::vector<Entry> mEntries;
+    mutable sf::VertexArray mVertices;
+    mutable Stats mStats;
+};
+
+
+// Inline implementations
+//
+
+inline std::size_t
+SpriteBatch::size(void) const
+{
+    return mEntries.size();
+}
+
+inline const sf::Texture *
+SpriteBatch::texture(void) const
+{
+    return mTexture;
+}
+
+inline const sf::VertexArray &
+SpriteBatch::vertices(void) const
+{
+    return mVertices;
+}
+
+inline const SpriteBatch::Stats &
+SpriteBatch::stats(void) const
+{
+    return mStats;
+}
+
+} /* namespace ui */
+#endif /* SPRITEBATCH_H_ */
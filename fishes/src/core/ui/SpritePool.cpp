@@ -0,0 +1,121 @@
+/*
+ * SpritePool.cpp
+ *
+ *  Created on: Apr 9, 2013
+ *      Author: agustin
+ */
+
+#include "SpritePool.h"
+
+#include <utility>
+
+#include <debug/DebugUtil.h>
+#include <memory/MemoryTracker.h>
+
+
+namespace ui {
+
+const SpritePool::Handle SpritePool::INVALID_HANDLE = {0xFFFFFFFFu, 0u};
+
+////////////////////////////////////////////////////////////////////////////////
+SpritePool::SpritePool(std::size_t capacity) :
+    mSprites(capacity)
+,   mDenseToSlot(capacity)
+,   mSize(0)
+,   mSlotToDense(capacity)
+,   mGenerations(capacity, 0u)
+{
+    ASSERT(capacity < INVALID_HANDLE.index);
+
+    // the free slots are taken from the back, use the first ones first
+    mFreeSlots.reserve(capacity);
+    for (std::size_t i = capacity; i > 0; --i) {
+        mFreeSlots.push_back(i - 1);
+    }
+    resetStats();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+SpritePool::~SpritePool()
+{
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+SpritePool::Handle
+SpritePool::spawn(void)
+{
+    MEMORY_TAG_SCOPE(UI);
+    if (mFreeSlots.empty()) {
+        ++mStats.failedSpawns;
+        return INVALID_HANDLE;
+    }
+
+    const std::uint32_t slot = mFreeSlots.back();
+    mFreeSlots.pop_back();
+
+    // the generation of the live slots is odd, the free ones even
+    ++mGenerations[slot];
+    ASSERT(mGenerations[slot] & 1u);
+
+    const std::size_t dense = mSize++;
+    mSlotToDense[slot] = dense;
+    mDenseToSlot[dense] = slot;
+    ++mStats.spawned;
+
+    const Handle handle = {slot, mGenerations[slot]};
+    return handle;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+SpritePool::Handle
+SpritePool::spawn(const AnimationSet::Ptr &set)
+{
+    const Handle handle = spawn();
+    if (handle != INVALID_HANDLE && !get(handle)->build(set)) {
+        despawn(handle);
+        return INVALID_HANDLE;
+    }
+    return handle;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+SpritePool::despawn(Handle handle)
+{
+    if (!isValid(handle)) {
+        debugCAT(UI, debugWARNING, "Trying to despawn an invalid handle\n");
+        return false;
+    }
+
+    const std::uint32_t slot = handle.index;
+    const std::size_t dense = mSlotToDense[slot];
+    const std::size_t last = --mSize;
+
+    // keep the sprites packed: the last one takes the hole (keeping its place
+    // in its AnimationSystem) and its old position is reset (so the released
+    // sprite is out of any system and doesn't reference its set)
+    if (dense != last) {
+        mSprites[dense] = std::move(mSprites[last]);
+        const std::uint32_t lastSlot = mDenseToSlot[last];
+        mDenseToSlot[dense] = lastSlot;
+        mSlotToDense[lastSlot] = dense;
+    }
+    mSprites[last] = AnimatedSprite();
+
+    ++mGenerations[slot];
+    mFreeSlots.push_back(slot);
+    ++mStats.despawned;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+SpritePool::resetStats(void)
+{
+    mStats.spawned = 0;
+    mStats.despawned = 0;
+    mStats.failedSpawns = 0;
+}
+
+} /* namespace ui */
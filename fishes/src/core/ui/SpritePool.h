@@ -0,0 +1,180 @@
+/*
+ * SpritePool.h
+ *
+ *  Created on: Apr 9, 2013
+ *      Author: agustin
+ */
+
+#ifndef SPRITEPOOL_H_
+#define SPRITEPOOL_H_
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "AnimatedSprite.h"
+
+
+namespace ui {
+
+// @brief Fixed capacity storage for the AnimatedSprites that are created and
+// destroyed all the time (i.e. the fishes of a school). All the memory is
+// allocated in the constructor, spawn / despawn are O(1) and never call the
+// allocator.
+// The live sprites are always packed at the beginning of the storage
+// (sprites()[0, size())) so iterating them is cache friendly. Because of this
+// a sprite can be moved when other one is despawned (it keeps its place in
+// its AnimationSystem), so the sprites must be referenced with the Handles
+// (an index + a generation that detects the despawned sprites) and not with
+// pointers.
+//
+class SpritePool
+{
+public:
+    struct Handle {
+        std::uint32_t index;
+        std::uint32_t generation;
+
+        inline bool operator==(const Handle &o) const;
+        inline bool operator!=(const Handle &o) const;
+    };
+
+    // The handle that never references a sprite
+    static const Handle INVALID_HANDLE;
+
+    struct Stats {
+        std::size_t spawned;
+        std::size_t despawned;
+        std::size_t failedSpawns;
+    };
+
+public:
+    // @param   capacity    The max number of sprites
+    SpritePool(std::size_t capacity);
+    ~SpritePool();
+
+    // @brief Get a new sprite (empty, or built from an AnimationSet)
+    // @returns the handle or INVALID_HANDLE if the pool is full
+    Handle spawn(void);
+    Handle spawn(const AnimationSet::Ptr &set);
+
+    // @brief Release a sprite (it is removed from its AnimationSystem).
+    // The handle (and all its copies) become invalid.
+    // @returns false if the handle was already invalid
+    bool despawn(Handle handle);
+
+    // @brief Check if a handle references a live sprite
+    inline bool isValid(Handle handle) const;
+
+    // @brief Returns the sprite of a handle, or 0 if the handle is invalid.
+    // The pointer is valid until the next despawn().
+    inline AnimatedSprite *get(Handle handle);
+    inline const AnimatedSprite *get(Handle handle) const;
+
+    // @brief Returns the handle of the i-th live sprite
+    inline Handle handleOf(std::size_t i) const;
+
+    // @brief The live sprites, packed: sprites()[0, size())
+    inline AnimatedSprite *sprites(void);
+    inline const AnimatedSprite *sprites(void) const;
+    inline std::size_t size(void) const;
+    inline std::size_t capacity(void) const;
+
+    // @brief Stats functions
+    inline const Stats &stats(void) const;
+    void resetStats(void);
+
+private:
+    // avoid copying
+    SpritePool(const SpritePool &);
+    SpritePool &operator=(const SpritePool &);
+
+private:
+    // the packed sprites
+    std::vector<AnimatedSprite> mSprites;
+    std::vector<std::uint32_t> mDenseToSlot;
+    std::size_t mSize;
+
+    // the slots referenced by the handles
+    std::vector<std::uint32_t> mSlotToDense;
+    std::vector<std::uint32_t> mGenerations;
+    std::vector<std::uint32_t> mFreeSlots;
+
+    Stats mStats;
+};
+
+
+// Inline implementations
+//
+
+inline bool
+SpritePool::Handle::operator==(const Handle &o) const
+{
+    return index == o.index && generation == o.generation;
+}
+inline bool
+SpritePool::Handle::operator!=(const Handle &o) const
+{
+    return !(*this == o);
+}
+
+inline bool
+SpritePool::isValid(Handle handle) const
+{
+    // the live slots have odd generations, the free ones (and a handle
+    // never spawned, i.e. {0, 0}) even
+    return (handle.generation & 1u) != 0 &&
+        handle.index < mGenerations.size() &&
+        mGenerations[handle.index] == handle.generation;
+}
+
+inline AnimatedSprite *
+SpritePool::get(Handle handle)
+{
+    return isValid(handle) ? &mSprites[mSlotToDense[handle.index]] : 0;
+}
+inline const AnimatedSprite *
+SpritePool::get(Handle handle) const
+{
+    return isValid(handle) ? &mSprites[mSlotToDense[handle.index]] : 0;
+}
+
+inline SpritePool::Handle
+SpritePool::handleOf(std::size_t i) const
+{
+    const std::uint32_t slot = mDenseToSlot[i];
+    const Handle handle = {slot, mGenerations[slot]};
+    return handle;
+}
+
+inline AnimatedSprite *
+SpritePool::sprites(void)
+{
+    return mSprites.data();
+}
+inline const AnimatedSprite *
+SpritePool::sprites(void) const
+{
+    return mSprites.data();
+}
+
+inline std::size_t
+SpritePool::size(void) const
+{
+    return mSize;
+}
+
+inline std::size_t
+SpritePool::capacity(void) const
+{
+    return mSprites.size();
+}
+
+inline const SpritePool::Stats &
+SpritePool::stats(void) const
+{
+    return mStats;
+}
+
+} /* namespace ui */
+#endif /* SPRITEPOOL_H_ */
@@ -0,0 +1,305 @@
+/*
+ * TextureCache.cpp
+ *
+ *  Created on: Mar 12, 2013
+ *      Author: agustin
+ */
+
+#include "TextureCache.h"
+#include "TextureDiskCache.h"
+
+#include <vector>
+#include <cstdlib>
+#include <unistd.h>
+
+#include <SFML/System/Clock.hpp>
+#include <FileManager.h>
+#include <debug/DebugUtil.h>
+#include <debug/FlightRecorder.h>
+#include <memory/MemoryTracker.h>
+
+
+namespace ui {
+
+TextureCache *TextureCache::mInstance = 0;
+
+////////////////////////////////////////////////////////////////////////////////
+void
+TextureCache::Releaser::operator()(const sf::Texture *texture) const
+{
+    TextureCache::getInstance()->release(key, texture);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+TextureCache::release(const std::string &key, const sf::Texture *texture)
+{
+    EntryMap::iterator it = mEntries.find(key);
+    // the entry could be replaced already by a new load of the same file
+    if (it != mEntries.end() && it->second.texture == texture) {
+        ASSERT(mStats.residentBytes >= it->second.bytes);
+        mStats.residentBytes -= it->second.bytes;
+        --mStats.residentTextures;
+        mEntries.erase(it);
+    }
+    delete texture;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+TextureHandle
+TextureCache::lookup(const std::string &key)
+{
+    EntryMap::iterator it = mEntries.find(key);
+    if (it != mEntries.end()) {
+        TextureHandle handle = it->second.handle.lock();
+        if (handle.get() != 0) {
+            ++mStats.hits;
+            return handle;
+        }
+    }
+    ++mStats.misses;
+    return TextureHandle();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+TextureHandle
+TextureCache::insert(const std::string &key, sf::Texture *texture)
+{
+    Releaser releaser;
+    releaser.key = key;
+    TextureHandle handle(texture, releaser);
+
+    Entry &entry = mEntries[key];
+    entry.handle = handle;
+    entry.texture = texture;
+    entry.bytes = texture->getSize().x * texture->getSize().y * 4;
+    mStats.residentBytes += entry.bytes;
+    ++mStats.residentTextures;
+
+    return handle;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+TextureCache::TextureCache()
+{
+    mStats.residentTextures = 0;
+    mStats.residentBytes = 0;
+    resetStats();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+TextureCache::~TextureCache()
+{
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+TextureCache *
+TextureCache::getInstance(void)
+{
+    if (!mInstance) {
+        mInstance = new TextureCache;
+    }
+    return mInstance;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+TextureHandle
+TextureCache::get(const std::string &fName)
+{
+    MEMORY_TAG_SCOPE(TEXTURES);
+    if (fName.empty()) {
+        debugERROR("fName is empty\n");
+        return TextureHandle();
+    }
+    const std::string key = normalizePath(fName);
+
+    // check if we already have it
+    TextureHandle handle = lookup(key);
+    if (handle.get() != 0) {
+        return handle;
+    }
+
+    // we have to load it
+    sf::Texture *texture = new sf::Texture();
+    sf::Clock clock;
+    bool loaded = false;
+    TextureDiskCache *diskCache = TextureDiskCache::getInstance();
+    if (FileManager::isPackPath(key)) {
+        // the png is decoded from the mapped archive
+        FileView view;
+        loaded = FileManager::getInstance()->readFileView(key, view) &&
+            texture->loadFromMemory(view.data(), view.size());
+    } else if (diskCache->load(key, *texture)) {
+        loaded = true;
+    } else if (diskCache->isEnabled()) {
+        // decoded once, the next launches take the pixels from the disk
+        TextureDiskCache::Source source;
+        sf::Image image;
+        loaded = TextureDiskCache::source(key, source) &&
+            image.loadFromFile(key) && texture->loadFromImage(image);
+        if (loaded) {
+            diskCache->store(key, source, image);
+        }
+    } else {
+        loaded = texture->loadFromFile(key);
+    }
+    FLIGHT_RECORD_LOAD(key.c_str(), clock.getElapsedTime().asSeconds(), loaded);
+    if (!loaded) {
+        debugERROR("Error loading texture: %s\n", key.c_str());
+        delete texture;
+        return TextureHandle();
+    }
+    return insert(key, texture);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+TextureHandle
+TextureCache::add(const std::string &fName, const sf::Image &image)
+{
+    MEMORY_TAG_SCOPE(TEXTURES);
+    const std::string key = normalizePath(fName);
+
+    TextureHandle handle = lookup(key);
+    if (handle.get() != 0) {
+        return handle;
+    }
+
+    sf::Texture *texture = new sf::Texture();
+    if (!texture->loadFromImage(image)) {
+        debugERROR("Error creating the texture of: %s\n", key.c_str());
+        delete texture;
+        return TextureHandle();
+    }
+    return insert(key, texture);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+TextureHandle
+TextureCache::reload(const std::string &fName)
+{
+    MEMORY_TAG_SCOPE(TEXTURES);
+    const std::string key = normalizePath(fName);
+    EntryMap::iterator it = mEntries.find(key);
+    if (it == mEntries.end()) {
+        return TextureHandle();
+    }
+    TextureHandle handle = it->second.handle.lock();
+    if (handle.get() == 0) {
+        return TextureHandle();
+    }
+
+    // decode it first, the texture is only touched if everything is fine
+    sf::Clock clock;
+    sf::Image image;
+    bool loaded = false;
+    TextureDiskCache::Source source;
+    const bool packed = FileManager::isPackPath(key);
+    if (packed) {
+        FileView view;
+        loaded = FileManager::getInstance()->readFileView(key, view) &&
+            image.loadFromMemory(view.data(), view.size());
+    } else {
+        loaded = TextureDiskCache::source(key, source) &&
+            image.loadFromFile(key);
+    }
+    const sf::Vector2u size = image.getSize();
+    const unsigned int maxSize = sf::Texture::getMaximumSize();
+    loaded = loaded && size.x > 0 && size.y > 0 &&
+        size.x <= maxSize && size.y <= maxSize;
+
+    Entry &entry = it->second;
+    if (loaded && size == entry.texture->getSize()) {
+        // the usual edit, only the pixels are uploaded
+        entry.texture->update(image);
+    } else if (loaded) {
+        loaded = entry.texture->loadFromImage(image);
+    }
+    FLIGHT_RECORD_LOAD(key.c_str(), clock.getElapsedTime().asSeconds(), loaded);
+    if (!loaded) {
+        debugERROR("Error reloading texture: %s\n", key.c_str());
+        return TextureHandle();
+    }
+
+    ASSERT(mStats.residentBytes >= entry.bytes);
+    mStats.residentBytes -= entry.bytes;
+    entry.bytes = size.x * size.y * 4;
+    mStats.residentBytes += entry.bytes;
+    // the cached entry is stale now
+    if (!packed) {
+        TextureDiskCache::getInstance()->store(key, source, image);
+    }
+    return handle;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+TextureCache::contains(const std::string &fName) const
+{
+    EntryMap::const_iterator it = mEntries.find(normalizePath(fName));
+    return it != mEntries.end() && !it->second.handle.expired();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::string
+TextureCache::normalizePath(const std::string &fName)
+{
+    std::string path = fName;
+    for (std::size_t i = 0; i < path.size(); ++i) {
+        if (path[i] == '\\') {
+            path[i] = '/';
+        }
+    }
+    // the names in the archives are already unique
+    if (FileManager::isPackPath(path)) {
+        return path;
+    }
+
+    // make it absolute
+    if (path.empty() || path[0] != '/') {
+        char *cwd = get_current_dir_name();
+        if (cwd != 0) {
+            path = std::string(cwd) + "/" + path;
+            free(cwd);
+        }
+    }
+
+    // remove the "." / ".." / empty components
+    std::vector<std::string> components;
+    std::size_t begin = 0;
+    while (begin <= path.size()) {
+        std::size_t end = path.find('/', begin);
+        if (end == std::string::npos) {
+            end = path.size();
+        }
+        const std::string component = path.substr(begin, end - begin);
+        if (component == "..") {
+            if (!components.empty()) {
+                components.pop_back();
+            }
+        } else if (!component.empty() && component != ".") {
+            components.push_back(component);
+        }
+        begin = end + 1;
+    }
+
+    std::string result;
+    for (std::size_t i = 0; i < components.size(); ++i) {
+        result += "/";
+        result += components[i];
+    }
+    return result.empty() ? "/" : result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+TextureCache::resetStats(void)
+{
+    mStats.hits = 0;
+    mStats.misses = 0;
+}
+
+} /* namespace ui */
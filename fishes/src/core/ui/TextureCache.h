@@ -0,0 +1,128 @@
+/*
+ * TextureCache.h
+ *
+ *  Created on: Mar 12, 2013
+ *      Author: agustin
+ */
+
+#ifndef TEXTURECACHE_H_
+#define TEXTURECACHE_H_
+
+#include <string>
+#include <cstddef>
+#include <unordered_map>
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+
+#include <SFML/Graphics/Texture.hpp>
+#include <SFML/Graphics/Image.hpp>
+
+
+namespace ui {
+
+// The reference counted handle to a texture of the cache. The texture is
+// released (and removed from the cache) when the last handle is destroyed.
+typedef boost::shared_ptr<const sf::Texture> TextureHandle;
+
+// @brief Process-wide texture cache. The textures are keyed by its normalized
+// path so every sprite using the same sheet shares the same texture (loaded
+// and uploaded only once).
+// This class is not thread safe, it should be used from the main thread.
+//
+class TextureCache
+{
+public:
+    struct Stats {
+        std::size_t hits;
+        std::size_t misses;
+        std::size_t residentTextures;
+        std::size_t residentBytes;
+    };
+
+public:
+    // @brief Returns the instance
+    static TextureCache *getInstance(void);
+
+    // @brief Get the texture of a file, loading it if it is not already in
+    // the cache (the decoded pixels are taken from the TextureDiskCache if it
+    // is enabled).
+    // @param   fName   The texture file name (or pack://name, see
+    //                  FileManager::mountArchive())
+    // @returns the handle of the texture, or an empty handle on error
+    TextureHandle get(const std::string &fName);
+
+    // @brief Create the texture of a file from an already decoded image (i.e.
+    // by the AsyncTextureLoader). If the file is already in the cache the
+    // current texture is returned and the image is ignored.
+    // @param   fName   The texture file name
+    // @param   image   The decoded image of the file
+    // @returns the handle of the texture, or an empty handle on error
+    TextureHandle add(const std::string &fName, const sf::Image &image);
+
+    // @brief Reload the texture of a file that changed on disk (see
+    // HotReloader). The new pixels are uploaded into the same sf::Texture, so
+    // every handle and sprite using it shows them without being rebuilt. On
+    // error the old pixels are kept.
+    // @param   fName   The texture file name
+    // @returns the handle of the texture, or an empty handle if the file is
+    //          not loaded (nothing to do) or on error
+    TextureHandle reload(const std::string &fName);
+
+    // @brief Check if a texture is already loaded (without touching the stats)
+    // @param   fName   The texture file name
+    bool contains(const std::string &fName) const;
+
+    // @brief Returns the normalized path used as key (absolute path, without
+    // "." / ".." / duplicated separators). The pack:// names are kept.
+    static std::string normalizePath(const std::string &fName);
+
+    // @brief Stats functions. resetStats() only reset the hits / misses.
+    inline const Stats &stats(void) const;
+    void resetStats(void);
+
+private:
+    TextureCache();
+    ~TextureCache();
+
+    // @brief Returns the texture of a key if it is in the cache (counting
+    // a hit), or an empty handle (counting a miss)
+    TextureHandle lookup(const std::string &key);
+
+    // @brief Register a new texture (already loaded) in the cache
+    TextureHandle insert(const std::string &key, sf::Texture *texture);
+
+    // @brief Called when the last handle of a texture is destroyed
+    void release(const std::string &key, const sf::Texture *texture);
+
+    // the deleter of the handles
+    struct Releaser {
+        std::string key;
+        void operator()(const sf::Texture *texture) const;
+    };
+
+    struct Entry {
+        boost::weak_ptr<const sf::Texture> handle;
+        sf::Texture *texture;
+        std::size_t bytes;
+    };
+    typedef std::unordered_map<std::string, Entry> EntryMap;
+
+private:
+    static TextureCache *mInstance;
+
+    EntryMap mEntries;
+    Stats mStats;
+};
+
+
+// Inline implementations
+//
+
+inline const TextureCache::Stats &
+TextureCache::stats(void) const
+{
+    return mStats;
+}
+
+} /* namespace ui */
+#endif /* TEXTURECACHE_H_ */
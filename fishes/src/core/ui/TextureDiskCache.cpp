@@ -0,0 +1,282 @@
+/*
+ * TextureDiskCache.cpp
+ *
+ *  Created on: Apr 20, 2013
+ *      Author: agustin
+ */
+
+#include "TextureDiskCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <FileView.h>
+#include <FileManager.h>
+#include <debug/DebugUtil.h>
+#include <memory/MemoryTracker.h>
+
+
+// auxiliar functions
+namespace {
+
+const char MAGIC[8] = {'F', 'S', 'H', 'T', 'E', 'X', '\0', '\0'};
+// the pixels start at a multiple of this
+const std::size_t PIXELS_ALIGNMENT = 64;
+
+// @brief Get the size and modification time (ns) of a source file
+bool
+sourceInfo(const std::string &fName, std::uint64_t &size, std::int64_t &mtime)
+{
+    struct stat info;
+    if (::stat(fName.c_str(), &info) != 0 || !S_ISREG(info.st_mode)) {
+        return false;
+    }
+    size = info.st_size;
+    mtime = std::int64_t(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+    return true;
+}
+
+}
+
+
+namespace ui {
+
+TextureDiskCache *TextureDiskCache::mInstance = 0;
+
+// The mapped pixels of a valid entry
+struct TextureDiskCache::Pixels {
+    FileView view;
+    const sf::Uint8 *data;
+    unsigned int width;
+    unsigned int height;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+TextureDiskCache::lookup(const std::string &fName, Pixels &pixels)
+{
+    if (!isEnabled() || FileManager::isPackPath(fName)) {
+        return false;
+    }
+    std::uint64_t sourceSize = 0;
+    std::int64_t sourceMtime = 0;
+    if (!sourceInfo(fName, sourceSize, sourceMtime)) {
+        return false;
+    }
+
+    // most of the misses are the first launch, check it without opening
+    const std::string path = entryPath(fName);
+    struct stat info;
+    if (::stat(path.c_str(), &info) != 0 ||
+        !pixels.view.open(path, FileView::ACCESS_SEQUENTIAL)) {
+        ++mMisses;
+        return false;
+    }
+
+    const FileHeader *header =
+        reinterpret_cast<const FileHeader *>(pixels.view.data());
+    const std::uint64_t size = pixels.view.size();
+    bool valid = size >= sizeof(FileHeader) &&
+        std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) == 0 &&
+        header->version == VERSION &&
+        header->sourceSize == sourceSize &&
+        header->sourceMtime == sourceMtime &&
+        header->pathLength == fName.size() &&
+        header->pixelsOffset >= sizeof(FileHeader) + header->pathLength &&
+        header->pixelsOffset <= size &&
+        (size - header->pixelsOffset) ==
+            std::uint64_t(header->width) * header->height * 4;
+    // the hash of the name could collide
+    valid = valid && std::memcmp(pixels.view.data() + sizeof(FileHeader),
+                                 fName.data(), fName.size()) == 0;
+    if (!valid) {
+        debugWARNING("Stale cached texture of %s, removed\n", fName.c_str());
+        pixels.view.close();
+        ::unlink(path.c_str());
+        ++mStale;
+        return false;
+    }
+
+    pixels.data = reinterpret_cast<const sf::Uint8 *>(pixels.view.data() +
+                                                      header->pixelsOffset);
+    pixels.width = header->width;
+    pixels.height = header->height;
+    ++mHits;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+TextureDiskCache::TextureDiskCache() :
+    mHits(0)
+,   mMisses(0)
+,   mStale(0)
+,   mStores(0)
+,   mTmpCounter(0)
+{
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+TextureDiskCache::~TextureDiskCache()
+{
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+TextureDiskCache *
+TextureDiskCache::getInstance(void)
+{
+    if (!mInstance) {
+        mInstance = new TextureDiskCache;
+    }
+    return mInstance;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+TextureDiskCache::setFolder(const std::string &folder)
+{
+    mFolder.clear();
+    if (folder.empty()) {
+        return true;
+    }
+    if (::mkdir(folder.c_str(), 0755) != 0 && errno != EEXIST) {
+        debugERROR("Error creating the texture cache folder %s\n",
+                   folder.c_str());
+        return false;
+    }
+    mFolder = folder;
+    if (mFolder[mFolder.size() - 1] != '/') {
+        mFolder += '/';
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+TextureDiskCache::load(const std::string &fName, sf::Texture &texture)
+{
+    Pixels pixels;
+    if (!lookup(fName, pixels)) {
+        return false;
+    }
+    // uploaded straight from the mapping
+    if (!texture.create(pixels.width, pixels.height)) {
+        debugERROR("Error creating the texture of %s\n", fName.c_str());
+        return false;
+    }
+    texture.update(pixels.data);
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+TextureDiskCache::load(const std::string &fName, sf::Image &image)
+{
+    MEMORY_TAG_SCOPE(TEXTURES);
+    Pixels pixels;
+    if (!lookup(fName, pixels)) {
+        return false;
+    }
+    image.create(pixels.width, pixels.height, pixels.data);
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+TextureDiskCache::source(const std::string &fName, Source &source)
+{
+    return sourceInfo(fName, source.size, source.mtime);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool
+TextureDiskCache::store(const std::string &fName,
+                        const Source &source,
+                        const sf::Image &image)
+{
+    if (!isEnabled() || FileManager::isPackPath(fName)) {
+        return false;
+    }
+    FileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.sourceSize = source.size;
+    header.sourceMtime = source.mtime;
+    header.width = image.getSize().x;
+    header.height = image.getSize().y;
+    header.pathLength = static_cast<std::uint32_t>(fName.size());
+    header.pixelsOffset = (sizeof(header) + fName.size() + PIXELS_ALIGNMENT - 1) &
+        ~std::uint64_t(PIXELS_ALIGNMENT - 1);
+    const std::size_t numBytes = std::size_t(header.width) * header.height * 4;
+    const std::size_t padding = header.pixelsOffset - sizeof(header) - fName.size();
+    static const char zeros[PIXELS_ALIGNMENT] = {0};
+
+    // unique per process and thread, the rename is atomic
+    char suffix[64];
+    std::snprintf(suffix, sizeof(suffix), ".tmp%d_%zu", int(::getpid()),
+                  mTmpCounter.fetch_add(1));
+    const std::string path = entryPath(fName);
+    const std::string tmpPath = path + suffix;
+    FILE *file = std::fopen(tmpPath.c_str(), "wb");
+    if (file == 0) {
+        debugERROR("Error creating %s\n", tmpPath.c_str());
+        return false;
+    }
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+        std::fwrite(fName.data(), 1, fName.size(), file) == fName.size() &&
+        std::fwrite(zeros, 1, padding, file) == padding &&
+        (numBytes == 0 ||
+         std::fwrite(image.getPixelsPtr(), 1, numBytes, file) == numBytes);
+    ok = (std::fclose(file) == 0) && ok;
+    ok = ok && std::rename(tmpPath.c_str(), path.c_str()) == 0;
+    if (!ok) {
+        debugERROR("Error writing the cached texture %s\n", path.c_str());
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    ++mStores;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::string
+TextureDiskCache::entryPath(const std::string &fName) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.tex",
+                  static_cast<unsigned long long>(
+                      PackArchive::hashName(fName.data(), fName.size())));
+    return mFolder + name;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+TextureDiskCache::Stats
+TextureDiskCache::stats(void) const
+{
+    Stats stats;
+    stats.hits = mHits.load();
+    stats.misses = mMisses.load();
+    stats.stale = mStale.load();
+    stats.stores = mStores.load();
+    return stats;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+TextureDiskCache::resetStats(void)
+{
+    mHits = 0;
+    mMisses = 0;
+    mStale = 0;
+    mStores = 0;
+}
+
+} /* namespace ui */
@@ -0,0 +1,143 @@
+/*
+ * TextureDiskCache.h
+ *
+ *  Created on: Apr 20, 2013
+ *      Author: agustin
+ */
+
+#ifndef TEXTUREDISKCACHE_H_
+#define TEXTUREDISKCACHE_H_
+
+#include <string>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include <SFML/Graphics/Texture.hpp>
+#include <SFML/Graphics/Image.hpp>
+
+
+namespace ui {
+
+// @brief On-disk cache of decoded textures, to skip the png decoding on the
+// next launches. Each texture is stored as the raw RGBA pixels (ready to be
+// uploaded) in one file of the cache folder, named by the hash of the path
+// of the source. The file keeps the size and the modification time of the
+// source, if they change the entry is stale: it is removed and the source is
+// decoded (and stored) again.
+// The cached files are memory mapped and uploaded from the mapping (no copy).
+// The files from the archives (pack://) are not cached.
+//
+// It is disabled until setFolder() is called (before loading anything).
+// load() / store() can be called from any thread (the AsyncTextureLoader
+// workers).
+//
+class TextureDiskCache
+{
+public:
+    static const std::uint32_t VERSION = 1;
+
+    // The header of the cache files (followed by the source path and the
+    // pixels, at pixelsOffset)
+    struct FileHeader {
+        char magic[8];              // "FSHTEX\0\0"
+        std::uint32_t version;
+        std::uint32_t width;
+        std::uint32_t height;
+        std::uint32_t pathLength;
+        std::uint64_t sourceSize;
+        std::int64_t sourceMtime;   // nanoseconds
+        std::uint64_t pixelsOffset;
+        std::uint32_t reserved[4];
+    };
+
+    // The size and modification time of a source (an entry is stale when
+    // they change)
+    struct Source {
+        std::uint64_t size;
+        std::int64_t mtime;         // nanoseconds
+    };
+
+    struct Stats {
+        std::size_t hits;
+        std::size_t misses;
+        std::size_t stale;          // found but invalidated
+        std::size_t stores;
+    };
+
+public:
+    // @brief Returns the instance
+    static TextureDiskCache *getInstance(void);
+
+    // @brief Enable the cache in a folder (created if it doesn't exist), an
+    //        empty folder disables it
+    // @returns true on success, false if the folder can't be created
+    bool setFolder(const std::string &folder);
+    inline bool isEnabled(void) const;
+
+    // @brief Create a texture from the cached pixels of a source file
+    // @param   fName   The normalized path of the source
+    // @returns true if it was in the cache (and not stale), false otherwise
+    bool load(const std::string &fName, sf::Texture &texture);
+
+    // @brief Same as above but into an image (for the loader threads)
+    bool load(const std::string &fName, sf::Image &image);
+
+    // @brief Get the size and modification time of a source file. It must
+    //        be taken before decoding the file and given to store(), so if
+    //        the file is edited meanwhile the entry is stale (instead of
+    //        keeping the old pixels with the new time).
+    // @returns false if it is not a regular file
+    static bool source(const std::string &fName, Source &source);
+
+    // @brief Store the decoded pixels of a source file (the file is written
+    //        to a temporary file and renamed, so a crash never leaves an
+    //        invalid entry)
+    // @param   fName   The normalized path of the source
+    // @param   source  The source info taken before decoding it
+    // @param   image   The decoded pixels
+    // @returns true on success, false otherwise
+    bool store(const std::string &fName,
+               const Source &source,
+               const sf::Image &image);
+
+    // @brief Returns the path of the cache file of a source
+    std::string entryPath(const std::string &fName) const;
+
+    // @brief Stats functions
+    Stats stats(void) const;
+    void resetStats(void);
+
+private:
+    TextureDiskCache();
+    ~TextureDiskCache();
+
+    // the mapped pixels of a valid entry
+    struct Pixels;
+
+    // @brief Map the entry of a source, checking it is not stale
+    bool lookup(const std::string &fName, Pixels &pixels);
+
+private:
+    static TextureDiskCache *mInstance;
+
+    std::string mFolder;
+    std::atomic<std::size_t> mHits;
+    std::atomic<std::size_t> mMisses;
+    std::atomic<std::size_t> mStale;
+    std::atomic<std::size_t> mStores;
+    std::atomic<std::size_t> mTmpCounter;
+};
+
+
+// Inline implementations
+//
+
+inline bool
+TextureDiskCache::isEnabled(void) const
+{
+    return !mFolder.empty();
+}
+
+} /* namespace ui */
+#endif /* TEXTUREDISKCACHE_H_ */